@@ -0,0 +1,62 @@
+/*
+ * This file is part of Web Upload Engine for MeeGo social networking uploads
+ *
+ * Copyright (C) 2010-2011 Nokia Corporation and/or its subsidiary(-ies). All rights reserved.
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense,     
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER  
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS  
+ * IN THE SOFTWARE. 
+ */
+
+#ifndef _DUMMY_AUTH_H_
+#define _DUMMY_AUTH_H_
+
+#include <WebUpload/AuthBase>
+
+
+/*!
+  \class DummyAuth
+  \brief Dummy auth class that always requires authentication with fixed
+         data, to test the response caching of WebUpload::AuthBase
+ */
+class DummyAuth : public WebUpload::AuthBase {
+    Q_OBJECT
+    
+public:
+    /*!
+      \brief Constructor
+      \param authData Data returned by getAuthData
+      \param parent QObject parent
+     */
+    DummyAuth (const WebUpload::AuthData & authData, QObject *parent = 0);
+    
+    ~DummyAuth ();  
+
+protected:
+
+    //! \brief Implementation for WebUpload::AuthBase::isAuthRequired
+    virtual bool isAuthRequired ();
+
+    //! \brief Implementation for WebUpload::AuthBase::getAuthData
+    virtual WebUpload::AuthData getAuthData ();
+
+private:
+
+    WebUpload::AuthData m_authData; //!< Data returned by getAuthData
+    
+};
+#endif
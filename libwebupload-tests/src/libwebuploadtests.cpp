@@ -45,8 +45,14 @@
 #include "WebUpload/System"
 #include "WebUpload/Service"
 #include "serviceprivate.h"
+#include "mediaprivate.h"
 #include "accountprivate.h"
+#include "outboxindex.h"
+#include "stringtable.h"
 #include "WebUpload/HttpMultiContentIO"
+#include "WebUpload/CompressedIO"
+#include "WebUpload/RateLimiter"
+#include "WebUpload/UploadLedger"
 #include "WebUpload/processexchangedata.h"
 #include "WebUpload/PluginInterface"
 #include "WebUpload/Error"
@@ -54,6 +60,11 @@
 #include "WebUpload/CommonTextOption"
 #include "commonoptionprivate.h"
 #include "dummypost.h"
+#include "dummyauth.h"
+#include "authbaseprivate.h"
+#include <QSettings>
+#include <QCryptographicHash>
+#include <unistd.h>
 
 #define TEMP_ENTRY_PATH "/tmp/entry.xml"
 
@@ -139,6 +150,9 @@ void LibWebUploadTests::loadEntry() {
         media = mediaIter.next ();
         QVERIFY(media->makeCopy () == WebUpload::Media::COPY_RESULT_SUCCESS);
         QVERIFY (QFile::exists(media->copyFilePath()));
+        QCOMPARE (media->contentHash(),
+            UploadLedger::contentHash (media->copyFilePath()));
+        QCOMPARE (UploadLedger::contentHash (media), media->contentHash());
         QVERIFY(media->makeCopy () == WebUpload::Media::COPY_RESULT_ALREADY_COPIED);
         checkFilePaths << media->copyFilePath();
         QVERIFY(media->fileSize() > 0);
@@ -247,6 +261,12 @@ void LibWebUploadTests::systemChecks() {
     QCOMPARE (outPath, entry->serializedTo());
     delete entry;
 
+    // Empty outbox gives empty index
+    QDir().mkpath ("/tmp/libwebupload-outbox");
+    system.setEntryOutboxPath ("/tmp/libwebupload-outbox");
+    QVERIFY (system.outboxIndex().isEmpty());
+    QVERIFY (system.outboxEntries().isEmpty());
+
     system.setEntryOutboxPath (entryPath);
 
     // Try account loading
@@ -259,6 +279,73 @@ void LibWebUploadTests::systemChecks() {
     }
 }
 
+void LibWebUploadTests::testOutboxIndex () {
+    QString outbox = "/tmp/libwebupload-index";
+    QDir().mkpath (outbox);
+    QDir dir (outbox);
+    QString indexPath = dir.filePath (OutboxIndex::INDEX_FILE_NAME);
+    QString lockPath = dir.filePath (OutboxIndex::LOCK_FILE_NAME);
+    QFile::remove (indexPath);
+
+    {
+        OutboxIndexLock lock (outbox);
+        QVERIFY (lock.isLocked ());
+        QVERIFY (QFile::exists (lockPath));
+    }
+
+    // Record is written when entry is serialized and updated with state
+    QString path1 = dir.filePath ("entry_index1.xml");
+    createEntry (path1);
+
+    OutboxIndex index (outbox);
+    QVERIFY (index.load ());
+    OutboxRecord record = index.record (path1);
+    QVERIFY (record.isValid ());
+    QVERIFY (record.isPending ());
+    QVERIFY (!OutboxIndex::isStale (record));
+
+    OutboxIndex::updateEntryState (path1, TRANSFER_STATE_ACTIVE, false);
+    QVERIFY (index.load ());
+    QVERIFY (index.record (path1).isActive ());
+
+    // Missing index is rebuilt from the entries
+    QFile::remove (indexPath);
+    WebUpload::System system;
+    QString oldOutbox = system.entryOutputPath ();
+    system.setEntryOutboxPath (outbox);
+    QList<OutboxRecord> records = system.outboxIndex ();
+    QCOMPARE (records.count(), 1);
+    QCOMPARE (records.at (0).path(), path1);
+    QVERIFY (QFile::exists (indexPath));
+
+    // Records of removed entries are dropped in repair
+    QString path2 = dir.filePath ("entry_index2.xml");
+    OutboxIndex::storeEntry (OutboxIndex::createRecord (path2,
+        QDateTime::currentDateTime(), "facebook", TRANSFER_STATE_PENDING,
+        false, 100));
+    QVERIFY (index.load ());
+    QVERIFY (index.record (path2).isValid ());
+    QCOMPARE (system.outboxIndex ().count(), 1);
+    QVERIFY (index.load ());
+    QVERIFY (!index.record (path2).isValid ());
+
+    // Finished entries stay indexed, but are not listed or recovered
+    OutboxIndex::updateEntryState (path1, TRANSFER_STATE_DONE, false);
+    QVERIFY (system.outboxIndex ().isEmpty ());
+    QVERIFY (system.outboxEntries ().isEmpty ());
+    QVERIFY (index.load ());
+    QVERIFY (index.record (path1).isSent ());
+
+    OutboxIndex::removeEntry (path1);
+    QVERIFY (index.load ());
+    QVERIFY (index.records ().isEmpty ());
+
+    system.setEntryOutboxPath (oldOutbox);
+    QFile::remove (path1);
+    QFile::remove (indexPath);
+    QFile::remove (lockPath);
+}
+
 void LibWebUploadTests::modifyMediaFields() {
     createEntry (TEMP_ENTRY_PATH);
 
@@ -366,6 +453,18 @@ void LibWebUploadTests::entryMetadataHandling() {
     commonTags = entry->commonTags();
     QCOMPARE (commonTags.size(), 1);
 
+    // Bulk append, "common" is already in all media
+    entry->appendTagsToAllMedia (QStringList() << "bulk1" << "bulk2" <<
+        "common" << "bulk1");
+    commonTags = entry->commonTags();
+    QCOMPARE (commonTags.size(), 3);
+    QCOMPARE (media1->tags().count(), 4);
+
+    entry->removeTagFromAllMedia ("bulk1");
+    entry->removeTagFromAllMedia ("bulk2");
+    commonTags = entry->commonTags();
+    QCOMPARE (commonTags.size(), 1);
+
     // There should not be any files written
     QVERIFY (entry->serializedTo().isEmpty());
     QVERIFY (media1->copyFilePath ().isEmpty());
@@ -963,6 +1062,398 @@ void LibWebUploadTests::testHttpMultiContentIO() {
     delete multi;
 }
 
+void LibWebUploadTests::testCompressedIO() {
+    QByteArray original;
+    for (int i = 0; i < 5000; ++i) {
+        original.append ("description=Holiday photos ");
+        original.append (QByteArray::number (i));
+        original.append ("&");
+    }
+
+    QBuffer * source = new QBuffer ();
+    source->setData (original);
+
+    CompressedIO * compressed = new CompressedIO (source,
+        CompressedIO::ENCODING_DEFLATE);
+    QCOMPARE (compressed->contentEncoding(), QByteArray ("deflate"));
+    QVERIFY (compressed->open (QIODevice::ReadOnly));
+    QVERIFY (compressed->size() > 0);
+    QVERIFY (compressed->size() < original.size());
+
+    QByteArray output = compressed->readAll ();
+    QCOMPARE ((qint64)output.size(), compressed->size());
+    QVERIFY (compressed->atEnd());
+
+    // qUncompress expects the length of the data before zlib stream
+    QByteArray prefixed;
+    prefixed.append ((char)((original.size() >> 24) & 0xff));
+    prefixed.append ((char)((original.size() >> 16) & 0xff));
+    prefixed.append ((char)((original.size() >> 8) & 0xff));
+    prefixed.append ((char)(original.size() & 0xff));
+    prefixed.append (output);
+    QCOMPARE (qUncompress (prefixed), original);
+
+    // Seeking back gives the same bytes again
+    QVERIFY (compressed->seek (10));
+    QCOMPARE (compressed->read (20), output.mid (10, 20));
+    compressed->close ();
+    delete compressed;
+
+    CompressedIO::Encoding encoding = CompressedIO::ENCODING_DEFLATE;
+    QVERIFY (!CompressedIO::preferredEncoding (QStringList() << "zstd",
+        encoding));
+    QVERIFY (CompressedIO::preferredEncoding (QStringList() << "zstd" <<
+        "gzip" << "deflate", encoding));
+    QCOMPARE (encoding, CompressedIO::ENCODING_GZIP);
+}
+
+void LibWebUploadTests::testRateLimiter() {
+    RateLimiter limiter;
+    QBuffer device;
+
+    // No limit by default
+    QCOMPARE (limiter.rate(), (qint64)0);
+    QCOMPARE (limiter.take (&device, 100000), (qint64)100000);
+
+    // Bucket is empty at start, reader is woken up when there is data
+    limiter.setRate (16384);
+    QSignalSpy readyReadSpy (&device, SIGNAL (readyRead()));
+    QCOMPARE (limiter.take (&device, 100000), (qint64)0);
+    QTest::qWait (500);
+    QVERIFY (readyReadSpy.count() > 0);
+
+    // At most the burst (quarter of a second) is handed out at a time
+    qint64 granted = limiter.take (&device, 100000);
+    QVERIFY (granted > 0);
+    QVERIFY (granted <= 4096);
+    QCOMPARE (limiter.take (&device, 100000), (qint64)0);
+
+    limiter.setRate (0);
+    QCOMPARE (limiter.take (&device, 100000), (qint64)100000);
+}
+
+void LibWebUploadTests::testUploadLedger() {
+    QTemporaryFile temp ("/tmp/libwebupload-test-XXXXXX");
+    QVERIFY (temp.open());
+    temp.write ("ledger test content");
+    temp.close ();
+
+    QByteArray hash = UploadLedger::contentHash (temp.fileName());
+    QCOMPARE (hash, QCryptographicHash::hash ("ledger test content",
+        QCryptographicHash::Sha1));
+    QVERIFY (UploadLedger::contentHash (QString("/nonexistent")).isEmpty());
+
+    UploadLedger ledger (QUuid::createUuid().toString());
+    QVERIFY (ledger.isEmpty());
+    QVERIFY (!ledger.contains (hash));
+
+    ledger.record (hash, "http://example.com/photo/1");
+    QVERIFY (ledger.contains (hash));
+    QVERIFY (!ledger.isEmpty());
+    QCOMPARE (ledger.destination (hash),
+        QString("http://example.com/photo/1"));
+
+    ledger.remove (hash);
+    QVERIFY (!ledger.contains (hash));
+    QVERIFY (ledger.isEmpty());
+}
+
+/*!
+  \brief Resident memory of the test process
+  \return Bytes, 0 if not known
+ */
+static qint64 residentMemory () {
+    QFile statm ("/proc/self/statm");
+    if (!statm.open (QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    QList<QByteArray> fields = statm.readAll().split (' ');
+    if (fields.size() < 2) {
+        return 0;
+    }
+
+    return fields.at(1).toLongLong() * sysconf (_SC_PAGESIZE);
+}
+
+void LibWebUploadTests::testStringTable () {
+    // Equal values share data
+    QString mime = StringTable::string (QString ("image/jpeg"));
+    QCOMPARE (StringTable::string (QString::fromLatin1 ("image/jpeg")).
+        constData(), mime.constData());
+    QUrl tagUrl = StringTable::url (QString ("urn:uuid:tag-shared"));
+    QCOMPARE (StringTable::url (QUrl ("urn:uuid:tag-shared")), tagUrl);
+    QVERIFY (StringTable::string (QString()).isNull());
+
+    // Values nobody uses are dropped, used ones are kept
+    for (int i = 0; i < 10000; ++i) {
+        StringTable::string (QString ("tag-%1").arg (i));
+        StringTable::url (QString ("urn:uuid:tag-%1").arg (i));
+    }
+    QVERIFY (StringTable::count() < 1000);
+    StringTable::prune ();
+    QVERIFY (StringTable::count() >= 2);
+    QCOMPARE (StringTable::string (QString ("image/jpeg")).constData(),
+        mime.constData());
+    int baseline = StringTable::count ();
+
+    // Large entry: media share their mime type, option ids and tags. Keep
+    // this in line with the "few MB" goal of big shares.
+    const int mediaCount = 2000;
+    const int tagsPerMedia = 10;
+    QDomDocument doc ("test");
+    qint64 before = residentMemory ();
+
+    Entry * entry = new Entry ();
+    for (int i = 0; i < mediaCount; ++i) {
+        QDomElement item = doc.createElement ("item");
+        item.setAttribute ("mime", "image/jpeg");
+        QDomElement tags = doc.createElement ("tags");
+        for (int j = 0; j < tagsPerMedia; ++j) {
+            QDomElement tag = doc.createElement ("tag");
+            tag.setAttribute ("tracker_url",
+                QString ("urn:uuid:memory-tag-%1").arg ((i + j) % 20));
+            tag.appendChild (doc.createTextNode (
+                QString ("Memory tag %1").arg ((i + j) % 20)));
+            tags.appendChild (tag);
+        }
+        item.appendChild (tags);
+        QDomElement options = doc.createElement ("options");
+        QDomElement option = doc.createElement ("option");
+        option.setAttribute ("id", "privacy");
+        option.appendChild (doc.createTextNode ("friends"));
+        options.appendChild (option);
+        item.appendChild (options);
+
+        Media * media = new Media ();
+        QVERIFY (media->initNoTrackerInfo (item));
+        entry->appendMedia (media);
+    }
+
+    qint64 after = residentMemory ();
+    qDebug() << "Memory of" << mediaCount << "media:" << (after - before)
+        << "bytes";
+    if (before > 0 && after > 0) {
+        QVERIFY (after - before < 4 * 1024 * 1024);
+    }
+
+    QCOMPARE (entry->mediaAt(0)->mimeType().constData(),
+        entry->mediaAt(mediaCount - 1)->mimeType().constData());
+    QCOMPARE (entry->mediaAt(0)->tags().at(1).constData(),
+        entry->mediaAt(20)->tags().at(1).constData());
+
+    // Values of the removed entry are released
+    delete entry;
+    StringTable::prune ();
+    QVERIFY (StringTable::count() <= baseline);
+}
+
+void LibWebUploadTests::testMediaContentHash () {
+    QString source = QDir::homePath() +
+        "/MyDocs/.images/libwebupload-test-1536X2048.jpg";
+    QVERIFY (QFile::exists (source));
+    QString copyPath = QDir::tempPath() + "/libwebupload-test-hash.jpg";
+    QFile::remove (copyPath);
+
+    // Service selects the algorithm, SHA-1 unless md5 is asked
+    QDomDocument doc ("test");
+    QDomElement mediaTag = doc.createElement ("media");
+    WebUpload::ServicePrivate * service = new WebUpload::ServicePrivate (0);
+    service->populateMediaData (mediaTag);
+    QCOMPARE (service->m_hashAlgorithm, WebUpload::HASH_SHA1);
+    mediaTag.setAttribute ("hash", "md5");
+    service->populateMediaData (mediaTag);
+    QCOMPARE (service->m_hashAlgorithm, WebUpload::HASH_MD5);
+    mediaTag.setAttribute ("hash", "crc32");
+    service->populateMediaData (mediaTag);
+    QCOMPARE (service->m_hashAlgorithm, WebUpload::HASH_SHA1);
+    delete service;
+
+    Media media;
+    WebUpload::MediaPrivate priv (&media);
+    priv.m_hashAlgorithm = WebUpload::HASH_MD5;
+
+    // Scaled image is hashed while it is written
+    QString scaledPath = copyPath;
+    QCOMPARE (priv.scaleAndSaveImage (source, scaledPath,
+        WebUpload::IMAGE_RESIZE_SMALL), Media::COPY_RESULT_SUCCESS);
+    QCOMPARE (scaledPath, copyPath);
+    QFile scaled (scaledPath);
+    QVERIFY (scaled.open (QIODevice::ReadOnly));
+    QCOMPARE (priv.m_contentHash,
+        QCryptographicHash::hash (scaled.readAll(), QCryptographicHash::Md5));
+    scaled.close ();
+    QVERIFY (QFile::remove (scaledPath));
+
+    // No hash if the copy will be rewritten
+    priv.m_contentHash.clear ();
+    QCOMPARE (priv.scaleAndSaveImage (source, scaledPath,
+        WebUpload::IMAGE_RESIZE_SMALL, false), Media::COPY_RESULT_SUCCESS);
+    QVERIFY (priv.m_contentHash.isEmpty());
+    QVERIFY (QFile::remove (scaledPath));
+
+    // Plain copy is hashed while it is copied
+    QFile original (source);
+    QVERIFY (original.open (QIODevice::ReadOnly));
+    QByteArray md5 = QCryptographicHash::hash (original.readAll(),
+        QCryptographicHash::Md5);
+    original.close ();
+    QCOMPARE (priv.copyFile (source, copyPath), Media::COPY_RESULT_SUCCESS);
+    QCOMPARE (priv.m_contentHash, md5);
+    QVERIFY (QFile::remove (copyPath));
+    priv.m_contentHash.clear ();
+    QCOMPARE (priv.copyFile (source, copyPath, false),
+        Media::COPY_RESULT_SUCCESS);
+    QVERIFY (priv.m_contentHash.isEmpty());
+    QVERIFY (QFile::remove (copyPath));
+
+    // Hash and its algorithm are kept in the entry xml
+    Entry * entry = new Entry ();
+    Media * stored = new Media ();
+    QDomElement item = doc.createElement ("item");
+    item.setAttribute ("copy", source);
+    item.setAttribute ("mime", "image/jpeg");
+    QString hashString = "md5:" + QString::fromLatin1 (md5.toHex());
+    item.setAttribute ("hash", hashString);
+    QVERIFY (stored->initNoTrackerInfo (item));
+    QCOMPARE (stored->contentHashAlgorithm(), WebUpload::HASH_MD5);
+    QCOMPARE (stored->contentHash(), md5);
+    QCOMPARE (UploadLedger::contentHash (stored), md5);
+    entry->appendMedia (stored);
+    QCOMPARE (stored->serializeToXML (doc).attribute ("hash"), hashString);
+
+    Media * sha1Stored = new Media ();
+    QByteArray sha1 = QCryptographicHash::hash ("content",
+        QCryptographicHash::Sha1);
+    hashString = "sha1:" + QString::fromLatin1 (sha1.toHex());
+    item.setAttribute ("hash", hashString);
+    QVERIFY (sha1Stored->initNoTrackerInfo (item));
+    QCOMPARE (sha1Stored->contentHashAlgorithm(), WebUpload::HASH_SHA1);
+    QCOMPARE (sha1Stored->contentHash(), sha1);
+    entry->appendMedia (sha1Stored);
+    QCOMPARE (sha1Stored->serializeToXML (doc).attribute ("hash"),
+        hashString);
+
+    delete entry;
+}
+
+void LibWebUploadTests::testAuthCache () {
+    // Keep cached tokens of the test away from the real auth cache
+    QString settingsDir = QDir::tempPath() + "/libwebupload-tests";
+    QFile::remove (settingsDir + "/nokia/webupload-engine-auth.conf");
+    QSettings::setPath (QSettings::NativeFormat, QSettings::UserScope,
+        settingsDir);
+
+    AuthData authData;
+    authData.methodName = "oauth2";
+    authData.mechanism = "user_agent";
+    QVariantMap parameters;
+    parameters.insert ("Scope", "photos");
+    authData.sessionData = SignOn::SessionData (parameters);
+
+    AuthData widerScope = authData;
+    parameters.insert ("Scope", "photos videos");
+    widerScope.sessionData = SignOn::SessionData (parameters);
+
+    QString key = AuthBasePrivate::cacheKey (1, authData);
+    QCOMPARE (AuthBasePrivate::cacheKey (1, authData), key);
+    QVERIFY (AuthBasePrivate::cacheKey (2, authData) != key);
+    QVERIFY (AuthBasePrivate::cacheKey (1, widerScope) != key);
+
+    QVariantMap response;
+    response.insert ("AccessToken", "token");
+    response.insert ("ExpiresIn", 3600);
+    response.insert ("UserName", "user");
+    response.insert ("Secret", "password");
+    AuthBasePrivate::storeResponse (key, SignOn::SessionData (response));
+
+    // Tokens must not be readable by others
+    QSettings settings ("nokia", "webupload-engine-auth");
+    QVERIFY (settings.fileName().startsWith (settingsDir));
+    QFile::Permissions permissions = QFile::permissions (settings.fileName());
+    QVERIFY (!(permissions & (QFile::ReadGroup | QFile::WriteGroup |
+        QFile::ReadOther | QFile::WriteOther)));
+
+    // Only the token is written to disk
+    QFile settingsFile (settings.fileName());
+    QVERIFY (settingsFile.open (QIODevice::ReadOnly));
+    QByteArray stored = settingsFile.readAll ();
+    settingsFile.close ();
+    QVERIFY (stored.contains ("token"));
+    QVERIFY (!stored.contains ("UserName"));
+    QVERIFY (!stored.contains ("password"));
+
+    // Replayed response tells the time left
+    SignOn::SessionData cached;
+    QVERIFY (AuthBasePrivate::cachedResponse (key, cached));
+    QVariantMap cachedMap = cached.toMap ();
+    QCOMPARE (cachedMap.value ("AccessToken").toString(), QString ("token"));
+    QVERIFY (!cachedMap.contains ("Secret"));
+    int secondsLeft = cachedMap.value ("ExpiresIn").toInt ();
+    QVERIFY (secondsLeft > 3500 && secondsLeft <= 3600);
+
+    // Responses about to expire are refreshed through SSO
+    response.insert ("ExpiresIn", 60);
+    AuthBasePrivate::storeResponse (key, SignOn::SessionData (response));
+    QVERIFY (!AuthBasePrivate::cachedResponse (key, cached));
+
+    AuthBasePrivate::removeResponse (key);
+    QVERIFY (!AuthBasePrivate::cachedResponse (key, cached));
+
+    // Responses without an expiring token are only kept in memory
+    QVariantMap password;
+    password.insert ("UserName", "user");
+    password.insert ("Secret", "password");
+    AuthBasePrivate::storeResponse (key, SignOn::SessionData (password));
+    QVERIFY (AuthBasePrivate::cachedResponse (key, cached));
+    QCOMPARE (cached.toMap().value ("Secret").toString(),
+        QString ("password"));
+    settings.sync ();
+    QVERIFY (!settings.childGroups().contains (key));
+    QVERIFY (settingsFile.open (QIODevice::ReadOnly));
+    QVERIFY (!settingsFile.readAll().contains ("password"));
+    settingsFile.close ();
+
+    AuthBasePrivate::removeResponse (key);
+    QVERIFY (!AuthBasePrivate::cachedResponse (key, cached));
+
+    // Cached response is handed over after startAuth has returned
+    WebUpload::System system;
+    QList<QSharedPointer<WebUpload::Account> > accounts =
+        system.allAccounts ();
+    QVERIFY (!accounts.isEmpty ());
+    WebUpload::Account * account = accounts.first().data();
+    QVERIFY (account->accountsObject() != 0);
+
+    key = AuthBasePrivate::cacheKey (
+        account->accountsObject()->credentialsId(), authData);
+    response.insert ("ExpiresIn", 3600);
+    AuthBasePrivate::storeResponse (key, SignOn::SessionData (response));
+
+    DummyAuth auth (authData);
+    QSignalSpy resultSpy (&auth, SIGNAL (authResult(int)));
+    auth.startAuth (account);
+    QCOMPARE (resultSpy.count (), 0);
+    QVERIFY (auth.isAuthOngoing ());
+
+    QCoreApplication::processEvents ();
+    QCOMPARE (resultSpy.count (), 1);
+    QCOMPARE (resultSpy.takeFirst().at(0).toInt(),
+        (int)AuthBase::RESULT_SUCCESS);
+    QVERIFY (!auth.isAuthOngoing ());
+
+    // Cancel before the response is handed over
+    auth.startAuth (account);
+    auth.cancel ();
+    QCOMPARE (resultSpy.count (), 1);
+    QCOMPARE (resultSpy.takeFirst().at(0).toInt(),
+        (int)AuthBase::RESULT_CANCELED);
+    QCoreApplication::processEvents ();
+    QCOMPARE (resultSpy.count (), 0);
+
+    AuthBasePrivate::removeResponse (key);
+}
+
 void LibWebUploadTests::testError() {
     WebUpload::Error error = WebUpload::Error::connectFailure();
     QVERIFY(!error.canContinue());
@@ -1240,6 +1731,17 @@ void LibWebUploadTests::testProcessExchangeData () {
     firstArg = spyArgs[0];
     QVERIFY (firstArg.canConvert<WebUpload::Error>() == true);
     QVERIFY (firstArg.value<WebUpload::Error>().code() == WebUpload::Error::CODE_TARGET_DOES_NOT_EXIST);
+
+    QSignalSpy msSpy (&pData,
+        SIGNAL(mediaStateChangedSignal(quint32,qint32)));
+    pData.processByteArray (pData.mediaStateChanged (2,
+        WebUpload::Media::STATE_DONE));
+    QCOMPARE(msSpy.count(), 1);
+    QCOMPARE(smSpy.count(), 0);
+    spyArgs = msSpy.takeFirst ();
+    QCOMPARE (spyArgs.count(), 2);
+    QCOMPARE (spyArgs[0].value<quint32>(), (quint32)2);
+    QCOMPARE (spyArgs[1].value<qint32>(), (qint32)WebUpload::Media::STATE_DONE);
 }
 
 
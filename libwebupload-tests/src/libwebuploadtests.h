@@ -58,9 +58,15 @@ class LibWebUploadTests : public QObject {
         // Test system class
         void systemChecks();
 
+        // Test outbox index updates, repair and listing
+        void testOutboxIndex ();
+
         // Change media metadata values
         void modifyMediaFields();
 
+        // Test sharing and pruning of interned media strings
+        void testStringTable ();
+
         // Check entry metadata handling
         void entryMetadataHandling();
 
@@ -84,6 +90,18 @@ class LibWebUploadTests : public QObject {
 
                 void testHttpMultiContentIO();
 
+        void testCompressedIO ();
+
+        void testRateLimiter ();
+
+        void testUploadLedger ();
+
+        // Test content hash of media copies and its serialization
+        void testMediaContentHash ();
+
+        // Test auth response cache keys, lifetime and replay
+        void testAuthCache ();
+
                 void testError();
 
         void testErrorSerialization ();
@@ -138,6 +138,15 @@ namespace WebUpload {
          */
         virtual bool isAuthOngoing ();
 
+        /*!
+          \brief Forget the cached authentication response for the account,
+                 so that the next startAuth goes through SSO again. Called
+                 when the service rejects the token.
+          \param account Account used. If null, the account of the latest
+                         startAuth call is used.
+         */
+        void invalidateCachedAuth (WebUpload::Account * account = 0);
+
     Q_SIGNALS:
 
         /*!
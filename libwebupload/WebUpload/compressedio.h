@@ -0,0 +1,129 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _WEBUPLOAD_COMPRESSED_IO_H_
+#define _WEBUPLOAD_COMPRESSED_IO_H_
+
+#include <WebUpload/export.h>
+#include <QIODevice>
+#include <QByteArray>
+#include <QStringList>
+
+namespace WebUpload {
+
+    /* Forward declarations required */
+    class CompressedIOPrivate;
+
+    /*!
+      \class CompressedIO
+      \brief Read only QIODevice that compresses the data of another device
+             while it is read, so that the compressed payload is never kept
+             in memory. It can wrap a whole HttpMultiContentIO payload (sent
+             with the matching Content-Encoding header) or a single part
+             added with HttpMultiContentIO::addDevice.
+
+             The device is random access like HttpMultiContentIO. size() is
+             known after open() by compressing the source once without
+             storing the output, and seeking backwards starts compression
+             again from the beginning of the source.
+     */
+    class WEBUPLOAD_EXPORT CompressedIO : public QIODevice {
+
+        Q_OBJECT
+
+    public:
+
+        /*!
+          \brief Supported content encodings
+         */
+        enum Encoding {
+            ENCODING_DEFLATE, //!< zlib stream, "deflate" in HTTP
+            ENCODING_GZIP //!< gzip stream, "gzip" in HTTP
+        };
+
+        /*!
+          \brief Constructor
+          \param source Device to be compressed. CompressedIO takes the
+                        ownership of it.
+          \param encoding Encoding used
+          \param parent QObject parent
+         */
+        CompressedIO (QIODevice * source, Encoding encoding,
+            QObject * parent = 0);
+
+        /*!
+          \brief Destructor
+         */
+        virtual ~CompressedIO ();
+
+        /*!
+          \brief Encoding used
+          \return Encoding given to constructor
+         */
+        Encoding encoding () const;
+
+        /*!
+          \brief Value for the Content-Encoding header
+          \return Name of encoding used
+         */
+        QByteArray contentEncoding () const;
+
+        /*!
+          \brief Pick encoding to use with service
+          \param accepted Content encodings accepted by service, most
+                          preferred first. See Service::contentEncodings.
+          \param encoding First supported encoding is stored here
+          \return <code>true</code> if any of the encodings is supported
+         */
+        static bool preferredEncoding (const QStringList & accepted,
+            Encoding & encoding);
+
+        /*!
+          \brief Set if reads are limited by RateLimiter::shared. Reads are
+                 limited by default, while the source is read without limit.
+                 HttpMultiContentIO::addDevice turns limiting off, as the
+                 part is limited when the whole payload is read.
+          \param limited <code>true</code> to limit reads
+         */
+        void setRateLimited (bool limited);
+
+        /*! \reimp */
+        bool open (OpenMode mode);
+        void close ();
+        bool isSequential () const;
+        bool seek (qint64 pos);
+        qint64 size () const;
+        bool atEnd () const;
+        /*! \reimp_end */
+
+    protected:
+
+        /*! \reimp */
+        qint64 readData (char *data, qint64 maxlen);
+        qint64 writeData (const char *data, qint64 len);
+        /*! \reimp_end */
+
+    private:
+        Q_DISABLE_COPY(CompressedIO)
+        CompressedIOPrivate * const d_ptr; //!< Private data
+    };
+}
+
+#endif
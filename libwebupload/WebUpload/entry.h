@@ -25,6 +25,7 @@
 #include <WebUpload/Account>
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QVectorIterator>
 #include <QList>
 #include <QUrl>
@@ -178,6 +179,16 @@ namespace WebUpload {
          */
         Media * mediaAt (int index) const;
 
+        /*!
+          \brief Get media in the order they are processed and uploaded.
+                 Media are in the order they were added, unless the service
+                 of the entry allows smaller media to go first (see
+                 Service::uploadsSmallFirst). Media of same size keep their
+                 order.
+          \return Iterator to browse media in upload order
+         */
+        QVectorIterator<Media *> mediaInUploadOrder() const;
+
         /*!
           \brief  Get the pointer to the next media which has not been sent
           \param includeError parameter has value <code>true</code> if even
@@ -274,10 +285,20 @@ namespace WebUpload {
             QList <GeotagInfo> partialGeotags);
 
         /*!
-          \brief Reads tags from tracker and updates them to media
+          \brief Reads tags from tracker and updates them to media. Tags of
+                 all media are read with a single query. Tags already read
+                 by media are not read again.
         */
         void getTagsFromTracker ();
 
+        /*!
+          \brief Read tags, geotags and region metadata of all media at once.
+                 Media read these lazily on first access, so UIs showing
+                 metadata of all media should call this first. Metadata
+                 filtered by entry is not read.
+         */
+        void prefetchMetadata ();
+
 
         /*!
           \brief Get tag that are found in all media elements
@@ -315,6 +336,19 @@ namespace WebUpload {
          */
         VideoResizeOption videoResizeOption() const;
 
+        /*!
+          \brief  Get the network policy of entry
+          \return Enumeration telling over which connections entry can be
+                  uploaded
+         */
+        NetworkPolicy networkPolicy() const;
+
+        /*!
+          \brief  Get number of automatic upload retries done after failures
+          \return Number of retries
+         */
+        int retryAttempts() const;
+
         /*!
           \brief Get the metadata filter
           \return Integer value which has the bits corresponding to the
@@ -412,6 +446,22 @@ namespace WebUpload {
          */
         void appendTagToAllMedia (const QString & tag);
 
+        /*!
+          \brief Append tags to all media elements in entry. Tags are
+                 resolved with a single tracker query, independent of the
+                 number of tags and media.
+          \param tags Tracker urls of the tags to be added to media elements
+         */
+        void appendTagsToAllMedia (const QList<QUrl> & tags);
+
+        /*!
+          \brief Append tags to all media elements in entry. Tags are
+                 resolved with a single tracker query and tags not yet in
+                 tracker are created with another one.
+          \param tags String values of tags to be added to media elements
+         */
+        void appendTagsToAllMedia (const QStringList & tags);
+
         /*!
           \brief Remove tag from all media elements in entry
           \param tag Tracker url of the tag to be removed from media elements
@@ -438,6 +488,20 @@ namespace WebUpload {
          */
         void setVideoResizeOption (WebUpload::VideoResizeOption resizeOption);
 
+        /*!
+          \brief Set the network policy of entry
+          \param policy One of the WebUpload::NetworkPolicy enumerations
+         */
+        void setNetworkPolicy (WebUpload::NetworkPolicy policy);
+
+        /*!
+          \brief Set number of automatic upload retries done after failures.
+                 Stored with the entry, so the retry budget is kept over
+                 restarts of the upload engine.
+          \param attempts Number of retries
+         */
+        void setRetryAttempts (int attempts);
+
         /*!
           \brief Set metadata filter information which should be shared.
           \param metadataFilter : Integer variable whose bits are set
@@ -62,6 +62,20 @@ namespace WebUpload {
 
         VIDEO_RESIZE_N //!< Last value, do not use
     };
+
+    enum NetworkPolicy {
+        NETWORK_ANY, //!< Upload with any connection
+        NETWORK_WLAN_ONLY, //!< Do not upload with cellular connection
+
+        NETWORK_N //!< Last value, do not use
+    };
+
+    enum HashAlgorithm {
+        HASH_SHA1, //!< SHA-1, also used by UploadLedger
+        HASH_MD5, //!< MD5, e.g. for Content-MD5 checksums
+
+        HASH_N //!< Last value, do not use
+    };
 }
 
 #endif
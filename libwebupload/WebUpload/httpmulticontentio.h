@@ -170,6 +170,21 @@ namespace WebUpload {
         bool addFile(const QStringList &args, const QString &filePath,
             const QString &tmplt = QString());
 
+        /*!
+         *  \brief  Same as addFile, but the content is read from given
+         *          device. Can be used to send a part compressed with
+         *          CompressedIO.
+         * \param args The list of arguments for the template
+         * \param device Device whose content need to be sent. Has to be
+         *               random access. HttpMultiContentIO takes the
+         *               ownership of the device.
+         * \param tmplt Optional string parameter to over-ride the default
+         *              template string.
+         * \return Boolean value signifying success or failure
+         */
+        bool addDevice(const QStringList &args, QIODevice *device,
+            const QString &tmplt = QString());
+
         /*!
            \brief  Function to tell the IODevice that all information required
                    for upload has been added and no more data will be added. No
@@ -183,6 +198,20 @@ namespace WebUpload {
         void allDataAdded();
 
 
+        /*!
+          \brief Set if reads are limited by RateLimiter::shared. Reads are
+                 limited by default. Limiting is turned off for devices read
+                 by another limited device, see CompressedIO.
+          \param limited <code>true</code> to limit reads
+         */
+        void setRateLimited (bool limited);
+
+        /*!
+          \brief Check if reads are limited by RateLimiter::shared
+          \return <code>true</code> if reads are limited
+         */
+        bool isRateLimited () const;
+
         /*! \reimp */
         bool open(OpenMode mode);
         void close();
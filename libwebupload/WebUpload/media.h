@@ -90,7 +90,8 @@ namespace WebUpload {
         /*!
           \brief Initial media with given values. Given values has to be valid.
                  This function skips many tracker queries and so is fasted than
-                 normal init with Tracker URI.
+                 normal init with Tracker URI. Tags and geotag are read from
+                 tracker when those are first needed.
           \param tIri IRI to file information in tracker
           \param fileUri Files URI
           \param mimeType Mime type of the file
@@ -153,6 +154,21 @@ namespace WebUpload {
           \return Path to file if there is copy file made. Empty string if not.
          */
         QString copyFilePath() const;
+
+        /*!
+          \brief Get hash of copy file content. Hash is calculated while the
+                 copy is being made, so getting it does not read the file.
+          \return Hash of copy file, empty if there is no copy file or hash
+                  was not calculated
+         */
+        QByteArray contentHash() const;
+
+        /*!
+          \brief Get algorithm used for contentHash. Defined by the service
+                 of entry, see Service::contentHashAlgorithm.
+          \return Hash algorithm
+         */
+        HashAlgorithm contentHashAlgorithm() const;
         
         /*!
           \brief Get copied data content. This is non file data given as upload
@@ -164,6 +180,32 @@ namespace WebUpload {
 
         //! \brief Read state of the media from tracker and set it here
         void refreshStateFromTracker ();
+
+        //! Transfer states of media, as reported between processes
+        enum State {
+            STATE_PENDING = 0, //!< Media is waiting to be sent
+            STATE_ACTIVE, //!< Media is being sent
+            STATE_PAUSED, //!< Sending of media has been paused
+            STATE_DONE, //!< Media has been sent
+            STATE_CANCELLED, //!< Sending of media has been cancelled
+            STATE_FAILED //!< Last attempt to send media failed
+        };
+
+        /*!
+          \brief Current transfer state of the media
+          \return State of the media
+         */
+        State state() const;
+
+        /*!
+          \brief Set state of the media to state reported by the process that
+                 changed it. Unlike the set* functions, tracker is not updated,
+                 since the reporting process has already done that. Used by
+                 webupload-engine to keep its copy of the media up to date
+                 without reading the state back from tracker.
+          \param state New state of the media
+         */
+        void refreshState (State state);
         
         //! Media types
         enum Type {
@@ -238,8 +280,9 @@ namespace WebUpload {
         QString description(bool getMetadataValue) const;
                        
         /*!
-          \brief Get tags
-          \return Tags of media in a stringlist
+          \brief Get tags. Tags are read from tracker on first call if media
+                 was initialized from tracker (see Entry::prefetchMetadata).
+          \return Tags of media in a stringlist. Empty if tags are filtered.
          */
         QStringList tags () const;
 
@@ -258,10 +301,11 @@ namespace WebUpload {
         QList<QUrl> tagUrls() const;
 
         /*!
-          \brief Reads region metadata from the media
+          \brief Reads region metadata from the media. Metadata is read from
+                 the file on first call and cached.
           \param regionType Type of region metadata to return.
             If empty, all types of region metadata is returned.
-          \return List of region metadata
+          \return List of region metadata. Empty if regions are filtered.
          */
         QuillMetadataRegionList regionMetadata(const QString &regionType = "") const;
         
@@ -294,6 +338,18 @@ namespace WebUpload {
           \return <code>CopyResult</code> result of copy
          */            
         CopyResult makeCopy(const QString &path = "");
+
+        /*!
+          \brief Make copy from original file with given image resize
+                 option instead of the one of the entry. Option stored in
+                 the entry is not changed.
+          \param path Where copy should be done. If empty then default path
+                      is used.
+          \param imageResizeOption Resize option used if media is an image
+          \return <code>CopyResult</code> result of copy
+         */
+        CopyResult makeCopy(const QString &path,
+            ImageResizeOption imageResizeOption);
         
         /*!
           \brief Is media still in pending state
@@ -420,7 +476,8 @@ namespace WebUpload {
         /*!
           \brief Get the geotag information associated with this media
                  There can be only one distinct country,city,district triple
-                 associated with a media at any point of time.
+                 associated with a media at any point of time. Geotag is read
+                 from tracker on first call, unless all metadata is filtered.
           \return The GeotagInfo instance containing geotag information
                   associated with the media.
          */
@@ -568,6 +625,8 @@ namespace WebUpload {
         void tagsChanged (QList<QUrl> tags);                   
 
     private:
+
+        friend class EntryPrivate;
                 
         MediaPrivate * const d_ptr; //!< Private data of class
     };
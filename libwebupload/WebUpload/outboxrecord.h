@@ -0,0 +1,121 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _WEBUPLOAD_OUTBOX_RECORD_H_
+#define _WEBUPLOAD_OUTBOX_RECORD_H_
+
+#include <WebUpload/export.h>
+#include <QString>
+#include <QDateTime>
+
+namespace WebUpload {
+
+    class OutboxIndex;
+
+    /*!
+      \class OutboxRecord
+      \brief Lightweight description of an entry stored to outbox. Records are
+             read from the outbox index so that the entry itself does not
+             have to be loaded (no XML parsing or tracker queries).
+             Use WebUpload::Entry::init with path() when the full entry is
+             needed.
+     */
+    class WEBUPLOAD_EXPORT OutboxRecord {
+
+    public:
+
+        OutboxRecord ();
+
+        /*!
+          \brief Check if record points to an entry
+          \return <code>true</code> if record has a path
+         */
+        bool isValid () const;
+
+        /*!
+          \brief Path of the serialized entry
+          \return Full path to entry file
+         */
+        const QString & path () const;
+
+        /*!
+          \brief When entry was created
+          \return Creation time of the entry
+         */
+        const QDateTime & created () const;
+
+        /*!
+          \brief Id of account related to entry
+          \return String id of account, same as WebUpload::Entry::accountId
+         */
+        const QString & accountId () const;
+
+        /*!
+          \brief Total size of the media in the entry
+          \return Size in bytes, same as WebUpload::Entry::totalSize
+         */
+        qint64 totalSize () const;
+
+        /*!
+          \brief See WebUpload::Entry::isPending
+         */
+        bool isPending () const;
+
+        /*!
+          \brief See WebUpload::Entry::isActive
+         */
+        bool isActive () const;
+
+        /*!
+          \brief See WebUpload::Entry::isPaused
+         */
+        bool isPaused () const;
+
+        /*!
+          \brief See WebUpload::Entry::hasError
+         */
+        bool hasError () const;
+
+        /*!
+          \brief See WebUpload::Entry::isSent
+         */
+        bool isSent () const;
+
+        /*!
+          \brief See WebUpload::Entry::isCanceled
+         */
+        bool isCanceled () const;
+
+    private:
+
+        friend class OutboxIndex;
+
+        QString m_path; //!< Full path of the entry file
+        QDateTime m_created; //!< Creation time of entry
+        QString m_accountId; //!< Account id of entry
+        qint64 m_totalSize; //!< Total size of media
+        int m_state; //!< WebUpload::TransferState of entry
+        bool m_failed; //!< Failed flag of entry
+
+        //! Modification time of entry file when record was written
+        QDateTime m_modified;
+    };
+}
+
+#endif
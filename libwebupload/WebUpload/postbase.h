@@ -196,6 +196,17 @@ namespace WebUpload {
          */
         virtual void stopMediaUpload() = 0;
 
+        /*!
+          \brief Skip media which is already found in the UploadLedger of the
+                 account. Skipped media are marked done with the url stored
+                 when they were sent. Off by default, plugins should only
+                 enable this if the service keeps uploaded content. Media
+                 which reached the service but were reported failed are
+                 not in the ledger, so they are still sent again.
+          \param skip <code>true</code> to skip already sent content
+         */
+        void setSkipDuplicates (bool skip);
+
      protected Q_SLOTS:
 
         /*!
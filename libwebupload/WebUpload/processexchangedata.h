@@ -108,6 +108,15 @@ namespace WebUpload {
          */
         static QByteArray stop ();
 
+        /*!
+          \brief Function called by the webupload-engine to limit the rate at
+                 which the upload process sends data. Can be called any time
+                 during the upload. See RateLimiter.
+          \param bytesPerSecond Maximum rate, 0 if there is no limit
+          \return QByteArray corresponding to the rateLimit request
+         */
+        static QByteArray rateLimit (qint64 bytesPerSecond);
+
         //------- FUNCTIONS CALLED FROM HANDLER PROCESS ---------------------
 
         /*!
@@ -119,6 +128,17 @@ namespace WebUpload {
          */
         static QByteArray sendingMedia (quint32 index);
 
+        /*!
+          \brief Function called by the upload process when the state of one
+                 of the media in the entry has changed. This allows the
+                 webupload-engine to keep its copy of the entry up to date
+                 without reading the state back from tracker
+          \param index Index of the media whose state changed
+          \param state New state of the media. One of Media::State values
+          \return QByteArray corresponding to the mediaStateChanged request
+         */
+        static QByteArray mediaStateChanged (quint32 index, qint32 state);
+
         /*!
           \brief Function called by the upload process giving the current
                  progress
@@ -282,6 +302,13 @@ namespace WebUpload {
          */
         void stopSignal ();
 
+        /*! 
+          \brief Signal emitted when the byte array recieved corresponds to the
+                 rateLimit request
+          \param bytesPerSecond Maximum rate, 0 if there is no limit
+         */
+        void rateLimitSignal (qint64 bytesPerSecond);
+
         /*! 
           \brief Signal emitted when the byte array recieved corresponds to the
                  sendMedia request
@@ -289,6 +316,14 @@ namespace WebUpload {
          */
         void sendingMediaSignal (quint32 index);
 
+        /*! 
+          \brief Signal emitted when the byte array recieved corresponds to the
+                 mediaStateChanged request
+          \param index Index of the media whose state changed
+          \param state New state of the media. One of Media::State values
+         */
+        void mediaStateChangedSignal (quint32 index, qint32 state);
+
         /*! 
           \brief Signal emitted when the byte array recieved corresponds to the
                  progress request
@@ -0,0 +1,95 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _WEBUPLOAD_RATE_LIMITER_H_
+#define _WEBUPLOAD_RATE_LIMITER_H_
+
+#include <WebUpload/export.h>
+#include <QObject>
+
+class QIODevice;
+
+namespace WebUpload {
+
+    /* Forward declarations required */
+    class RateLimiterPrivate;
+
+    /*!
+      \class RateLimiter
+      \brief Token bucket limiting how fast request bodies are read by the
+             network. HttpMultiContentIO and CompressedIO ask the shared
+             limiter how much they may read, so a rate set for the plugin
+             process caps the throughput of all its uploads. The upload
+             engine sets the rate, see ProcessExchangeData::rateLimit.
+     */
+    class WEBUPLOAD_EXPORT RateLimiter : public QObject {
+
+        Q_OBJECT
+
+    public:
+
+        /*!
+          \brief Constructor
+          \param parent QObject parent
+         */
+        RateLimiter (QObject * parent = 0);
+
+        /*!
+          \brief Destructor
+         */
+        virtual ~RateLimiter ();
+
+        /*!
+          \brief Limiter shared by all uploads of the process
+          \return Shared limiter, owned by the application object
+         */
+        static RateLimiter * shared ();
+
+        /*!
+          \brief Set rate limit. Change takes effect immediately, also for
+                 reads already waiting.
+          \param bytesPerSecond Maximum rate, 0 if there is no limit
+         */
+        void setRate (qint64 bytesPerSecond);
+
+        /*!
+          \brief Current rate limit
+          \return Bytes per second, 0 if there is no limit
+         */
+        qint64 rate () const;
+
+        /*!
+          \brief Take bytes for a read from the bucket. If nothing can be
+                 read now, readyRead of the device is emitted when there are
+                 enough bytes in the bucket again.
+          \param device Device being read
+          \param maxlen Number of bytes the reader would like to read
+          \return Number of bytes that can be read now, 0 if the reader has
+                  to wait
+         */
+        qint64 take (QIODevice * device, qint64 maxlen);
+
+    private:
+        Q_DISABLE_COPY(RateLimiter)
+        RateLimiterPrivate * const d_ptr; //!< Private data
+    };
+}
+
+#endif
@@ -22,13 +22,19 @@
 #define _WEBUPLOAD_SERVICE_H_
 
 #include "WebUpload/export.h"
+#include "WebUpload/enums.h"
 #include <QObject>
 #include <QString>
 #include <QListIterator>
+#include <QStringList>
 #include <QDomDocument>
 #include "WebUpload/PostOption"
 #include <Accounts/Service>
 
+#ifdef UNIT_TESTING
+class WUEngineTests;
+#endif
+
 namespace WebUpload {
 
     class Account;
@@ -183,6 +189,50 @@ namespace WebUpload {
          */
         unsigned int maxMediaSizeLimit() const;
 
+        /*!
+          \brief Get content encodings the service accepts for request
+                 bodies, defined with the compression attribute of the media
+                 tag. See CompressedIO::preferredEncoding.
+          \return Encoding names, most preferred first. Empty if requests
+                  should not be compressed.
+         */
+        QStringList contentEncodings() const;
+
+        /*!
+          \brief Get maximum size of single upload (entry) to this service
+                 over cellular connection, defined with the cellularSize
+                 attribute of the media tag.
+          \return Maximum size in bytes. Or 0 if no limit defined.
+         */
+        qint64 cellularSizeLimit() const;
+
+        /*!
+          \brief Check if media of given type is uploaded to this service only
+                 over WLAN. Types are listed in the wlanOnly attribute of the
+                 media tag, e.g. "video" or "video/mp4".
+          \param mimeType Mime type of media
+          \return <code>true</code> if media can't be uploaded over cellular
+                  connection
+         */
+        bool isWlanOnly (const QString & mimeType) const;
+
+        /*!
+          \brief Check if small media may be processed and uploaded to this
+                 service before large ones. Defined with smallFirst="true"
+                 in the media tag. If not set, media are uploaded in the
+                 order they were added.
+          \return <code>true</code> if upload order may follow media size
+         */
+        bool uploadsSmallFirst() const;
+
+        /*!
+          \brief Get algorithm used for content hashes of media copies sent
+                 to this service, defined with the hash attribute of the media
+                 tag ("sha1" or "md5"). See Media::contentHash.
+          \return Hash algorithm, HASH_SHA1 if not defined
+         */
+        HashAlgorithm contentHashAlgorithm() const;
+
         /*!
           \brief Give name for share button when entry defined is given. This
                  function is not currently implemented but is here to allow
@@ -196,6 +246,10 @@ namespace WebUpload {
     private:
         Q_DISABLE_COPY(Service)
         ServicePrivate * const d_ptr; //!< Private data
+
+#ifdef UNIT_TESTING
+        friend class ::WUEngineTests; //!< For bearer policy tests
+#endif
     };
 }
 
@@ -29,6 +29,7 @@
 #include <WebUpload/Service>
 #include <WebUpload/Entry>
 #include <WebUpload/Account>
+#include <WebUpload/OutboxRecord>
 #include <Accounts/Manager>
 
 namespace WebUpload {
@@ -92,10 +93,22 @@ namespace WebUpload {
         QString serializeEntryToOutbox (Entry * entry);
         
         /*!
-          \brief Read entries found in outbox
-          \return List of entries found
+          \brief Read unfinished entries found in outbox. This will fully
+                 load the entries. Use outboxIndex if only basic information
+                 is needed.
+          \return List of entries found, oldest first
          */
         QList <QSharedPointer<Entry> > outboxEntries ();
+
+        /*!
+          \brief Read records of entries found in outbox from outbox index.
+                 Entries are only loaded if index is missing information of
+                 them or if entry has been modified after it was indexed.
+                 Index is repaired in those cases. Sent and cancelled entries
+                 are not listed.
+          \return List of records, oldest entry first
+         */
+        QList <OutboxRecord> outboxIndex ();
         
         /*!
           \brief Get all accounts of WebUpload. Use this only in case
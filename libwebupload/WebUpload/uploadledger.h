@@ -0,0 +1,123 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _WEBUPLOAD_UPLOAD_LEDGER_H_
+#define _WEBUPLOAD_UPLOAD_LEDGER_H_
+
+#include <WebUpload/export.h>
+#include <QString>
+#include <QByteArray>
+
+namespace WebUpload {
+
+    /* Forward declarations required */
+    class UploadLedgerPrivate;
+    class Media;
+
+    /*!
+      \class UploadLedger
+      \brief Local record of files uploaded to an account. Files are keyed
+             by hash of their content, so a file sent again after a failed
+             retry or a new share can be recognized even if its path has
+             changed. PostBase records every media it has sent.
+
+             Media are recorded only when the plugin reports them done.
+             Content the server accepted but the plugin then reported as
+             failed, e.g. because the connection broke before the response
+             came, is not in the ledger and will be sent again.
+     */
+    class WEBUPLOAD_EXPORT UploadLedger {
+
+    public:
+
+        /*!
+          \brief Constructor
+          \param accountId String id of account (see Account::stringId)
+         */
+        UploadLedger (const QString & accountId);
+
+        /*!
+          \brief Destructor
+         */
+        ~UploadLedger ();
+
+        /*!
+          \brief Calculate hash of file content. Reads the whole file, so
+                 avoid calling it from the main thread for large files.
+          \param filePath Path to file
+          \return SHA-1 hash of file, empty if file can't be read
+         */
+        static QByteArray contentHash (const QString & filePath);
+
+        /*!
+          \brief Get hash of content uploaded for media. This is
+                 Media::contentHash calculated while the copy was made, with
+                 the algorithm of the service (see
+                 Service::contentHashAlgorithm), so the copy file is not read
+                 again. All media of an account use the same algorithm.
+          \param media Media
+          \return Hash of copy file of media, empty if media has no copy file
+                  or its hash was not calculated. Empty hashes are never
+                  recorded or found.
+         */
+        static QByteArray contentHash (const Media * media);
+
+        /*!
+          \brief Check if content has been uploaded to account
+          \param hash Content hash
+          \return <code>true</code> if content is in the ledger
+         */
+        bool contains (const QByteArray & hash) const;
+
+        /*!
+          \brief Get where content was uploaded
+          \param hash Content hash
+          \return Url given for uploaded content. Empty if not known.
+         */
+        QString destination (const QByteArray & hash) const;
+
+        /*!
+          \brief Record uploaded content. If ledger is full, oldest record
+                 is dropped.
+          \param hash Content hash
+          \param destUrl Url where content can be found, can be empty
+         */
+        void record (const QByteArray & hash, const QString & destUrl);
+
+        /*!
+          \brief Remove content from ledger, e.g. when it is known to be
+                 removed from the service
+          \param hash Content hash
+         */
+        void remove (const QByteArray & hash);
+
+        /*!
+          \brief Check if anything has been recorded for account
+          \return <code>true</code> if ledger is empty
+         */
+        bool isEmpty () const;
+
+    private:
+        Q_DISABLE_COPY(UploadLedger)
+        UploadLedgerPrivate * const d_ptr; //!< Private data
+    };
+}
+
+#endif
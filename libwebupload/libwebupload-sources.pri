@@ -3,6 +3,9 @@ include (../config-flags.pri)
 # Macro to disable space check. This does not work correctly right now
 DEFINES += DONT_CHECK_EMPTY_SPACE
 
+# zlib for CompressedIO
+LIBS += -lz
+
 HEADERS += WebUpload/account.h \
            accountprivate.h \
            WebUpload/entry.h \
@@ -25,6 +28,12 @@ HEADERS += WebUpload/account.h \
            internalenums.h \
            WebUpload/error.h \
            WebUpload/httpmulticontentio.h \
+           WebUpload/compressedio.h \
+           compressedioprivate.h \
+           WebUpload/ratelimiter.h \
+           ratelimiterprivate.h \
+           WebUpload/uploadledger.h \
+           uploadledgerprivate.h \
            WebUpload/pluginbase.h \
            WebUpload/postinterface.h \
            WebUpload/updateinterface.h \
@@ -48,7 +57,10 @@ HEADERS += WebUpload/account.h \
            updateprocessprivate.h \
            connectionmanager.h \
            connectionmanagerprivate.h \
-           WebUpload/geotaginfo.h
+           WebUpload/geotaginfo.h \
+           WebUpload/outboxrecord.h \
+           outboxindex.h \
+           stringtable.h
            
 
 SOURCES += account.cpp \
@@ -68,6 +80,9 @@ SOURCES += account.cpp \
            internalenums.cpp \
            error.cpp \
            httpmulticontentio.cpp \
+           compressedio.cpp \
+           ratelimiter.cpp \
+           uploadledger.cpp \
            pluginbase.cpp \
            postinterface.cpp \
            updateinterface.cpp \
@@ -81,5 +96,7 @@ SOURCES += account.cpp \
            pluginprocess.cpp \
            updateprocess.cpp \
            connectionmanager.cpp \
-           geotaginfo.cpp
+           geotaginfo.cpp \
+           outboxindex.cpp \
+           stringtable.cpp
            
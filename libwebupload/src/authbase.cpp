@@ -21,9 +21,25 @@
 #include "WebUpload/authbase.h"
 #include "authbaseprivate.h"
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QSettings>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace WebUpload;
 
+// Lifetime of responses that do not tell when they expire. These are only
+// kept in memory.
+#define AUTH_CACHE_DEFAULT_LIFETIME 900
+// Responses this close to expiry are refreshed before use
+#define AUTH_CACHE_REFRESH_MARGIN 120
+
 AuthBase::AuthBase (QObject *parent) : QObject (parent), 
     d_ptr (new AuthBasePrivate(this)) {
 
@@ -67,6 +83,24 @@ void AuthBase::startAuth (WebUpload::Account * account) {
         return;
     }
 
+    d_ptr->account = account;
+    d_ptr->currentKey = AuthBasePrivate::cacheKey (
+        account->accountsObject()->credentialsId(), authData);
+
+    // Reuse the previous response while it is valid, saves a SSO round trip
+    // for each media of the transfer. It is handed over after this function
+    // has returned, like a response from SSO would be.
+    if (AuthBasePrivate::cachedResponse (d_ptr->currentKey,
+        d_ptr->cachedData)) {
+
+        qDebug() << "Using cached auth response";
+        d_ptr->requestInProgress = true;
+        d_ptr->replayingCache = true;
+        QMetaObject::invokeMethod (d_ptr, "replayCachedResponse",
+            Qt::QueuedConnection);
+        return;
+    }
+
     if (d_ptr->identity == 0) {
         d_ptr->identity = SignOn::Identity::existingIdentity (
             account->accountsObject()->credentialsId(), this);
@@ -91,7 +125,6 @@ void AuthBase::startAuth (WebUpload::Account * account) {
         return;
     }
 
-    d_ptr->account = account;
     connect (d_ptr->session, SIGNAL (response(SignOn::SessionData)), d_ptr, 
         SLOT (sessionResponse(SignOn::SessionData)));
     connect (d_ptr->session, SIGNAL (error(SignOn::Error)), d_ptr, 
@@ -103,7 +136,12 @@ void AuthBase::startAuth (WebUpload::Account * account) {
 
 
 void AuthBase::cancel () {
-    if (isAuthOngoing ()) {
+    if (d_ptr->replayingCache) {
+        qDebug() << "Cancel cached auth response";
+        d_ptr->replayingCache = false;
+        d_ptr->requestInProgress = false;
+        Q_EMIT (authResult(RESULT_CANCELED));
+    } else if (isAuthOngoing ()) {
         qDebug() << "Cancel auth request";
         d_ptr->session->cancel ();
         d_ptr->requestInProgress = false;
@@ -114,6 +152,20 @@ bool AuthBase::isAuthOngoing () {
     return d_ptr->requestInProgress;
 }
 
+void AuthBase::invalidateCachedAuth (WebUpload::Account * account) {
+    QString key = d_ptr->currentKey;
+
+    if ((account != 0) && (account->accountsObject() != 0)) {
+        key = AuthBasePrivate::cacheKey (
+            account->accountsObject()->credentialsId(), getAuthData());
+    }
+
+    if (!key.isEmpty()) {
+        qDebug() << "Invalidate cached auth response";
+        AuthBasePrivate::removeResponse (key);
+    }
+}
+
 
 bool AuthBase::isAuthRequired () {
     // Default implementation - no authentication is required
@@ -149,6 +201,7 @@ AuthBasePrivate::AuthBasePrivate (AuthBase * parent) : QObject (parent),
     identity (0), account (0),
     retryOnUnknownError(true),
     requestInProgress(false),
+    replayingCache(false),
     authBaseObject (parent)
 {
 
@@ -170,9 +223,186 @@ void AuthBasePrivate::clearAuthInformation () {
     }
 }
 
+QString AuthBasePrivate::cacheKey (quint32 credentialsId,
+    const AuthData & authData) {
+
+    // Session parameters such as the requested scope change what the token
+    // is good for. They may hold client secrets, so only a hash of them
+    // goes to the key.
+    QByteArray parameters;
+    QDataStream stream (&parameters, QIODevice::WriteOnly);
+    stream << authData.sessionData.toMap ();
+    QByteArray parameterHash = QCryptographicHash::hash (parameters,
+        QCryptographicHash::Sha1).toHex ();
+
+    QString key ("%1-%2-%3-%4");
+    key = key.arg (credentialsId).arg (authData.methodName)
+        .arg (authData.mechanism).arg (QString (parameterHash));
+
+    // Keep the key on one level in QSettings
+    key.replace ('/', '_');
+    return key;
+}
+
+namespace {
+    // Response cached for this process only
+    struct MemoryResponse {
+        QDateTime expires;
+        QVariantMap data;
+    };
+
+    QHash<QString, MemoryResponse> memoryResponses;
+
+    // Fields of an OAuth 2 response written to disk. Anything else, such
+    // as the user name and secret of password based methods, stays in
+    // memory.
+    const char * const STORED_FIELDS[] = {
+        "AccessToken", "TokenType", "ExpiresIn"
+    };
+}
+
+/*!
+  \brief Hand over response if it is not about to expire
+  \param expires Expiry time of the response
+  \param data Response
+  \param sessionData Response is stored here
+  \return <code>true</code> if the response was handed over
+ */
+static bool validResponse (const QDateTime & expires, QVariantMap data,
+    SignOn::SessionData & sessionData) {
+
+    if (!expires.isValid()) {
+        return false;
+    }
+
+    if (QDateTime::currentDateTime().addSecs (AUTH_CACHE_REFRESH_MARGIN) >=
+        expires) {
+
+        qDebug() << "Cached auth response expires at" << expires;
+        return false;
+    }
+
+    // Tell the time left, not the lifetime the token had when it was issued
+    if (data.contains ("ExpiresIn")) {
+        data.insert ("ExpiresIn",
+            QDateTime::currentDateTime().secsTo (expires));
+    }
+
+    sessionData = SignOn::SessionData (data);
+    return true;
+}
+
+bool AuthBasePrivate::cachedResponse (const QString & key,
+    SignOn::SessionData & sessionData) {
+
+    QHash<QString, MemoryResponse>::const_iterator memory =
+        memoryResponses.constFind (key);
+    if (memory != memoryResponses.constEnd()) {
+        return validResponse (memory->expires, memory->data, sessionData);
+    }
+
+    QSettings settings ("nokia", "webupload-engine-auth");
+    settings.beginGroup (key);
+    return validResponse (settings.value ("expires").toDateTime (),
+        settings.value ("data").toMap (), sessionData);
+}
+
+void AuthBasePrivate::storeResponse (const QString & key,
+    const SignOn::SessionData & sessionData) {
+
+    if (key.isEmpty()) {
+        return;
+    }
+
+    QVariantMap data = sessionData.toMap ();
+
+    // OAuth 2 responses tell their lifetime in seconds
+    bool ok = false;
+    int lifetime = data.value ("ExpiresIn").toInt (&ok);
+    bool persistent = ok && lifetime > 0 && data.contains ("AccessToken");
+
+    if (!persistent) {
+        // Without a token that expires the response may hold the password,
+        // so it is never written to disk
+        removeResponse (key);
+        MemoryResponse & memory = memoryResponses[key];
+        memory.expires = QDateTime::currentDateTime().addSecs (
+            AUTH_CACHE_DEFAULT_LIFETIME);
+        memory.data = data;
+        return;
+    }
+
+    memoryResponses.remove (key);
+
+    QVariantMap token;
+    for (unsigned int i = 0;
+        i < sizeof (STORED_FIELDS) / sizeof (STORED_FIELDS[0]); ++i) {
+
+        if (data.contains (STORED_FIELDS[i])) {
+            token.insert (STORED_FIELDS[i], data.value (STORED_FIELDS[i]));
+        }
+    }
+
+    QSettings settings ("nokia", "webupload-engine-auth");
+
+    // Tokens are as good as passwords. The file is made owner only before
+    // anything is written to it, QSettings keeps the permissions.
+    if (!createPrivateFile (settings.fileName())) {
+        qWarning() << "Could not create" << settings.fileName()
+            << "- auth response not cached";
+        return;
+    }
+
+    settings.beginGroup (key);
+    settings.setValue ("expires",
+        QDateTime::currentDateTime().addSecs (lifetime));
+    settings.setValue ("data", token);
+    settings.endGroup ();
+    settings.sync ();
+}
+
+bool AuthBasePrivate::createPrivateFile (const QString & path) {
+    QDir().mkpath (QFileInfo (path).absolutePath());
+
+    int fd = ::open (QFile::encodeName (path).constData(),
+        O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        return false;
+    }
+
+    // File may have been created earlier with wider permissions
+    bool ok = (::fchmod (fd, S_IRUSR | S_IWUSR) == 0);
+    ::close (fd);
+    return ok;
+}
+
+void AuthBasePrivate::removeResponse (const QString & key) {
+    // Empty key would remove everything
+    if (key.isEmpty()) {
+        return;
+    }
+
+    memoryResponses.remove (key);
+
+    QSettings settings ("nokia", "webupload-engine-auth");
+    settings.remove (key);
+}
+
+void AuthBasePrivate::replayCachedResponse () {
+    // Canceled while waiting
+    if (!replayingCache) {
+        return;
+    }
+
+    replayingCache = false;
+    requestInProgress = false;
+    authBaseObject->handleResponse (cachedData);
+}
+
 void AuthBasePrivate::sessionResponse (const SignOn::SessionData &sessionData) {
     requestInProgress = false;
     clearAuthInformation();
+    storeResponse (currentKey, sessionData);
     authBaseObject->handleResponse (sessionData);
 }
 
@@ -200,6 +430,7 @@ void AuthBasePrivate::sessionError (const SignOn::Error & err) {
         case SignOn::Error::InvalidCredentials:
         case SignOn::Error::NotAuthorized:
         case SignOn::Error::UserInteraction:
+            removeResponse (currentKey);
             Q_EMIT (authResult (AuthBase::RESULT_UNAUTHORIZED));
             break;
 
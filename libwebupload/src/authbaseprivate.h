@@ -22,7 +22,9 @@
 #define _AUTH_BASE_PRIVATE_H_
 
 #include <QObject>
+#include <QDateTime>
 #include <WebUpload/Account>
+#include <WebUpload/AuthBase>
 #include <identity.h>
 #include <authsession.h>
 
@@ -52,9 +54,62 @@ namespace WebUpload {
           \brief Destroy the identity and session information
          */
         void clearAuthInformation ();
+
+        /*!
+          \brief Key for the response cache
+          \param credentialsId Credentials id of the account used
+          \param authData Authentication information from the plugin
+          \return Key built from credentials id, method, mechanism and a
+                  hash of the session parameters
+         */
+        static QString cacheKey (quint32 credentialsId,
+            const AuthData & authData);
+
+        /*!
+          \brief Get cached response that is still valid
+          \param key Key from cacheKey
+          \param sessionData Cached response is stored here
+          \return <code>true</code> if valid response was found. Responses
+                  about to expire are not returned, so that they are
+                  refreshed in time. ExpiresIn of the returned response
+                  tells the seconds left.
+         */
+        static bool cachedResponse (const QString & key,
+            SignOn::SessionData & sessionData);
+
+        /*!
+          \brief Store response to cache. Only OAuth 2 tokens with a known
+                 lifetime are written to disk, and only their token fields.
+                 Other responses are cached in memory for this process.
+          \param key Key from cacheKey
+          \param sessionData Response from SSO
+         */
+        static void storeResponse (const QString & key,
+            const SignOn::SessionData & sessionData);
+
+        /*!
+          \brief Remove response from cache
+          \param key Key from cacheKey
+         */
+        static void removeResponse (const QString & key);
+
+        /*!
+          \brief Create file readable and writable by the owner only, or
+                 restrict the permissions of an existing file
+          \param path File path
+          \return <code>true</code> on success
+         */
+        static bool createPrivateFile (const QString & path);
     
     public Q_SLOTS:
 
+        /*!
+          \brief Hand the cached response to the plugin. Queued from
+                 AuthBase::startAuth so that the result is not emitted
+                 before startAuth returns.
+         */
+        void replayCachedResponse ();
+
         /*!
           \brief Slot to get response from Signon for the authentication
                  request
@@ -91,6 +146,9 @@ namespace WebUpload {
         WebUpload::Account * account; //!< Account owned
         bool retryOnUnknownError;
         bool requestInProgress;
+        QString currentKey; //!< Cache key of the ongoing or latest request
+        bool replayingCache; //!< Cached response waits to be handed over
+        SignOn::SessionData cachedData; //!< Cached response to hand over
 
     private:
         AuthBase * const authBaseObject; //!< Public parent object
@@ -0,0 +1,327 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "WebUpload/CompressedIO"
+#include "compressedioprivate.h"
+#include "WebUpload/HttpMultiContentIO"
+#include "WebUpload/RateLimiter"
+#include <QDebug>
+#include <string.h>
+
+using namespace WebUpload;
+
+// Amount of source data compressed at a time
+#define COMPRESS_CHUNK_SIZE 16384
+// Window bits of zlib, 16 added to get gzip header and trailer
+#define ZLIB_WINDOW_BITS 15
+#define GZIP_WINDOW_BITS (ZLIB_WINDOW_BITS + 16)
+
+CompressedIO::CompressedIO (QIODevice * source, Encoding encoding,
+    QObject * parent) : QIODevice (parent),
+    d_ptr (new CompressedIOPrivate (source, encoding)) {
+
+    if (source != 0) {
+        source->setParent (this);
+
+        // Source is read also to count the size, only output is limited
+        HttpMultiContentIO * multi = qobject_cast<HttpMultiContentIO *>(source);
+        if (multi != 0) {
+            multi->setRateLimited (false);
+        }
+    }
+}
+
+CompressedIO::~CompressedIO () {
+    delete d_ptr;
+}
+
+CompressedIO::Encoding CompressedIO::encoding () const {
+    return d_ptr->encoding;
+}
+
+QByteArray CompressedIO::contentEncoding () const {
+    if (d_ptr->encoding == ENCODING_GZIP) {
+        return "gzip";
+    }
+
+    return "deflate";
+}
+
+bool CompressedIO::preferredEncoding (const QStringList & accepted,
+    Encoding & encoding) {
+
+    foreach (QString name, accepted) {
+        name = name.trimmed().toLower();
+
+        if (name == QLatin1String ("gzip")) {
+            encoding = ENCODING_GZIP;
+            return true;
+        } else if (name == QLatin1String ("deflate")) {
+            encoding = ENCODING_DEFLATE;
+            return true;
+        }
+
+        qDebug() << "Content encoding" << name << "not supported";
+    }
+
+    return false;
+}
+
+void CompressedIO::setRateLimited (bool limited) {
+    d_ptr->rateLimited = limited;
+}
+
+bool CompressedIO::open (OpenMode mode) {
+    if (isOpen()) {
+        qWarning() << "CompressedIO::open - device already open";
+        return false;
+    }
+
+    if (mode & QIODevice::WriteOnly) {
+        qWarning() << "CompressedIO can only be opened for reading";
+        return false;
+    }
+
+    if (d_ptr->source == 0) {
+        qWarning() << "CompressedIO without source";
+        return false;
+    }
+
+    if (!d_ptr->source->isOpen() &&
+        !d_ptr->source->open (QIODevice::ReadOnly)) {
+
+        qWarning() << "Could not open source of CompressedIO";
+        return false;
+    }
+
+    if (!d_ptr->restart ()) {
+        return false;
+    }
+
+    // Size is needed for Content-Length, so compress once to count it
+    if (d_ptr->compressedSize < 0) {
+        qint64 total = 0;
+        qint64 produced = 0;
+
+        while ((produced = d_ptr->produce (0, COMPRESS_CHUNK_SIZE)) > 0) {
+            total += produced;
+        }
+
+        if (produced < 0 || !d_ptr->restart ()) {
+            qWarning() << "Failed to compress source of CompressedIO";
+            return false;
+        }
+
+        d_ptr->compressedSize = total;
+    }
+
+    // Position is tracked here, no use for QIODevice's buffer
+    return QIODevice::open (QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+void CompressedIO::close () {
+    if (d_ptr->source != 0 && d_ptr->source->isOpen()) {
+        d_ptr->source->close ();
+    }
+
+    QIODevice::close ();
+}
+
+bool CompressedIO::isSequential () const {
+    // Random access like HttpMultiContentIO, see its isSequential
+    return false;
+}
+
+bool CompressedIO::seek (qint64 pos) {
+    if (!isOpen()) {
+        qWarning() << "Trying to seek in a device not opened yet";
+        return false;
+    }
+
+    if (pos < 0 || pos > size()) {
+        qWarning() << "Invalid seek" << pos;
+        return false;
+    }
+
+    if (pos < d_ptr->position && !d_ptr->restart ()) {
+        return false;
+    }
+
+    while (d_ptr->position < pos) {
+        if (d_ptr->produce (0, pos - d_ptr->position) <= 0) {
+            qWarning() << "Failed to seek to" << pos;
+            return false;
+        }
+    }
+
+    return QIODevice::seek (pos);
+}
+
+qint64 CompressedIO::size () const {
+    if (d_ptr->compressedSize < 0) {
+        return 0;
+    }
+
+    return d_ptr->compressedSize;
+}
+
+bool CompressedIO::atEnd () const {
+    return d_ptr->finished &&
+        (d_ptr->pendingOffset >= d_ptr->pending.size());
+}
+
+qint64 CompressedIO::readData (char *data, qint64 maxlen) {
+    if (!isOpen()) {
+        qWarning() << "Trying to read IODevice which has not been opened";
+        return -1;
+    }
+
+    if (d_ptr->rateLimited && !atEnd()) {
+        maxlen = RateLimiter::shared()->take (this, maxlen);
+        if (maxlen == 0) {
+            // Wait for readyRead
+            return 0;
+        }
+    }
+
+    qint64 bytesRead = d_ptr->produce (data, maxlen);
+
+    if (bytesRead == 0)
+        bytesRead = -1;
+
+    return bytesRead;
+}
+
+qint64 CompressedIO::writeData (const char *data, qint64 len) {
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    qWarning() << "CompressedIO::writeData not supported";
+    return -1;
+}
+
+/****************************************************************************
+ *              CompressedIOPrivate functions
+ ****************************************************************************/
+
+CompressedIOPrivate::CompressedIOPrivate (QIODevice * source,
+    CompressedIO::Encoding encoding) : source (source), encoding (encoding),
+    streamReady (false), finished (false), pendingOffset (0),
+    compressedSize (-1), position (0), rateLimited (true) {
+
+    memset (&stream, 0, sizeof (stream));
+}
+
+CompressedIOPrivate::~CompressedIOPrivate () {
+    if (streamReady) {
+        deflateEnd (&stream);
+    }
+}
+
+bool CompressedIOPrivate::restart () {
+    if (source->pos() != 0 && !source->seek (0)) {
+        qWarning() << "Could not rewind source of CompressedIO";
+        return false;
+    }
+
+    int result = Z_OK;
+    if (streamReady) {
+        result = deflateReset (&stream);
+    } else {
+        int windowBits = (encoding == CompressedIO::ENCODING_GZIP) ?
+            GZIP_WINDOW_BITS : ZLIB_WINDOW_BITS;
+        result = deflateInit2 (&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+            windowBits, 8, Z_DEFAULT_STRATEGY);
+        streamReady = (result == Z_OK);
+    }
+
+    if (result != Z_OK) {
+        qWarning() << "zlib init failed:" << result;
+        return false;
+    }
+
+    finished = false;
+    pending.clear ();
+    pendingOffset = 0;
+    position = 0;
+    return true;
+}
+
+qint64 CompressedIOPrivate::produce (char * data, qint64 maxlen) {
+    qint64 produced = 0;
+
+    while (produced < maxlen) {
+        int available = pending.size() - pendingOffset;
+
+        if (available > 0) {
+            int count = (int) qMin ((qint64) available, maxlen - produced);
+            if (data != 0) {
+                memcpy (data + produced, pending.constData() + pendingOffset,
+                    count);
+            }
+            pendingOffset += count;
+            produced += count;
+        } else if (finished) {
+            break;
+        } else if (!compressChunk ()) {
+            return -1;
+        }
+    }
+
+    position += produced;
+    return produced;
+}
+
+bool CompressedIOPrivate::compressChunk () {
+    char input[COMPRESS_CHUNK_SIZE];
+    qint64 inputLength = source->read (input, COMPRESS_CHUNK_SIZE);
+
+    if (inputLength < 0) {
+        qWarning() << "Could not read source of CompressedIO";
+        return false;
+    }
+
+    int flush = (inputLength == 0 || source->atEnd()) ? Z_FINISH : Z_NO_FLUSH;
+
+    pending.clear ();
+    pendingOffset = 0;
+
+    stream.next_in = reinterpret_cast<Bytef *>(input);
+    stream.avail_in = (uInt) inputLength;
+
+    int result = Z_OK;
+    do {
+        int oldSize = pending.size();
+        pending.resize (oldSize + COMPRESS_CHUNK_SIZE);
+
+        stream.next_out = reinterpret_cast<Bytef *>(pending.data() + oldSize);
+        stream.avail_out = COMPRESS_CHUNK_SIZE;
+
+        result = deflate (&stream, flush);
+        if (result == Z_STREAM_ERROR) {
+            qWarning() << "zlib deflate failed";
+            return false;
+        }
+
+        pending.resize (oldSize + COMPRESS_CHUNK_SIZE - stream.avail_out);
+    } while (stream.avail_out == 0);
+
+    finished = (result == Z_STREAM_END);
+    return true;
+}
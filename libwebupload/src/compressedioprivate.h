@@ -0,0 +1,73 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _WEBUPLOAD_COMPRESSED_IO_PRIVATE_H_
+#define _WEBUPLOAD_COMPRESSED_IO_PRIVATE_H_
+
+#include "WebUpload/CompressedIO"
+#include <QByteArray>
+#include <zlib.h>
+
+namespace WebUpload {
+
+    class CompressedIOPrivate {
+
+    public:
+        CompressedIOPrivate (QIODevice * source,
+            CompressedIO::Encoding encoding);
+        ~CompressedIOPrivate ();
+
+        /*!
+          \brief Start compression from the beginning of the source
+          \return <code>true</code> if source could be rewound
+         */
+        bool restart ();
+
+        /*!
+          \brief Get next compressed bytes
+          \param data Buffer for the data, null to just skip the bytes
+          \param maxlen Maximum number of bytes
+          \return Number of bytes produced, 0 at end and -1 on error
+         */
+        qint64 produce (char * data, qint64 maxlen);
+
+        /*!
+          \brief Compress next chunk of the source to pending
+          \return <code>false</code> on error
+         */
+        bool compressChunk ();
+
+        QIODevice * source; //!< Device compressed
+        CompressedIO::Encoding encoding; //!< Encoding used
+
+        z_stream stream; //!< zlib state
+        bool streamReady; //!< stream has been initialized
+        bool finished; //!< All compressed data is in pending
+
+        QByteArray pending; //!< Compressed data not read yet
+        int pendingOffset; //!< Read position in pending
+
+        qint64 compressedSize; //!< Size of output, -1 if not known yet
+        qint64 position; //!< Position in compressed output
+        bool rateLimited; //!< Reads are limited by RateLimiter::shared
+    };
+}
+
+#endif
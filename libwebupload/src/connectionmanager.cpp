@@ -30,6 +30,7 @@ ConnectionManager::ConnectionManager(QObject *parent, bool askConnection) :
    
    connect(d_ptr, SIGNAL(connected()), this, SIGNAL(connected()));
    connect(d_ptr, SIGNAL(disconnected()), this, SIGNAL(disconnected()));   
+   connect(d_ptr, SIGNAL(bearerChanged()), this, SIGNAL(bearerChanged()));
 
 }
 
@@ -53,6 +54,22 @@ bool ConnectionManager::isOnline() const {
     return d_ptr->m_manager.isOnline();
 }
 
+QString ConnectionManager::bearerName() const {
+    return d_ptr->activeConfiguration().bearerTypeName();
+}
+
+bool ConnectionManager::isCellular() const {
+    switch (d_ptr->activeConfiguration().bearerType()) {
+        case QNetworkConfiguration::Bearer2G:
+        case QNetworkConfiguration::BearerCDMA2000:
+        case QNetworkConfiguration::BearerWCDMA:
+        case QNetworkConfiguration::BearerHSPA:
+            return true;
+        default:
+            return false;
+    }
+}
+
 // -- private class ------------------------------------------------------------
 
 ConnectionManagerPrivate::ConnectionManagerPrivate(QObject *parent, 
@@ -128,6 +145,21 @@ bool ConnectionManagerPrivate::isConnected() {
     return sessionOpen;
 }
 
+QNetworkConfiguration ConnectionManagerPrivate::activeConfiguration() const {
+    QNetworkConfiguration config = m_defaultConfig;
+
+    if (m_session != 0 && m_session->isOpen()) {
+        // Session may be for a service network, get the access point in use
+        QString activeId = m_session->sessionProperty (
+            "ActiveConfiguration").toString();
+        if (!activeId.isEmpty()) {
+            config = m_manager.configurationFromIdentifier (activeId);
+        }
+    }
+
+    return config;
+}
+
 void ConnectionManagerPrivate::releaseConnection() {
 
     qDebug() << __FUNCTION__;
@@ -197,6 +229,8 @@ void ConnectionManagerPrivate::configurationChanged ( const QNetworkConfiguratio
         if (m_session != 0 && !m_session->isOpen()) {
             createSession();
         }
+
+        Q_EMIT(bearerChanged());
     }
 }
 
@@ -23,6 +23,7 @@
 
 #include <WebUpload/export.h>
 #include <QObject>
+#include <QString>
 
 namespace WebUpload {
 
@@ -60,6 +61,22 @@ namespace WebUpload {
 
         bool isOnline() const;
 
+        /*!
+            \brief Name of the bearer currently used, e.g. "WLAN" or "2G"
+            \return Bearer name of the open session, or of the default
+                    configuration if there is no session. Empty if unknown.
+        */
+        QString bearerName() const;
+
+        /*!
+            \brief Is the bearer currently used a cellular one (2G, 3G).
+                   Cellular bearers are treated as metered.
+            \return <code>true</code> if bearer of the open session, or of
+                    the default configuration if there is no session, is
+                    cellular.
+        */
+        bool isCellular() const;
+
     Q_SIGNALS:
 
         /*!
@@ -72,6 +89,12 @@ namespace WebUpload {
         */
         void disconnected();
 
+        /*!
+            \brief default configuration changed, so the bearer used by the
+                   next session may differ from the current one
+        */
+        void bearerChanged();
+
     private:
         Q_DISABLE_COPY(ConnectionManager)    
         ConnectionManagerPrivate * const d_ptr;
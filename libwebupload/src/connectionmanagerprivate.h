@@ -47,6 +47,12 @@ namespace WebUpload {
         */
         void releaseConnection();
 
+        /*!
+            \brief Configuration in use. Access point of the open session,
+                   or the default configuration if there is no session.
+        */
+        QNetworkConfiguration activeConfiguration() const;
+
         /*!
             \brief Prints information about the config to log
         */
@@ -68,6 +74,11 @@ namespace WebUpload {
         */
         void disconnected();
 
+        /*!
+            default configuration changed
+        */
+        void bearerChanged();
+
     private Q_SLOTS:
         /*!
           \brief Slot to connect to the QNetworkSession::error signal
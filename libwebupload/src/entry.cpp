@@ -30,10 +30,16 @@
 #include "WebUpload/PostOption"
 #include "WebUpload/CommonListOption"
 #include "WebUpload/CommonSwitchOption"
+#include "WebUpload/Service"
 #include "WebUpload/ServiceOption"
 #include "WebUpload/Media"
+#include "mediaprivate.h"
 #include "internalenums.h"
+#include "outboxindex.h"
+#include "stringtable.h"
 #include <QUuid>
+#include <QSet>
+#include <QtAlgorithms>
 
 #include <QtSparql>
 QUrl methodWeb("http://www.tracker-project.org/temp/mto#transfer-method-web");
@@ -161,6 +167,8 @@ void Entry::clearFailed () {
         }
     }
 
+    d_ptr->updateOutboxIndexState ();
+
     // No need to write to tracker, since tracker does not keep track of
     Q_EMIT (stateChanged(this));
     return;
@@ -227,6 +235,8 @@ void Entry::cancel () {
             "added to tracker yet";
     }
 
+    d_ptr->updateOutboxIndexState ();
+
     Q_EMIT (stateChanged(this));
     return;
 }
@@ -335,10 +345,30 @@ Media * Entry::mediaAt (int index) const {
     }
 }
 
+static bool mediaSizeLessThan (const Media * left, const Media * right) {
+    return left->fileSize() < right->fileSize();
+}
+
+QVectorIterator<Media *> Entry::mediaInUploadOrder() const {
+    QVector<Media *> ordered = d_ptr->media;
+
+    Service * service = 0;
+    if (d_ptr->m_account.isNull() == false) {
+        service = d_ptr->m_account->service();
+    }
+
+    if (service != 0 && service->uploadsSmallFirst()) {
+        qStableSort (ordered.begin(), ordered.end(), mediaSizeLessThan);
+    }
+
+    return QVectorIterator<Media *>(ordered);
+}
+
 Media * Entry::nextUnsentMedia (bool includeError) const {
     Media *nextUnsentMedia = 0;
-    for (int i = 0; i < d_ptr->media.size(); i++) {
-        Media *m = d_ptr->media [i];
+    QVectorIterator<Media *> iter = mediaInUploadOrder();
+    while (iter.hasNext()) {
+        Media *m = iter.next();
 
         if (m->isPending() || m->isPaused()) {
             nextUnsentMedia = m;
@@ -545,51 +575,33 @@ QList<QUrl> Entry::commonTags () const {
 }
 
 void Entry::appendTagToAllMedia (const QUrl & tag) {
-    QVectorIterator<Media *> mediaIter = d_ptr->media;
-
-    while (mediaIter.hasNext()) {
-        Media * media = mediaIter.next();
-        media->appendTag (tag);
-    }
+    appendTagsToAllMedia (QList<QUrl>() << tag);
 }
 
 void Entry::appendTagToAllMedia (const QString & tag) {
-    QSparqlQuery query ("SELECT ?tagUrl WHERE { ?tagUrl a nao:Tag; "
-            "nao:prefLabel ?:tagValue . }");
-    query.bindValue ("tagValue", QUrl(tag));
-
-    QString tagUrl;
-    QSparqlResult * result = d_ptr->blockingSparqlQuery (query);
-    if (result == 0) {
-        return;
-    } else if (result->size () == 0) {
-        qDebug() << query.preparedQueryText() << "had no reponse";
-        delete result;
+    appendTagsToAllMedia (QStringList() << tag);
+}
 
-        QString uuidToUse =
-            QUuid::createUuid().toString().remove('{').remove('}');
-        tagUrl = QString("urn:uuid").append (uuidToUse);
-        QSparqlQuery insertQuery("INSERT { ?:tagUrl a nao:Tag; "
-            "nao:prefLabel ?:tagValue . }",
-            QSparqlQuery::InsertStatement);
-        insertQuery.bindValue ("tagUrl", QUrl(tagUrl));
-        insertQuery.bindValue ("tagValue", QUrl(tag));
+void Entry::appendTagsToAllMedia (const QList<QUrl> & tags) {
+    QList<QUrl> tagUrls;
+    QStringList labels;
 
-        result = d_ptr->blockingSparqlQuery (insertQuery);
-        if (result == 0) {
-            qDebug() << "Insertion also did not work";
-            qDebug() << "Could not add tag" << tag;
-            return;
-        }
-    } else {
-        result->next ();
-        tagUrl = result->binding(0).value().toString();
+    if (d_ptr->resolveTagUrls (tags, tagUrls, labels)) {
+        d_ptr->appendTagsToMedia (tagUrls, labels);
     }
+}
 
-    appendTagToAllMedia (QUrl (tagUrl));
+void Entry::appendTagsToAllMedia (const QStringList & tags) {
+    QList<QUrl> tagUrls;
+    QStringList labels;
+
+    if (d_ptr->resolveTags (tags, tagUrls, labels)) {
+        d_ptr->appendTagsToMedia (tagUrls, labels);
+    }
 }
 
 void Entry::removeTagFromAllMedia (const QUrl & tag) {
+    d_ptr->prefetchTags (false);
     QVectorIterator<Media *> mediaIter = d_ptr->media;
 
     while (mediaIter.hasNext()) {
@@ -599,6 +611,7 @@ void Entry::removeTagFromAllMedia (const QUrl & tag) {
 }
 
 void Entry::removeTagFromAllMedia (const QString & tag) {
+    d_ptr->prefetchTags (false);
     QVectorIterator<Media *> mediaIter = d_ptr->media;
 
     while (mediaIter.hasNext()) {
@@ -608,83 +621,18 @@ void Entry::removeTagFromAllMedia (const QString & tag) {
 }
 
 void Entry::getTagsFromTracker () {
+    d_ptr->prefetchTags ();
+}
 
-    qDebug() << "PERF: Getting tags for all media: START";
-
-    QString trackerUris;
-    QMap<QString, Media*> mediaMap;
-    foreach (Media *media, d_ptr->media) {
-        QString origFileTrackerUri(media->origFileTrackerURI().toString());
-        trackerUris.append(QString("'%1',").arg(origFileTrackerUri));
-        mediaMap.insert(origFileTrackerUri, media);
-    }
-    trackerUris.chop(1);
-
-    QString queryString = QString("SELECT ?ieElem ?tagUrl ?tag WHERE { "
-        "?tagUrl a nao:Tag; nao:prefLabel ?tag . "
-        "?ieElem a nie:InformationElement; nao:hasTag ?tagUrl . "
-        "FILTER (str(?ieElem) in (%1)) }").arg(trackerUris);
-    QSparqlQuery query (queryString);
-
-    QSparqlResult * result = d_ptr->blockingSparqlQuery (query);
-    if (result != 0) {
-        // Query can have 0 rows as well - when there are no tags
-        while (result->next ()) {
-            QString ieElem(result->binding(0).value().toString());
-            QString tagUrl(result->binding(1).value().toString());
-            QString tag(result->binding(2).value().toString());
-
-            Media *media = mediaMap[ieElem];
-            if (media != 0) {
-                media->appendTag(tagUrl, tag);
-            }
-        }
-
-        delete result;
-    }
-
-    qDebug() << "PERF: Getting tags for all media: END";
+void Entry::prefetchMetadata () {
+    d_ptr->prefetchTags ();
 
-    qDebug() << "PERF: Getting geotags for all media: START";
-    QString geotagQueryString = QString(
-        "SELECT ?ieElem ?country ?city ?district WHERE { "
-        "?ieElem a nie:InformationElement . "
-        "    OPTIONAL { ?ieElem slo:location ?loc . "
-        "        OPTIONAL { ?loc slo:postalAddress ?pAdd . "
-        "            OPTIONAL { ?pAdd nco:country ?country . } "
-        "            OPTIONAL { ?pAdd nco:locality ?city . } "
-        "            OPTIONAL { ?pAdd nco:region ?district . } "
-        "        } "
-        "    } "
-        "FILTER (str(?ieElem) in (%1)) } ").arg(trackerUris);
-
-    QSparqlQuery geotagQuery (geotagQueryString);
-
-    result = d_ptr->blockingSparqlQuery (geotagQuery);
-    if (result != 0) {
-        // Query can have 0 rows as well - when there are no tags
-        while (result->next ()) {
-            GeotagInfo geotagInfo;
-            Media *media = mediaMap[result->binding(0).value().toString()];
-            if (media != 0) {
-                if (!result->binding(1).value().isNull()) {
-                    geotagInfo.setCountry (result->binding(1).value().toString());
-                }
-                if (!result->binding(2).value().isNull()) {
-                    geotagInfo.setCity (result->binding(2).value().toString());
-                }
-                if (!result->binding(3).value().isNull()) {
-                    geotagInfo.setDistrict (result->binding(3).value().toString());
-                }
-                media->setGeotag(geotagInfo);
-            }
+    if (!d_ptr->metadataFilter.testFlag (METADATA_FILTER_REGIONS)) {
+        // Region metadata is cached by media when first read
+        foreach (Media *media, d_ptr->media) {
+            media->regionMetadata ();
         }
-
-        delete result;
     }
-
-    qDebug() << "PERF: Getting geotags for all media: END";
-
 }
 
 void Entry::setImageResizeOption (ImageResizeOption resizeOption) {
@@ -713,6 +661,20 @@ void Entry::setVideoResizeOption (VideoResizeOption resizeOption) {
     }
 }
 
+void Entry::setNetworkPolicy (NetworkPolicy policy) {
+    if ((policy < NETWORK_ANY) || (policy >= NETWORK_N)) {
+        qWarning() << "Invalid network policy" << policy << "given to"
+            << __FUNCTION__;
+        d_ptr->network_policy = NETWORK_ANY;
+    } else {
+        d_ptr->network_policy = policy;
+    }
+}
+
+void Entry::setRetryAttempts (int attempts) {
+    d_ptr->retry_attempts = (attempts < 0) ? 0 : attempts;
+}
+
 void Entry::setMetadataFilter (int metadataFilter) {
     if (d_ptr->metadataFilter!=metadataFilter) {
         // options have changed
@@ -729,6 +691,14 @@ ImageResizeOption Entry::imageResizeOption () const {
     return d_ptr->image_resize_option;
 }
 
+NetworkPolicy Entry::networkPolicy () const {
+    return d_ptr->network_policy;
+}
+
+int Entry::retryAttempts () const {
+    return d_ptr->retry_attempts;
+}
+
 VideoResizeOption Entry::videoResizeOption () const {
     qDebug() << "Entry::videoResizeOption" << d_ptr->video_resize_option;
     return d_ptr->video_resize_option;
@@ -808,6 +778,7 @@ EntryPrivate::EntryPrivate (Entry * parent) : QObject (parent),
     failed (false), state (TRANSFER_STATE_PENDING),
     image_resize_option (IMAGE_RESIZE_NONE), 
     video_resize_option (VIDEO_RESIZE_NONE), 
+    network_policy (NETWORK_ANY), retry_attempts (0),
     metadataFilter (METADATA_FILTER_NONE), m_allowSerialize (true),
     m_sparqlConnection (0) {
     
@@ -954,6 +925,22 @@ bool EntryPrivate::init(const QString &path, Entry * entry, bool demandProper,
                     this->video_resize_option = VIDEO_RESIZE_NONE;
                 }
                 
+            } else if (e.tagName() == "network") {
+                QString temp = e.attribute ("policy", "");
+
+                qDebug() << "network policy is " << temp;
+                if (temp == "wlan") {
+                    this->network_policy = NETWORK_WLAN_ONLY;
+                } else {
+                    this->network_policy = NETWORK_ANY;
+                }
+
+            } else if (e.tagName() == "retry") {
+                retry_attempts = e.attribute ("attempts", "0").toInt ();
+                if (retry_attempts < 0) {
+                    retry_attempts = 0;
+                }
+
             } else if (e.tagName() == "filter-metadata") {
                 QString temp;
                 int     enabled;
@@ -977,7 +964,8 @@ bool EntryPrivate::init(const QString &path, Entry * entry, bool demandProper,
 
                     if (!(optionName.isEmpty())) {
                         QString optionValue = e1.text();
-                        options.insert(optionName, optionValue);
+                        options.insert(StringTable::string (optionName),
+                            optionValue);
                     }
 
                     n1 = n1.nextSibling();
@@ -1122,6 +1110,7 @@ bool EntryPrivate::removeSerialized () {
         }
 
         qDebug() << "Removed entry serialization" << serialized_to;
+        OutboxIndex::removeEntry (serialized_to);
         serialized_to = "";
 
         // Remove file copies
@@ -1238,6 +1227,19 @@ bool EntryPrivate::serialize(const QString & path) {
         }
     }
 
+    if (network_policy == NETWORK_WLAN_ONLY) {
+        QDomElement networkPolicy = doc.createElement ("network");
+        networkPolicy.setAttribute ("policy", "wlan");
+        entryTag.appendChild (networkPolicy);
+    }
+
+    if (retry_attempts > 0) {
+        QDomElement retry = doc.createElement ("retry");
+        // Don't use setAttribute as it used locales
+        retry.setAttribute ("attempts", QString::number (retry_attempts));
+        entryTag.appendChild (retry);
+    }
+
     QDomElement metaFilter = doc.createElement ("filter-metadata");
     // Don't use setAttribute as it used locales
     QString flagAttrb = QString::number((int)metadataFilter, 16);
@@ -1273,9 +1275,300 @@ bool EntryPrivate::serialize(const QString & path) {
     file.close();
     serialized_to = path;
 
+    // Keep outbox index in sync so that outbox can be listed without
+    // loading the entries
+    QString account;
+    if (m_account.isNull() == false) {
+        account = m_account->stringId();
+    } else {
+        account = accountId;
+    }
+    OutboxIndex::storeEntry (OutboxIndex::createRecord (path, m_created,
+        account, state, failed, size (true)));
+
+    return true;
+}
+
+
+void EntryPrivate::prefetchTags (bool includeGeotags) {
+
+    if (metadataFilter.testFlag (METADATA_FILTER_ALL)) {
+        qDebug() << "All metadata filtered, not reading tags";
+        return;
+    }
+
+    bool readTags = !metadataFilter.testFlag (METADATA_FILTER_TAGS);
+    QString tagUris;
+    QString geotagUris;
+    QMap<QString, Media*> mediaMap;
+
+    foreach (Media *item, media) {
+        MediaPrivate * mediaData = item->d_ptr;
+        if (mediaData->m_origFileTrackerUri.isEmpty()) {
+            continue;
+        }
+
+        QString origFileTrackerUri(mediaData->m_origFileTrackerUri.toString());
+        if (readTags && !mediaData->m_tagsLoaded) {
+            tagUris.append(QString("'%1',").arg(origFileTrackerUri));
+            mediaData->m_tagsLoaded = true;
+            mediaMap.insert(origFileTrackerUri, item);
+        }
+        if (includeGeotags && !mediaData->m_geotagLoaded) {
+            geotagUris.append(QString("'%1',").arg(origFileTrackerUri));
+            mediaData->m_geotagLoaded = true;
+            mediaMap.insert(origFileTrackerUri, item);
+        }
+    }
+
+    if (!tagUris.isEmpty()) {
+        qDebug() << "PERF: Getting tags for all media: START";
+        tagUris.chop(1);
+
+        QString queryString = QString("SELECT ?ieElem ?tagUrl ?tag WHERE { "
+            "?tagUrl a nao:Tag; nao:prefLabel ?tag . "
+            "?ieElem a nie:InformationElement; nao:hasTag ?tagUrl . "
+            "FILTER (str(?ieElem) in (%1)) }").arg(tagUris);
+        QSparqlQuery query (queryString);
+
+        QSet<Media *> changedMedia;
+        QSparqlResult * result = blockingSparqlQuery (query);
+        if (result != 0) {
+            // Query can have 0 rows as well - when there are no tags
+            while (result->next ()) {
+                QString ieElem(result->binding(0).value().toString());
+                QUrl tagUrl(result->binding(1).value().toString());
+                QString tag(result->binding(2).value().toString());
+
+                Media *item = mediaMap.value(ieElem);
+                if (item != 0 && !item->d_ptr->m_tagUrls.contains(tagUrl)) {
+                    item->d_ptr->m_tagUrls << StringTable::url (tagUrl);
+                    item->d_ptr->m_tags << StringTable::string (tag);
+                    changedMedia.insert(item);
+                }
+            }
+
+            delete result;
+        }
+
+        foreach (Media *item, changedMedia) {
+            Q_EMIT (item->tagsChanged (item->tagUrls()));
+        }
+
+        qDebug() << "PERF: Getting tags for all media: END";
+    }
+
+    if (!geotagUris.isEmpty()) {
+        qDebug() << "PERF: Getting geotags for all media: START";
+        geotagUris.chop(1);
+
+        QString geotagQueryString = QString(
+            "SELECT ?ieElem ?country ?city ?district WHERE { "
+            "?ieElem a nie:InformationElement . "
+            "    OPTIONAL { ?ieElem slo:location ?loc . "
+            "        OPTIONAL { ?loc slo:postalAddress ?pAdd . "
+            "            OPTIONAL { ?pAdd nco:country ?country . } "
+            "            OPTIONAL { ?pAdd nco:locality ?city . } "
+            "            OPTIONAL { ?pAdd nco:region ?district . } "
+            "        } "
+            "    } "
+            "FILTER (str(?ieElem) in (%1)) } ").arg(geotagUris);
+
+        QSparqlQuery geotagQuery (geotagQueryString);
+
+        QSparqlResult * result = blockingSparqlQuery (geotagQuery);
+        if (result != 0) {
+            // Query can have 0 rows as well - when there are no tags
+            while (result->next ()) {
+                GeotagInfo geotagInfo;
+                Media *item = mediaMap.value(
+                    result->binding(0).value().toString());
+                if (item != 0) {
+                    if (!result->binding(1).value().isNull()) {
+                        geotagInfo.setCountry (
+                            result->binding(1).value().toString());
+                    }
+                    if (!result->binding(2).value().isNull()) {
+                        geotagInfo.setCity (
+                            result->binding(2).value().toString());
+                    }
+                    if (!result->binding(3).value().isNull()) {
+                        geotagInfo.setDistrict (
+                            result->binding(3).value().toString());
+                    }
+                    item->setGeotag(geotagInfo);
+                }
+            }
+
+            delete result;
+        }
+
+        qDebug() << "PERF: Getting geotags for all media: END";
+    }
+}
+
+bool EntryPrivate::resolveTags (const QStringList & tags,
+    QList<QUrl> & tagUrls, QStringList & labels) {
+
+    QStringList missing;
+    QString filterString;
+    for (int i = 0; i < tags.count(); ++i) {
+        if (!tags.at(i).isEmpty() && !missing.contains (tags.at(i))) {
+            filterString.append (QString ("?:tag%1,").arg (missing.count()));
+            missing << tags.at(i);
+        }
+    }
+
+    if (missing.isEmpty()) {
+        qWarning() << "Can't add empty tag to media";
+        return false;
+    }
+    filterString.chop (1);
+
+    // Find all existing tags with one query
+    QSparqlQuery query (QString ("SELECT ?tagUrl ?tag WHERE { "
+        "?tagUrl a nao:Tag; nao:prefLabel ?tag . "
+        "FILTER (?tag in (%1)) }").arg (filterString));
+    for (int i = 0; i < missing.count(); ++i) {
+        query.bindValue (QString ("tag%1").arg (i), missing.at(i));
+    }
+
+    QSparqlResult * result = blockingSparqlQuery (query);
+    if (result == 0) {
+        return false;
+    }
+
+    while (result->next ()) {
+        QString tag = result->binding(1).value().toString();
+        // Not bothering about the number of results. Just taking the
+        // first one.
+        if (missing.removeOne (tag)) {
+            tagUrls << StringTable::url (result->binding(0).value().toString());
+            labels << StringTable::string (tag);
+        }
+    }
+    delete result;
+
+    if (missing.isEmpty()) {
+        return true;
+    }
+
+    // And insert the rest with one query
+    QString insertString ("INSERT { ");
+    for (int i = 0; i < missing.count(); ++i) {
+        insertString.append (QString ("?:tagUrl%1 a nao:Tag; "
+            "nao:prefLabel ?:tag%1 . ").arg (i));
+    }
+    insertString.append ("}");
+
+    QSparqlQuery insertQuery (insertString, QSparqlQuery::InsertStatement);
+    QList<QUrl> newUrls;
+    for (int i = 0; i < missing.count(); ++i) {
+        QString uuidToUse =
+            QUuid::createUuid().toString().remove('{').remove('}');
+        QUrl tagUrl (QString("urn:uuid").append (uuidToUse));
+        insertQuery.bindValue (QString ("tagUrl%1").arg (i), tagUrl);
+        insertQuery.bindValue (QString ("tag%1").arg (i), missing.at(i));
+        newUrls << tagUrl;
+    }
+
+    result = blockingSparqlQuery (insertQuery);
+    if (result == 0) {
+        qDebug() << "Could not add tags" << missing;
+        // Tags found are still valid
+        return !tagUrls.isEmpty();
+    }
+    delete result;
+
+    tagUrls << newUrls;
+    labels << missing;
     return true;
 }
 
+bool EntryPrivate::resolveTagUrls (const QList<QUrl> & tags,
+    QList<QUrl> & tagUrls, QStringList & labels) {
+
+    QList<QUrl> unknown;
+    QString filterString;
+    for (int i = 0; i < tags.count(); ++i) {
+        if (!tags.at(i).isEmpty() && !unknown.contains (tags.at(i))) {
+            filterString.append (QString ("?:tagUrl%1,").arg (unknown.count()));
+            unknown << tags.at(i);
+        }
+    }
+
+    if (unknown.isEmpty()) {
+        qWarning() << "Can't add empty tag to media";
+        return false;
+    }
+    filterString.chop (1);
+
+    QSparqlQuery query (QString ("SELECT ?tagUrl ?tag WHERE { "
+        "?tagUrl a nao:Tag; nao:prefLabel ?tag . "
+        "FILTER (?tagUrl in (%1)) }").arg (filterString));
+    for (int i = 0; i < unknown.count(); ++i) {
+        query.bindValue (QString ("tagUrl%1").arg (i), unknown.at(i));
+    }
+
+    QSparqlResult * result = blockingSparqlQuery (query);
+    if (result == 0) {
+        return false;
+    }
+
+    while (result->next ()) {
+        QUrl tagUrl (result->binding(0).value().toString());
+        if (unknown.removeOne (tagUrl)) {
+            tagUrls << tagUrl;
+            labels << result->binding(1).value().toString();
+        }
+    }
+    delete result;
+
+    if (!unknown.isEmpty()) {
+        qWarning() << "Tags not found from tracker" << unknown;
+    }
+
+    return !tagUrls.isEmpty();
+}
+
+void EntryPrivate::appendTagsToMedia (const QList<QUrl> & tagUrls,
+    const QStringList & labels) {
+
+    // Current tags of all media are needed, read those with one query
+    prefetchTags (false);
+
+    foreach (Media *item, media) {
+        MediaPrivate * mediaData = item->d_ptr;
+        if (mediaData->m_tags.size () != mediaData->m_tagUrls.size ()) {
+            qWarning() << "Tag and tag url lists are not in sync."
+                "Ignoring appendTag request";
+            continue;
+        }
+
+        bool changed = false;
+        for (int i = 0; i < tagUrls.count(); ++i) {
+            if (!mediaData->m_tagUrls.contains (tagUrls.at(i)) &&
+                !mediaData->m_tags.contains (labels.at(i))) {
+
+                mediaData->m_tagUrls << tagUrls.at(i);
+                mediaData->m_tags << labels.at(i);
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            Q_EMIT (item->tagsChanged (item->tagUrls()));
+        }
+    }
+}
+
+void EntryPrivate::updateOutboxIndexState () {
+    if (serialized_to.isEmpty() || m_allowSerialize == false) {
+        return;
+    }
+
+    OutboxIndex::updateEntryState (serialized_to, state, failed);
+}
 
 qint64 EntryPrivate::size (bool calc_sent) const {
     qint64 size = 0;
@@ -1344,9 +1637,9 @@ void EntryPrivate::syncPostOptions () {
         return;
     }
 
-    if (publicObject != 0) {
-        publicObject->setMetadataFilter(METADATA_FILTER_NONE);
-    }
+    // Filter is collected from the options and set once, so that media
+    // don't see the intermediate values
+    int filter = METADATA_FILTER_NONE;
 
     QListIterator<PostOption *> options = m_account->service()->postOptions();
     while (options.hasNext ()) {
@@ -1361,9 +1654,8 @@ void EntryPrivate::syncPostOptions () {
             {
                 CommonListOption * opt = 
                     qobject_cast<CommonListOption *>( option);
-                if (publicObject != 0 && opt != 0) {
-                    publicObject->setMetadataFilter (
-                        publicObject->metadataFilterOption() | opt->currentValue());
+                if (opt != 0) {
+                    filter |= opt->currentValue();
                 }
                 break;
             }
@@ -1372,11 +1664,8 @@ void EntryPrivate::syncPostOptions () {
             {
                 CommonSwitchOption *opt =
                     qobject_cast<CommonSwitchOption *>(option);
-                if (publicObject != 0 && opt != 0) {
-                    if (!opt->isChecked()) {
-                        publicObject->setMetadataFilter(
-                            publicObject->metadataFilterOption() | METADATA_FILTER_REGIONS);
-                    }
+                if (opt != 0 && !opt->isChecked()) {
+                    filter |= METADATA_FILTER_REGIONS;
                 }
                 break;
             }
@@ -1416,6 +1705,10 @@ void EntryPrivate::syncPostOptions () {
                 break;
         }
     }
+
+    if (publicObject != 0) {
+        publicObject->setMetadataFilter (filter);
+    }
 }
 
 WebUpload::Account * EntryPrivate::loadAccount (QObject * parent) const {
@@ -1500,7 +1793,14 @@ void EntryPrivate::mediaStateChanged (const Media *changedMedia) {
             changeState = true;
         }
     } else if (media->hasError()) {
-        failed = true;
+        if (failed == false) {
+            failed = true;
+            updateOutboxIndexState ();
+        }
+    }
+
+    if (changeState == true) {
+        updateOutboxIndexState ();
     }
 
     if (changeState == true) {
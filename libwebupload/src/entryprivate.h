@@ -72,6 +72,11 @@ namespace WebUpload {
 
         //!< Resize options for any videos selected
         VideoResizeOption video_resize_option; 
+
+        //!< Connections over which entry can be uploaded
+        NetworkPolicy network_policy;
+
+        int retry_attempts; //!< Automatic retries done after failures
         
         MetadataFilters metadataFilter; //!< metadata filter option            
 
@@ -150,6 +155,49 @@ namespace WebUpload {
           \brief Remove serialization of entry and medias related to it
          */
         bool removeSerialized ();
+
+        /*!
+          \brief Read tags and geotags from tracker for all media that have
+                 not read those yet. One query is used for all tags and one
+                 for all geotags. Nothing is read if metadata is filtered.
+          \param includeGeotags If <code>false</code> only tags are read
+         */
+        void prefetchTags (bool includeGeotags = true);
+
+        /*!
+          \brief Find tracker urls of tags, creating tags not yet in tracker.
+                 Uses one query to find tags and one to create missing ones.
+          \param tags Labels of tags
+          \param tagUrls Urls of tags resolved are appended here
+          \param labels Labels of tags resolved are appended here, in same
+                        order as tagUrls
+          \return <code>true</code> if any tag was resolved
+         */
+        bool resolveTags (const QStringList & tags, QList<QUrl> & tagUrls,
+            QStringList & labels);
+
+        /*!
+          \brief Find labels of tags with one query
+          \param tags Tracker urls of tags
+          \param tagUrls Urls of tags found are appended here
+          \param labels Labels of tags found are appended here, in same
+                        order as tagUrls
+          \return <code>true</code> if any tag was found
+         */
+        bool resolveTagUrls (const QList<QUrl> & tags, QList<QUrl> & tagUrls,
+            QStringList & labels);
+
+        /*!
+          \brief Append resolved tags to all media in memory
+         */
+        void appendTagsToMedia (const QList<QUrl> & tagUrls,
+            const QStringList & labels);
+
+        /*!
+          \brief Write current state of entry to outbox index, if entry is
+                 serialized to outbox
+         */
+        void updateOutboxIndexState ();
         
         /*!
           \brief Get current option values from account (now service) and
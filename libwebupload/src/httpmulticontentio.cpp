@@ -20,6 +20,8 @@
 
 #include "WebUpload/HttpMultiContentIO"
 #include "httpmulticontentioprivate.h"
+#include "WebUpload/CompressedIO"
+#include "WebUpload/RateLimiter"
 #include <QDebug>
 #include <QTime>
 #include <QBuffer>
@@ -166,10 +168,74 @@ bool HttpMultiContentIO::addFile(const QStringList &args,
     return retVal;
 }
 
+bool HttpMultiContentIO::addDevice(const QStringList &args, 
+    QIODevice *device, const QString &tmplt) {
+
+    if (!d_ptr->isDeviceOpen) {
+        qWarning() << "HttpMultiContentIO::" << __FUNCTION__ << 
+            "called when device is not open yet";
+        delete device;
+        return false;
+    }
+
+    if (device == 0 || device->isSequential()) {
+        qWarning() << "Only random access devices can be added";
+        delete device;
+        return false;
+    }
+
+    bool retVal = true;
+    QString finalString = d_ptr->defaultTemplate;
+    
+    if(!tmplt.isEmpty()) {
+        finalString = tmplt;
+    } 
+
+    for(int i = 0; i < args.count(); i++) {
+        finalString = finalString.arg(args[i]);
+    }
+
+    finalString += "\r\n";
+    retVal = addString(finalString, true);
+
+    if(retVal) {
+        device->setParent(this);
+
+        // Rate is limited when this device is read
+        CompressedIO * compressed = qobject_cast<CompressedIO *>(device);
+        if (compressed != 0) {
+            compressed->setRateLimited (false);
+        }
+
+        if (!device->isOpen() && !device->open (QIODevice::ReadOnly)) {
+            qWarning() << "Could not open device in read mode";
+            delete device;
+            return false;
+        }
+        d_ptr->totalSizeBytes += device->size();
+        d_ptr->dataList.append(device);
+
+        QString  endString = "\r\n--" + d_ptr->boundaryString + "--\r\n";
+        retVal = addString(endString, false);
+    } else {
+        delete device;
+    }
+
+    return retVal;
+}
+
 void HttpMultiContentIO::allDataAdded() {
     // Does not seem to be anything required here currently.
 }
 
+void HttpMultiContentIO::setRateLimited (bool limited) {
+    d_ptr->rateLimited = limited;
+}
+
+bool HttpMultiContentIO::isRateLimited () const {
+    return d_ptr->rateLimited;
+}
+
 bool HttpMultiContentIO::open(OpenMode openMode) {
     if (d_ptr->isDeviceOpen) {
         qWarning() << "HttpMultiContentIO::open - device already open";
@@ -291,6 +357,15 @@ qint64 HttpMultiContentIO::readData(char *data, qint64 maxlen) {
         return -1;
     }
 
+    if (d_ptr->rateLimited &&
+        d_ptr->currentDeviceIndex < d_ptr->dataList.size()) {
+        maxlen = RateLimiter::shared()->take (this, maxlen);
+        if (maxlen == 0) {
+            // Wait for readyRead
+            return 0;
+        }
+    }
+
     qint64 bytesRead = d_ptr->readData (data, maxlen);
 
     if (bytesRead == 0)
@@ -317,6 +392,7 @@ HttpMultiContentIOPrivate::HttpMultiContentIOPrivate() : isDeviceOpen (false),
     bytesSent      = 0;
 
     currentDeviceIndex = 0;
+    rateLimited = true;
 
     generateBoundaryString();
 }
@@ -50,6 +50,9 @@ namespace WebUpload {
         QVector<QIODevice *> dataList;
         int currentDeviceIndex;
 
+        //! Reads are limited by RateLimiter::shared
+        bool rateLimited;
+
         /*!
            \brief  Generates a random boundary string which is 64 characters
                    long. This is called from the constructor.
@@ -20,8 +20,10 @@
 
 #include "WebUpload/Media"
 #include "mediaprivate.h"
+#include "stringtable.h"
 #include "WebUpload/enums.h"
 #include "WebUpload/Entry"
+#include "WebUpload/Service"
 #include <QFileInfo>
 #include <QDir>
 #include <QDebug>
@@ -36,15 +38,73 @@
 #include <QImage>
 #include <QImageReader>
 #include <QImageWriter>
+#include <QCryptographicHash>
 #include <QtConcurrentRun>
 #include <quillmetadata/QuillMetadata>
 #include <quillmetadata/QuillMetadataRegion>
 #include <quillmetadata/QuillMetadataRegionList>
 #include <QtSparql>
 #include <QUuid>
+#include <cstdio>
 
 using namespace WebUpload;
 
+// Size of blocks used when copying and hashing files
+#define MEDIA_COPY_BLOCK 65536
+
+static QCryptographicHash::Algorithm cryptoAlgorithm (HashAlgorithm algorithm) {
+    if (algorithm == HASH_MD5) {
+        return QCryptographicHash::Md5;
+    } else {
+        return QCryptographicHash::Sha1;
+    }
+}
+
+static QString hashAlgorithmName (HashAlgorithm algorithm) {
+    if (algorithm == HASH_MD5) {
+        return QLatin1String ("md5");
+    } else {
+        return QLatin1String ("sha1");
+    }
+}
+
+/*!
+  \brief File that adds all data written to it to a hash. If the data is not
+         written sequentially (writer seeks back), the hash is not valid.
+         Without hash it's a plain file.
+ */
+class HashingFile : public QFile {
+
+public:
+    HashingFile (const QString & name, QCryptographicHash * hash) :
+        QFile (name), m_hash (hash), m_hashedSize (0), m_valid (hash != 0) {
+    }
+
+    //! \brief If hash has all content of file in order
+    bool isHashValid () const {
+        return m_valid;
+    }
+
+protected:
+    qint64 writeData (const char * data, qint64 len) {
+        if (pos() != m_hashedSize) {
+            m_valid = false;
+        }
+
+        qint64 written = QFile::writeData (data, len);
+        if (written > 0 && m_valid) {
+            m_hash->addData (data, written);
+            m_hashedSize += written;
+        }
+        return written;
+    }
+
+private:
+    QCryptographicHash * m_hash;
+    qint64 m_hashedSize;
+    bool m_valid;
+};
+
 const QString Media::PresentationOptionId = QLatin1String ("_PRESENTATION");
 
 Media::Media(QObject *parent) : QObject(parent),
@@ -167,6 +227,7 @@ QString Media::description(bool getMetadataValue) const {
 }
 
 void Media::appendTag(const QUrl &tag) {
+    d_ptr->loadTags ();
     if (d_ptr->m_tags.size () != d_ptr->m_tagUrls.size ()) {
         qWarning() << "Tag and tag url lists are not in sync."
             "Ignoring appendTag request";
@@ -186,7 +247,8 @@ void Media::appendTag(const QUrl &tag) {
                 return;
             } else {
                 result->first ();
-                d_ptr->m_tags << result->binding(0).value().toString();
+                d_ptr->m_tags << StringTable::string (
+                    result->binding(0).value().toString());
             }
             d_ptr->m_tagUrls << tag;
             Q_EMIT (tagsChanged (tagUrls()));
@@ -197,6 +259,7 @@ void Media::appendTag(const QUrl &tag) {
 }
 
 void Media::appendTag(const QString &tag) {
+    d_ptr->loadTags ();
     if (d_ptr->m_tags.size () != d_ptr->m_tagUrls.size ()) {
         qWarning() << "Tag and tag url lists are not in sync."
             "Ignoring appendTag request";
@@ -249,6 +312,7 @@ void Media::appendTag(const QString &tag) {
 
 void Media::appendTag (const QUrl &tagUrl, const QString &tag) {
 
+    d_ptr->loadTags ();
     if (d_ptr->m_tags.size () != d_ptr->m_tagUrls.size ()) {
         qWarning() << "Tag and tag url lists are not in sync."
             "Ignoring appendTag request";
@@ -293,25 +357,33 @@ QString Media::copyFilePath() const {
     return d_ptr->m_copyFileUri.toLocalFile();
 }
 
+QByteArray Media::contentHash() const {
+    return d_ptr->m_contentHash;
+}
+
+HashAlgorithm Media::contentHashAlgorithm() const {
+    return d_ptr->m_hashAlgorithm;
+}
+
 const QList<QUrl> Media::trackerTypes() const {
     d_ptr->queryTrackerTypes ();
     return d_ptr->m_trackerTypes;
 }
 
 QList<QUrl> Media::tagUrls() const {
-    if ((entry() != 0) &&
-        (entry()->checkShareFilter(METADATA_FILTER_TAGS))) {
+    if (d_ptr->isFiltered (METADATA_FILTER_TAGS)) {
         return QList<QUrl>();
     } else {
+        d_ptr->loadTags ();
         return d_ptr->m_tagUrls;
     }
 }
 
 QStringList Media::tags() const {
-    if ((entry() != 0) &&
-        (entry()->checkShareFilter(METADATA_FILTER_TAGS))) {
+    if (d_ptr->isFiltered (METADATA_FILTER_TAGS)) {
         return QStringList();
     } else {
+        d_ptr->loadTags ();
         return d_ptr->m_tags;
     }
 }
@@ -319,6 +391,8 @@ QStringList Media::tags() const {
 QStringList Media::allTags() const {
     QStringList alltags;
     if ((entry() != 0) && (!entry()->checkShareFilter(METADATA_FILTER_TAGS))) {
+        d_ptr->loadTags ();
+        d_ptr->loadGeotag ();
         alltags = d_ptr->m_tags;
         if (!d_ptr->m_geotag.isEmpty ()) {
             alltags << d_ptr->m_geotag.country();
@@ -332,13 +406,13 @@ QStringList Media::allTags() const {
 
 QuillMetadataRegionList Media::regionMetadata(const QString &regionType) const {
 
-    QuillMetadata metadata(srcFilePath(), QuillMetadata::XmpFormat);
-    QVariant variant =  metadata.entry(QuillMetadata::Tag_Regions);
-    QuillMetadataRegionList regions;
-    if (!variant.isNull() && variant.canConvert<QuillMetadataRegionList>()) {
-        regions = variant.value<QuillMetadataRegionList>();
+    if (d_ptr->isFiltered (METADATA_FILTER_REGIONS)) {
+        return QuillMetadataRegionList();
     }
 
+    d_ptr->loadRegions ();
+    QuillMetadataRegionList regions = d_ptr->m_regions;
+
     if (!regionType.isEmpty()) {
         // Filter unwanted region types from the list.
         int regionCount = regions.count();
@@ -358,6 +432,8 @@ QuillMetadataRegionList Media::regionMetadata(const QString &regionType) const {
 }
 
 void Media::clearTags() {
+    // No need to read tags that would be cleared anyway
+    d_ptr->m_tagsLoaded = true;
     if (d_ptr->m_tags.isEmpty() == false) {
         d_ptr->m_tags.clear();
         d_ptr->m_tagUrls.clear();
@@ -544,9 +620,28 @@ Media::CopyResult Media::makeCopy (const QString & path) {
     // Returns 0 if the cast could not be made or if the parameter is 0
     Entry * myEntry = qobject_cast<WebUpload::Entry *>(parentPtr);
 
+    if (myEntry) {
+        return makeCopy (path, myEntry->imageResizeOption());
+    } else {
+        qCritical() << "Parent of media does not seem to be WebUpload::Entry";
+        // Cannot resize without knowing the resize option
+        return Media::COPY_RESULT_UNDEFINED_FAILURE;
+    }
+}
+
+Media::CopyResult Media::makeCopy (const QString & path,
+    ImageResizeOption imageResizeOption) {
+
+    if (type() != TYPE_FILE) {
+        qWarning() << "No copy to be made media is not a file";
+        return COPY_RESULT_NOTHING_TO_COPY;
+    }
+
+    Entry * myEntry = qobject_cast<WebUpload::Entry *>(parent());
+
     if (myEntry) {
         Media::CopyResult retVal = d_ptr->makeCopyOfFile (path,
-            myEntry->imageResizeOption(), myEntry->videoResizeOption());
+            imageResizeOption, myEntry->videoResizeOption());
         myEntry->reSerialize ();
         return retVal;
     } else {
@@ -557,6 +652,7 @@ Media::CopyResult Media::makeCopy (const QString & path) {
 }
 
 void Media::removeTag (const QUrl &tag) {
+    d_ptr->loadTags ();
     if (d_ptr->m_tags.size () != d_ptr->m_tagUrls.size ()) {
         qWarning() << "Tag and tag url lists are not in sync."
             "Ignoring appendTag request";
@@ -572,6 +668,7 @@ void Media::removeTag (const QUrl &tag) {
 }
 
 void Media::removeTag (const QString &tag) {
+    d_ptr->loadTags ();
     if (d_ptr->m_tags.size () != d_ptr->m_tagUrls.size ()) {
         qWarning() << "Tag and tag url lists are not in sync."
             "Ignoring appendTag request";
@@ -623,7 +720,11 @@ void Media::shareOptionsChange (int metadataOptions) {
     Q_UNUSED (metadataOptions);
     Q_EMIT (titleChanged (title()));
     Q_EMIT (descriptionChanged (description()));
-    Q_EMIT (tagsChanged (tagUrls()));
+
+    // Tags not read yet are not read for this, they are read when asked
+    if (d_ptr->m_tagsLoaded || d_ptr->isFiltered (METADATA_FILTER_TAGS)) {
+        Q_EMIT (tagsChanged (tagUrls()));
+    }
 }
 
 Media::Type Media::type() const {
@@ -672,8 +773,74 @@ void Media::refreshStateFromTracker () {
     return;
 }
 
+Media::State Media::state () const {
+    switch (d_ptr->m_state) {
+        case TRANSFER_STATE_ACTIVE:
+            return STATE_ACTIVE;
+        case TRANSFER_STATE_PAUSED:
+            return STATE_PAUSED;
+        case TRANSFER_STATE_DONE:
+            return STATE_DONE;
+        case TRANSFER_STATE_CANCELLED:
+            return STATE_CANCELLED;
+        default:
+            break;
+    }
+
+    return (d_ptr->m_hadError ? STATE_FAILED : STATE_PENDING);
+}
+
+void Media::refreshState (State state) {
+    TransferState newState;
+    bool hadError = false;
+
+    switch (state) {
+        case STATE_ACTIVE:
+            newState = TRANSFER_STATE_ACTIVE;
+            break;
+        case STATE_PAUSED:
+            newState = TRANSFER_STATE_PAUSED;
+            break;
+        case STATE_DONE:
+            newState = TRANSFER_STATE_DONE;
+            break;
+        case STATE_CANCELLED:
+            newState = TRANSFER_STATE_CANCELLED;
+            break;
+        case STATE_FAILED:
+            newState = TRANSFER_STATE_PENDING;
+            hadError = true;
+            break;
+        default:
+            newState = TRANSFER_STATE_PENDING;
+            break;
+    }
+
+    if ((newState == d_ptr->m_state) && (hadError == d_ptr->m_hadError)) {
+        return;
+    }
+
+    if ((newState == TRANSFER_STATE_ACTIVE) && 
+        (d_ptr->m_state == TRANSFER_STATE_PENDING)) {
+        d_ptr->m_startTime = QDateTime::currentDateTime();
+    } else if (newState == TRANSFER_STATE_DONE) {
+        d_ptr->m_completedTime = QDateTime::currentDateTime();
+    }
+
+    d_ptr->m_state = newState;
+    d_ptr->m_hadError = hadError;
+
+    if ((d_ptr->m_state == TRANSFER_STATE_DONE) || 
+        (d_ptr->m_state == TRANSFER_STATE_CANCELLED)) {
+
+        removeCopyFile ();
+    }
+
+    Q_EMIT (stateChanged (this));
+}
+
 void Media::setOption (const QString &id, const QString &value) {
-    d_ptr->m_options.insert (id, value);
+    d_ptr->m_options.insert (StringTable::string (id), value);
 }
 
 QString Media::option (const QString & id) const {
@@ -698,14 +865,19 @@ QString Media::srcFilePath () const {
 }
 
 const GeotagInfo &Media::geotag () const {
+    if (!d_ptr->isFiltered (METADATA_FILTER_ALL)) {
+        d_ptr->loadGeotag ();
+    }
     return d_ptr->m_geotag;
 }
 
 void Media::setGeotag (const GeotagInfo & geotag) {
+    d_ptr->m_geotagLoaded = true;
     d_ptr->m_geotag = geotag;
 }
 
 void Media::clearGeotag () {
+    d_ptr->m_geotagLoaded = true;
     d_ptr->m_geotag.clear ();
 }
 
@@ -810,9 +982,10 @@ QStringList Media::contactsToNames(const QStringList &contactUrns) {
 /*******************************************************************************
  * Definition of functions for MediaPrivate
  ******************************************************************************/
-MediaPrivate::MediaPrivate (Media * parent) : QObject (parent),
-    m_media (parent), m_state(TRANSFER_STATE_UNINITIALIZED), m_size (-1),
-    m_hadError (false), m_sparqlConnection (0) {
+MediaPrivate::MediaPrivate (Media * parent) : m_media (parent),
+    m_state(TRANSFER_STATE_UNINITIALIZED), m_size (-1),
+    m_tagsLoaded (true), m_geotagLoaded (true), m_regionsLoaded (false),
+    m_hashAlgorithm (HASH_SHA1), m_hadError (false), m_sparqlConnection (0) {
 }
 
 MediaPrivate::~MediaPrivate() {
@@ -864,7 +1037,7 @@ bool MediaPrivate::initNoTrackerInfo(QDomElement & mediaElem) {
 
         QString mimeType = mediaElem.attribute("mime", "");
         if (mimeType.isEmpty() == false) {
-            m_mimeType = mimeType;
+            m_mimeType = StringTable::string (mimeType);
         }
 
         QString copyString = mediaElem.attribute("copy", "");
@@ -874,6 +1047,14 @@ bool MediaPrivate::initNoTrackerInfo(QDomElement & mediaElem) {
             m_size = fileInfo.size();
             m_copyFileUri = QUrl::fromLocalFile (copyString);
 
+            QString hashString = mediaElem.attribute("hash", "");
+            if (!hashString.isEmpty()) {
+                m_hashAlgorithm = (hashString.section (':', 0, 0) == "md5") ?
+                    HASH_MD5 : HASH_SHA1;
+                m_contentHash = QByteArray::fromHex (
+                    hashString.section (':', 1).toLatin1());
+            }
+
         } else {
             qDebug() << "Copy file not created yet";
         }
@@ -901,8 +1082,8 @@ bool MediaPrivate::initNoTrackerInfo(QDomElement & mediaElem) {
                 QDomElement e1 = n1.toElement();
                 QString tagUrl = e1.attribute ("tracker_url");
                 if(e1.tagName() == "tag") {
-                    m_tags << e1.text();
-                    m_tagUrls << QUrl (tagUrl);
+                    m_tags << StringTable::string (e1.text());
+                    m_tagUrls << StringTable::url (tagUrl);
                 } else {
                     qDebug() << "Invalid tagName " << e1.tagName() <<
                         ".  Expected \"tag\"";
@@ -943,7 +1124,8 @@ bool MediaPrivate::initNoTrackerInfo(QDomElement & mediaElem) {
 
                 if (optionId.isEmpty() == false) {
                     QString optionValue = e1.text();
-                    m_options.insert (optionId, optionValue);
+                    m_options.insert (StringTable::string (optionId),
+                        optionValue);
                 }
 
                 n1 = n1.nextSibling();
@@ -995,6 +1177,14 @@ Media::CopyResult MediaPrivate::makeCopyOfFile (
 
     QString originalFilePath = srcFilePath ();
 
+    m_contentHash.clear();
+    m_hashAlgorithm = HASH_SHA1;
+    const Entry * entry = m_media->entry();
+    if (entry != 0 && !entry->account().isNull() &&
+        entry->account()->service() != 0) {
+        m_hashAlgorithm = entry->account()->service()->contentHashAlgorithm();
+    }
+
     if (m_mimeType.startsWith ("image/")) {
         result = processImage(originalFilePath, targetPath, imageResizeOption);
     } else if (m_mimeType.startsWith ("video/")) {
@@ -1012,7 +1202,7 @@ Media::CopyResult MediaPrivate::makeCopyOfFile (
 
 
 Media::CopyResult MediaPrivate::scaleAndSaveImage (const QString & origPath,
-    QString& copyPath, ImageResizeOption imageResizeOption) {
+    QString& copyPath, ImageResizeOption imageResizeOption, bool hashContent) {
 
     // Get the original size
     QImageReader originalImage (origPath);
@@ -1099,17 +1289,27 @@ Media::CopyResult MediaPrivate::scaleAndSaveImage (const QString & origPath,
         return Media::COPY_RESULT_UNDEFINED_FAILURE;
     }
 
-    QImageWriter savedImage (copyPath);
+    // Image is hashed while it is written
+    QCryptographicHash hash (cryptoAlgorithm (m_hashAlgorithm));
+    HashingFile copyFile (copyPath, hashContent ? &hash : 0);
+    QImageWriter savedImage (&copyFile);
     if (!savedImage.canWrite ()) {
         qDebug() << "Can't save image. Setting format as PNG";
         savedImage.setFormat ("png");
         copyPath.append (".png");
-        savedImage.setFileName (copyPath);
+        copyFile.close ();
+        copyFile.setFileName (copyPath);
         m_mimeType = "image/png";
     }
 
     qDebug() << copyPath;
     if (savedImage.write (resizedImage)) {
+        copyFile.close ();
+        if (copyFile.isHashValid ()) {
+            m_contentHash = hash.result ();
+        } else if (hashContent) {
+            hashFile (copyPath);
+        }
         return Media::COPY_RESULT_SUCCESS;
     } else {
         qCritical () << 
@@ -1127,7 +1327,8 @@ bool MediaPrivate::fastInitFromTrackerIri (const QString & tIri,
         fileTitle, fileDesc);
 
     if (success) {
-        success = getTagsFromTracker ();
+        // Tags and geotag are read when first needed
+        resetLazyMetadata ();
     }
     
     return success;
@@ -1139,7 +1340,7 @@ bool MediaPrivate::fastInitFromTrackerIriNoTags (const QString & tIri,
 
     m_origFileTrackerUri = tIri;
     m_origFileUri = fileUri;
-    m_mimeType = mimeType;
+    m_mimeType = StringTable::string (mimeType);
     m_size = size;
     m_metadataTitle = fileTitle;
     m_metadataDescription = fileDesc;
@@ -1147,12 +1348,25 @@ bool MediaPrivate::fastInitFromTrackerIriNoTags (const QString & tIri,
     QString filePath = srcFilePath ();
     m_fileName = QFileInfo(filePath).fileName();
     m_copyFileUri.clear();
+    m_contentHash.clear();
     m_state = TRANSFER_STATE_PENDING;
+    m_regionsLoaded = false;
 
     return true;
 }
 
-bool MediaPrivate::getTagsFromTracker () {
+bool MediaPrivate::loadTags () {
+    if (m_tagsLoaded) {
+        return true;
+    }
+
+    // Marked loaded also on failure so that failing query isn't repeated on
+    // every access
+    m_tagsLoaded = true;
+    if (m_origFileTrackerUri.isEmpty()) {
+        return true;
+    }
+
     qDebug() << "PERF: Getting tags for " << m_origFileUri << ": START";
 
     QString queryString = "SELECT ?tagUrl ?tag WHERE { "
@@ -1167,14 +1381,30 @@ bool MediaPrivate::getTagsFromTracker () {
     } else {
         // Query can have 0 rows as well - when there are no tags
         while (result->next ()) {
-            m_tagUrls << result->binding(0).value().toString();
-            m_tags << result->binding(1).value().toString();
+            QUrl tagUrl = result->binding(0).value().toString();
+            if (!m_tagUrls.contains (tagUrl)) {
+                m_tagUrls << StringTable::url (tagUrl);
+                m_tags << StringTable::string (
+                    result->binding(1).value().toString());
+            }
         } 
 
         delete result;
     }
 
     qDebug() << "PERF: Getting tags for " << m_origFileUri << ": END";
+    return true;
+}
+
+bool MediaPrivate::loadGeotag () {
+    if (m_geotagLoaded) {
+        return true;
+    }
+
+    m_geotagLoaded = true;
+    if (m_origFileTrackerUri.isEmpty()) {
+        return true;
+    }
 
     qDebug() << "PERF: Getting geotag for " << m_origFileUri << ": START";
     QString geotagQueryString = "SELECT ?country ?city ?district WHERE { "
@@ -1191,7 +1421,7 @@ bool MediaPrivate::getTagsFromTracker () {
     QSparqlQuery geotagQuery (geotagQueryString);
     geotagQuery.bindValue ("ieElem", m_origFileTrackerUri);
 
-    result = blockingSparqlQuery (geotagQuery);
+    QSparqlResult * result = blockingSparqlQuery (geotagQuery);
     if (result == 0) {
         return false;
     } else {
@@ -1215,6 +1445,37 @@ bool MediaPrivate::getTagsFromTracker () {
     return true;
 }
 
+void MediaPrivate::loadRegions () {
+    if (m_regionsLoaded) {
+        return;
+    }
+
+    m_regionsLoaded = true;
+    m_regions.clear ();
+
+    QuillMetadata metadata (srcFilePath(), QuillMetadata::XmpFormat);
+    QVariant variant = metadata.entry (QuillMetadata::Tag_Regions);
+    if (!variant.isNull() && variant.canConvert<QuillMetadataRegionList>()) {
+        m_regions = variant.value<QuillMetadataRegionList>();
+    }
+}
+
+void MediaPrivate::resetLazyMetadata () {
+    m_tags.clear ();
+    m_tagUrls.clear ();
+    m_geotag.clear ();
+    m_regions.clear ();
+
+    m_tagsLoaded = false;
+    m_geotagLoaded = false;
+    m_regionsLoaded = false;
+}
+
+bool MediaPrivate::isFiltered (MetadataFilter filter) const {
+    const Entry * entry = m_media->entry ();
+    return (entry != 0 && entry->checkShareFilter (filter));
+}
+
 QUrl MediaPrivate::convertTrackerUrl (QUrl url) {
     // QUrl url = dao->getUrl();
     QByteArray array = url.toString().toAscii();
@@ -1272,7 +1533,8 @@ bool MediaPrivate::initFromTrackerIri (const QString &tUri) {
     m_size = result->binding(1).value().toInt();
 
     if (m_mimeType.isEmpty()) {
-        m_mimeType = result->binding(2).value().toString();
+        m_mimeType = StringTable::string (
+            result->binding(2).value().toString());
         qDebug() << "Media mime-type is:" << m_mimeType;
         if (m_mimeType.isEmpty()) {
             qWarning() << "Media, Failed resolve mime type";
@@ -1286,9 +1548,11 @@ bool MediaPrivate::initFromTrackerIri (const QString &tUri) {
     QString filePath = srcFilePath ();
     m_fileName = QFileInfo(filePath).fileName();
     m_copyFileUri.clear();
+    m_contentHash.clear();
     m_state = TRANSFER_STATE_PENDING;
 
-    getTagsFromTracker ();
+    // Tags and geotag are read when first needed
+    resetLazyMetadata ();
 
     qDebug() << "PERF: MediaInit END";    
     return true;
@@ -1345,6 +1609,7 @@ bool MediaPrivate::initFromDataUri (const MDataUri & dUri) {
     
     m_copiedTextData = myUri.toString();
     m_copyFileUri.clear();
+    m_contentHash.clear();
     m_state = TRANSFER_STATE_PENDING;
         
     return true;
@@ -1368,6 +1633,11 @@ QDomElement MediaPrivate::serializeToXML(QDomDocument & doc, int options) {
     // Store file path of copied file or textData
     if (m_copyFileUri.isEmpty() == false) {
         mediaTag.setAttribute ("copy", m_copyFileUri.toLocalFile());
+        if (m_contentHash.isEmpty() == false) {
+            // e.g. "sha1:2fd4e1c6..."
+            mediaTag.setAttribute ("hash", hashAlgorithmName (m_hashAlgorithm)
+                + ':' + QString::fromLatin1 (m_contentHash.toHex()));
+        }
     } else  if (m_copiedTextData.isEmpty() == false) {
         mediaTag.setAttribute ("textData", m_copiedTextData);    
     }
@@ -1393,7 +1663,10 @@ QDomElement MediaPrivate::serializeToXML(QDomDocument & doc, int options) {
     mediaTag.appendChild(dataTag);
 
     // Tags
-    if (options != METADATA_FILTER_TAGS) {
+    if ((options & METADATA_FILTER_TAGS) == 0) {
+        loadTags ();
+        loadGeotag ();
+
         if (m_tags.isEmpty() == false) {
             dataTag = doc.createElement("tags");
             for (int i = 0; i < m_tags.size(); ++i) {
@@ -1556,7 +1829,8 @@ bool MediaPrivate::readTrackerInfo(QSparqlResult *result) {
         if (m_mimeType.isEmpty ()) {
             // If mime info could not be read from the xml file, only then do
             // we need it from tracker
-            m_mimeType = result->binding(5).value().toString();
+            m_mimeType = StringTable::string (
+                result->binding(5).value().toString());
             if(m_mimeType.isEmpty()) {
                 qCritical() << "Media, failed to resolve mime type";
                 return false;
@@ -1775,6 +2049,7 @@ bool MediaPrivate::removeFileCopy () {
 
     qDebug() << "Media file" << copyPath << "removed";
     m_copyFileUri.clear();
+    m_contentHash.clear();
     return true;
 }
 
@@ -1926,26 +2201,37 @@ Media::CopyResult MediaPrivate::processImage(const QString& originalFilePath,
     QString targetFile = targetPath;
     Media::CopyResult result = Media::COPY_RESULT_UNDEFINED_FAILURE;
 
+    // Copies whose metadata is rewritten are not hashed while copying, the
+    // hash would be thrown away. A GIF is rewritten only if there is
+    // something to filter, and a scaled GIF is saved in another format.
+    MetadataFilters filters (entry->metadataFilterOption());
+    bool quillRewrite = QuillMetadata::canRead (originalFilePath);
+    bool gifRewrite = (m_mimeType == "image/gif") &&
+        (filters.testFlag (METADATA_FILTER_ALL) ||
+        filters.testFlag (METADATA_FILTER_AUTHOR_LOCATION));
+
     if (imageResizeOption != IMAGE_RESIZE_NONE) {
         qDebug() << "scaling and copying image";
 
         result = scaleAndSaveImage (originalFilePath, targetFile,
-            imageResizeOption);
+            imageResizeOption, !quillRewrite);
 
         if (result == Media::COPY_RESULT_FILETYPE_NOT_ACCEPTED) {
             qDebug() << "Scaling failed, have to make normal copy";
-            result = copyFile(originalFilePath, targetFile);
+            result = copyFile(originalFilePath, targetFile,
+                !(quillRewrite || gifRewrite));
         }
     } else {
         qDebug() << "only copying image";
-        result = copyFile(originalFilePath, targetFile);
+        result = copyFile(originalFilePath, targetFile,
+            !(quillRewrite || gifRewrite));
     }
 
     if (result == Media::COPY_RESULT_SUCCESS) {
         qDebug() << "image copied to" << targetFile;
 
-        if (QuillMetadata::canRead(originalFilePath)) {
-            MetadataFilters filters (entry->metadataFilterOption());
+        // GIF metadata is filtered by metawriter, not by QuillMetadata
+        if (m_mimeType == "image/gif" || quillRewrite) {
             result = filterAndSyncImageMetadata (originalFilePath,
                 targetFile, filters);
 
@@ -1955,6 +2241,12 @@ Media::CopyResult MediaPrivate::processImage(const QString& originalFilePath,
             }
         }
 
+        // Metadata was rewritten after copying or the copy was expected to
+        // be rewritten but wasn't. Only then the final file is read again.
+        if (m_contentHash.isEmpty()) {
+            hashFile (targetFile);
+        }
+
         QFileInfo targetFileInfo (targetFile);
         m_size = targetFileInfo.size();
         qDebug() << "Size after any resizing that might be done is " << m_size;
@@ -1989,7 +2281,11 @@ Media::CopyResult MediaPrivate::processVideo(const QString& originalFilePath,
     if (result != Media::COPY_RESULT_SUCCESS) {
         qDebug() << "filtering failed, making plain copy";
         result = copyFile(originalFilePath, targetPath);
-    } 
+    } else {
+        // Copy is written by metawriter in its own process, so it is read
+        // once more here to hash it. Nothing was hashed before this.
+        hashFile (targetPath);
+    }
 
     if (result == Media::COPY_RESULT_SUCCESS) {
         QFileInfo targetFileInfo (targetPath);
@@ -2018,17 +2314,75 @@ Media::CopyResult MediaPrivate::processGenericFile(
 
 
 Media::CopyResult MediaPrivate::copyFile(const QString& originalFilePath,
-    const QString& targetPath) {
+    const QString& targetPath, bool hashContent) {
 
-    Media::CopyResult result = Media::COPY_RESULT_SUCCESS;
+    QFile original (originalFilePath);
+    QFile target (targetPath);
+
+    // Like QFile::copy, never overwrite existing file
+    if (target.exists() || !original.open (QIODevice::ReadOnly) ||
+        !target.open (QIODevice::WriteOnly)) {
 
-    if(!QFile::copy(originalFilePath, targetPath)) {
         qWarning() << "Could not copy" << originalFilePath << "to"
             << targetPath;
-        result = Media::COPY_RESULT_UNDEFINED_FAILURE;
+        return Media::COPY_RESULT_UNDEFINED_FAILURE;
     }
 
-    return result;
+    // Content is hashed while it is copied, so that it doesn't have to be
+    // read again
+    QCryptographicHash hash (cryptoAlgorithm (m_hashAlgorithm));
+    QByteArray block;
+    block.resize (MEDIA_COPY_BLOCK);
+
+    qint64 length = 0;
+    while ((length = original.read (block.data(), block.size())) > 0) {
+        if (target.write (block.constData(), length) != length) {
+            break;
+        }
+        if (hashContent) {
+            hash.addData (block.constData(), length);
+        }
+    }
+
+    if (length != 0 || !target.flush()) {
+        qWarning() << "Could not copy" << originalFilePath << "to"
+            << targetPath << original.errorString() << target.errorString();
+        target.close ();
+        target.remove ();
+        return Media::COPY_RESULT_UNDEFINED_FAILURE;
+    }
+
+    target.close ();
+    target.setPermissions (original.permissions());
+    if (hashContent) {
+        m_contentHash = hash.result ();
+    }
+
+    return Media::COPY_RESULT_SUCCESS;
+}
+
+bool MediaPrivate::hashFile (const QString & filePath) {
+    m_contentHash.clear();
+
+    QFile file (filePath);
+    if (!file.open (QIODevice::ReadOnly)) {
+        qWarning() << "Can't hash" << filePath << file.errorString();
+        return false;
+    }
+
+    QCryptographicHash hash (cryptoAlgorithm (m_hashAlgorithm));
+    QByteArray block;
+    while (!(block = file.read (MEDIA_COPY_BLOCK)).isEmpty()) {
+        hash.addData (block);
+    }
+
+    if (!file.atEnd()) {
+        qWarning() << "Failed to read" << filePath << file.errorString();
+        return false;
+    }
+
+    m_contentHash = hash.result ();
+    return true;
 }
 
 
@@ -2039,7 +2393,6 @@ Media::CopyResult MediaPrivate::filterAndSyncVideoMetadata(
 
     qDebug() << "Filtering and syncing video metadata";
 
-    const QString metaEditor = "/usr/lib/webupload-engine/metawriter";
     QStringList arguments;
     arguments << "-i" << originalFilePath;
     arguments << "-o" << targetPath;
@@ -2055,7 +2408,14 @@ Media::CopyResult MediaPrivate::filterAndSyncVideoMetadata(
         arguments << "--description" << m_media->description(true);
     }
 
-    QProcess metaSyncProcess (this);
+    return runMetawriter(arguments);
+}
+
+
+
+Media::CopyResult MediaPrivate::runMetawriter(const QStringList& arguments) {
+    const QString metaEditor = "/usr/lib/webupload-engine/metawriter";
+    QProcess metaSyncProcess;
     int exitCode = EXIT_FAILURE;
 
     qDebug() << "running metawriter: " << arguments;
@@ -2091,13 +2451,41 @@ Media::CopyResult MediaPrivate::filterAndSyncImageMetadata(
     MetadataFilters filters) {
 
     if (m_mimeType == "image/gif") {
-        //TODO: Check with AB about this later.
-        qWarning () << "Not supporting handling gif image metadata currently";
+        // GIF can only carry comments and XMP. metawriter strips them into
+        // a new file that replaces the copy; setting title or description
+        // is not supported.
+        QString filteredPath = targetPath + ".filtered";
+        QStringList arguments;
+        arguments << "-i" << targetPath << "-o" << filteredPath;
+
+        if (filters.testFlag(METADATA_FILTER_ALL)) {
+            arguments << "-x";
+        } else if (filters.testFlag(METADATA_FILTER_AUTHOR_LOCATION)) {
+            arguments << "-c";
+        } else {
+            return Media::COPY_RESULT_SUCCESS;
+        }
+
+        if (runMetawriter(arguments) != Media::COPY_RESULT_SUCCESS ||
+            ::rename (QFile::encodeName (filteredPath).constData(),
+                QFile::encodeName (targetPath).constData()) != 0) {
+
+            // GIF metadata used to be sent as it is, keep doing that
+            // rather than failing the whole upload
+            qWarning() << "Could not filter GIF metadata, using plain copy";
+            QFile::remove (filteredPath);
+        } else {
+            m_contentHash.clear();
+        }
+
         return Media::COPY_RESULT_SUCCESS;
     }
 
     bool metadataWritten = false;
 
+    // Metadata is written in place, any hash of the copy is stale
+    m_contentHash.clear();
+
     QuillMetadata originalMetadata(originalFilePath);
     if (filters.testFlag(METADATA_FILTER_ALL)) {
         QVariant orientation =
@@ -2115,11 +2503,12 @@ Media::CopyResult MediaPrivate::filterAndSyncImageMetadata(
         originalMetadata.setEntry (QuillMetadata::Tag_Subject,
             m_media->tags());
 
+        const GeotagInfo & geotag = m_media->geotag ();
         originalMetadata.setEntry (QuillMetadata::Tag_Country,
-            m_geotag.country());
-        originalMetadata.setEntry (QuillMetadata::Tag_City, m_geotag.city());
+            geotag.country());
+        originalMetadata.setEntry (QuillMetadata::Tag_City, geotag.city());
         originalMetadata.setEntry (QuillMetadata::Tag_Location, 
-            m_geotag.district());
+            geotag.district());
 
         if (filters.testFlag(METADATA_FILTER_AUTHOR_LOCATION)) {
             qDebug() << "Removing creator and location from the metadata";
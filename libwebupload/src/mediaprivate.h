@@ -21,7 +21,6 @@
 #ifndef _WEBUPLOAD_MEDIA_PRIVATE_H_
 #define _WEBUPLOAD_MEDIA_PRIVATE_H_
 
-#include <QObject>
 #include "WebUpload/Media"
 #include "WebUpload/enums.h"
 #include <QString>
@@ -42,16 +41,18 @@ namespace WebUpload {
     /*
      * Currently not storing the pointers to the applications that started the
      * transfer and process the transfer
+     *
+     * Not a QObject: entries can have thousands of media and the public
+     * object already is one. Repeated strings (mime types, option ids and
+     * tags) are stored through StringTable.
      */
-    class MediaPrivate : public QObject {
-    
-        Q_OBJECT
+    class MediaPrivate {
     
     public:
     
         /*!
           \brief Constructor
-          \param parent Parent QObject
+          \param parent Public object
         */
         MediaPrivate (Media * parent = 0);
         
@@ -78,6 +79,14 @@ namespace WebUpload {
 
         GeotagInfo m_geotag; //!< Geotag info associated with this media
 
+        //! False until tags of media initialized from tracker are read
+        bool m_tagsLoaded;
+        //! False until geotag of media initialized from tracker is read
+        bool m_geotagLoaded;
+        //! False until region metadata is read from the file
+        bool m_regionsLoaded;
+        QuillMetadataRegionList m_regions; //!< Cached region metadata
+
         //! Tracker types, or empty if not yet queried
         QList<QUrl> m_trackerTypes;
 
@@ -88,6 +97,8 @@ namespace WebUpload {
         QUrl m_origFileTrackerUri; //!< Tracker IRI of the original file
         QUrl m_origFileUri; //!< URI of original file
         QUrl m_copyFileUri; //<! URI of copied file            
+        QByteArray m_contentHash; //!< Hash of copied file content
+        HashAlgorithm m_hashAlgorithm; //!< Algorithm of m_contentHash
     
         QString m_fileName; //!< Original file name
 
@@ -141,11 +152,35 @@ namespace WebUpload {
             bool singleResponse=false);
 
         /*!
-          \brief Get tags for media with given tracker uri
+          \brief Read tags from tracker if not already read.
                  m_origFileTrackerUri should have been been set before this is
                  called
+          \return <code>false</code> if tracker query failed
+         */
+        bool loadTags ();
+
+        /*!
+          \brief Read geotag from tracker if not already read.
+          \return <code>false</code> if tracker query failed
+         */
+        bool loadGeotag ();
+
+        /*!
+          \brief Read region metadata from the file if not already read.
+         */
+        void loadRegions ();
+
+        /*!
+          \brief Mark tags, geotag and regions to be read when next needed
          */
-        bool getTagsFromTracker ();
+        void resetLazyMetadata ();
+
+        /*!
+          \brief Check if entry of media filters given metadata
+          \param filter Metadata checked
+          \return <code>true</code> if media is in entry filtering metadata
+         */
+        bool isFiltered (MetadataFilter filter) const;
 
         bool initFromDataUri (const MDataUri & dUri);
         
@@ -210,10 +245,13 @@ namespace WebUpload {
           \brief scale the image and copy to the temp file
           \param path to which the copy is stored                
           \param resizeOption image resize option
+          \param hashContent Hash the image while it is written. Set false
+                 if the copy is rewritten afterwards anyway.
           \return result
         */
         Media::CopyResult scaleAndSaveImage (const QString & origPath, 
-            QString & copyPath, ImageResizeOption resizeOption);
+            QString & copyPath, ImageResizeOption resizeOption,
+            bool hashContent = true);
         
         /*!
           \brief Remove copy of file
@@ -288,10 +326,20 @@ namespace WebUpload {
           \brief Try to make a direct copy of a file
           \param originalFilePath Full path to the original file
           \param targetPath Full path to the target file
+          \param hashContent Hash the content while it is copied. Set false
+                 if the copy is rewritten afterwards anyway.
           \return Operation result
          */
         Media::CopyResult copyFile(const QString& originalFilePath,
-            const QString& targetPath);
+            const QString& targetPath, bool hashContent = true);
+
+        /*!
+          \brief Calculate content hash by reading file. Used when the file
+                 has been changed after it was written.
+          \param filePath Path to the file
+          \return true if file could be read
+         */
+        bool hashFile (const QString & filePath);
 
 
         /*!
@@ -305,7 +353,8 @@ namespace WebUpload {
             MetadataFilters filters);
         
         /*!
-          \brief Filter and sync metadata to target file
+          \brief Filter and sync metadata to target file. Content hash is
+                 cleared if the target file is changed.
           \param originalFilePath Source file path
           \param targetPath Destination file path
           \return Result of this step
@@ -314,6 +363,13 @@ namespace WebUpload {
             const QString& originalFilePath, const QString& targetPath,
             MetadataFilters filters);
 
+        /*!
+          \brief Run metawriter
+          \param arguments Arguments for metawriter
+          \return Result of this step
+         */
+        Media::CopyResult runMetawriter(const QStringList& arguments);
+
     };
 }
 
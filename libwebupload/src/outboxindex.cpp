@@ -0,0 +1,395 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "outboxindex.h"
+#include "WebUpload/Entry"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QDomDocument>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+using namespace WebUpload;
+
+const char * const OutboxIndex::INDEX_FILE_NAME = "outbox-index.xml";
+const char * const OutboxIndex::LOCK_FILE_NAME = "outbox-index.lock";
+
+const QString indexVersion = "1.0";
+
+// Names used for transfer states in index file
+static const char * const stateNames[TRANSFER_STATE_MAX] = {
+    "uninitialized", "pending", "active", "cancelled", "done", "paused"
+};
+
+static QString stateName (int state) {
+    if (state < TRANSFER_STATE_START || state >= TRANSFER_STATE_MAX) {
+        state = TRANSFER_STATE_UNINITIALIZED;
+    }
+    return QLatin1String (stateNames[state]);
+}
+
+static int stateFromName (const QString & name) {
+    for (int i = TRANSFER_STATE_START; i < TRANSFER_STATE_MAX; ++i) {
+        if (name == QLatin1String (stateNames[i])) {
+            return i;
+        }
+    }
+    return TRANSFER_STATE_UNINITIALIZED;
+}
+
+OutboxRecord::OutboxRecord () : m_totalSize (0),
+    m_state (TRANSFER_STATE_UNINITIALIZED), m_failed (false) {
+}
+
+bool OutboxRecord::isValid () const {
+    return !m_path.isEmpty();
+}
+
+const QString & OutboxRecord::path () const {
+    return m_path;
+}
+
+const QDateTime & OutboxRecord::created () const {
+    return m_created;
+}
+
+const QString & OutboxRecord::accountId () const {
+    return m_accountId;
+}
+
+qint64 OutboxRecord::totalSize () const {
+    return m_totalSize;
+}
+
+bool OutboxRecord::isPending () const {
+    return (m_state == TRANSFER_STATE_PENDING) && (m_failed == false);
+}
+
+bool OutboxRecord::isActive () const {
+    return (m_state == TRANSFER_STATE_ACTIVE);
+}
+
+bool OutboxRecord::isPaused () const {
+    return (m_state == TRANSFER_STATE_PAUSED);
+}
+
+bool OutboxRecord::hasError () const {
+    return m_failed;
+}
+
+bool OutboxRecord::isSent () const {
+    return (m_state == TRANSFER_STATE_DONE);
+}
+
+bool OutboxRecord::isCanceled () const {
+    return (m_state == TRANSFER_STATE_CANCELLED);
+}
+
+OutboxIndexLock::OutboxIndexLock (const QString & outboxPath) : m_fd (-1) {
+    QString lockPath = QDir (outboxPath).filePath (
+        OutboxIndex::LOCK_FILE_NAME);
+
+    int fd = ::open (QFile::encodeName (lockPath).constData(),
+        O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        qWarning() << "Can't open outbox index lock" << lockPath;
+        return;
+    }
+
+    int ret = 0;
+    do {
+        ret = ::flock (fd, LOCK_EX);
+    } while (ret != 0 && errno == EINTR);
+
+    if (ret != 0) {
+        qWarning() << "Can't lock outbox index" << lockPath;
+        ::close (fd);
+        return;
+    }
+
+    m_fd = fd;
+}
+
+OutboxIndexLock::~OutboxIndexLock () {
+    if (m_fd >= 0) {
+        // Closing the file releases the lock
+        ::close (m_fd);
+    }
+}
+
+bool OutboxIndexLock::isLocked () const {
+    return (m_fd >= 0);
+}
+
+OutboxIndex::OutboxIndex (const QString & outboxPath) :
+    m_outboxPath (outboxPath) {
+}
+
+bool OutboxIndex::load () {
+
+    m_records.clear();
+
+    QDir dir (m_outboxPath);
+    QFile file (dir.filePath (INDEX_FILE_NAME));
+    if (!file.exists()) {
+        return true;
+    }
+
+    if (!file.open (QIODevice::ReadOnly)) {
+        qWarning() << "Can't read outbox index" << file.fileName();
+        return false;
+    }
+
+    QDomDocument doc;
+    if (!doc.setContent (&file)) {
+        qWarning() << "Invalid outbox index" << file.fileName();
+        file.close();
+        return false;
+    }
+    file.close();
+
+    QDomElement docElem = doc.documentElement();
+    if (docElem.tagName() != "outbox" ||
+        docElem.attribute ("version") != indexVersion) {
+
+        qWarning() << "Unknown outbox index format, ignoring it";
+        return false;
+    }
+
+    QDomElement e = docElem.firstChildElement ("entry");
+    for (; !e.isNull(); e = e.nextSiblingElement ("entry")) {
+        QString fileName = e.attribute ("file");
+        if (fileName.isEmpty()) {
+            continue;
+        }
+
+        OutboxRecord record;
+        record.m_path = dir.filePath (fileName);
+        record.m_created = QDateTime::fromString (e.attribute ("created"),
+            Qt::ISODate);
+        record.m_accountId = e.attribute ("account");
+        record.m_totalSize = e.attribute ("size").toLongLong();
+        record.m_state = stateFromName (e.attribute ("state"));
+        record.m_failed = (e.attribute ("failed") == "true");
+        record.m_modified = QDateTime::fromTime_t (
+            e.attribute ("modified").toUInt());
+
+        m_records.insert (fileName, record);
+    }
+
+    return true;
+}
+
+bool OutboxIndex::save () {
+
+    QDir dir (m_outboxPath);
+    if (!dir.exists()) {
+        return false;
+    }
+
+    QDomDocument doc;
+    QDomElement docElem = doc.createElement ("outbox");
+    docElem.setAttribute ("version", indexVersion);
+    doc.appendChild (docElem);
+
+    QMapIterator<QString, OutboxRecord> iter (m_records);
+    while (iter.hasNext()) {
+        iter.next();
+        const OutboxRecord & record = iter.value();
+
+        QDomElement e = doc.createElement ("entry");
+        e.setAttribute ("file", iter.key());
+        e.setAttribute ("created", record.m_created.toString (Qt::ISODate));
+        e.setAttribute ("account", record.m_accountId);
+        // Don't use setAttribute with numbers as it uses locales
+        e.setAttribute ("size", QString::number (record.m_totalSize));
+        e.setAttribute ("state", stateName (record.m_state));
+        e.setAttribute ("failed", record.m_failed ? "true" : "false");
+        e.setAttribute ("modified",
+            QString::number (record.m_modified.toTime_t()));
+        docElem.appendChild (e);
+    }
+
+    // Write to temporary file and rename it over the old index so that
+    // readers never see partially written index.
+    QString indexPath = dir.filePath (INDEX_FILE_NAME);
+    QTemporaryFile tempFile (indexPath + ".XXXXXX");
+    tempFile.setAutoRemove (false);
+    if (!tempFile.open()) {
+        qWarning() << "Can't create temp file for outbox index";
+        return false;
+    }
+
+    QByteArray data = doc.toByteArray (1);
+    bool written = (tempFile.write (data) == data.size());
+    tempFile.close();
+
+    if (!written || ::rename (QFile::encodeName (tempFile.fileName()).constData(),
+        QFile::encodeName (indexPath).constData()) != 0) {
+
+        qWarning() << "Failed to write outbox index" << indexPath;
+        tempFile.remove();
+        return false;
+    }
+
+    return true;
+}
+
+QList<OutboxRecord> OutboxIndex::records () const {
+    return m_records.values();
+}
+
+OutboxRecord OutboxIndex::record (const QString & entryPath) const {
+    return m_records.value (QFileInfo (entryPath).fileName());
+}
+
+void OutboxIndex::insert (OutboxRecord record) {
+    QFileInfo info (record.m_path);
+    record.m_modified = info.lastModified();
+    m_records.insert (info.fileName(), record);
+}
+
+bool OutboxIndex::remove (const QString & entryPath) {
+    return (m_records.remove (QFileInfo (entryPath).fileName()) > 0);
+}
+
+bool OutboxIndex::isStale (const OutboxRecord & record) {
+    QFileInfo info (record.m_path);
+    if (!info.exists()) {
+        return true;
+    }
+
+    return (info.lastModified().toTime_t() != record.m_modified.toTime_t());
+}
+
+bool OutboxIndex::isOutboxEntry (const QString & entryPath) {
+    QString fileName = QFileInfo (entryPath).fileName();
+    return fileName.startsWith ("entry_") && fileName.endsWith (".xml");
+}
+
+OutboxRecord OutboxIndex::createRecord (const QString & entryPath,
+    const QDateTime & created, const QString & accountId, TransferState state,
+    bool failed, qint64 totalSize) {
+
+    OutboxRecord record;
+    record.m_path = entryPath;
+    record.m_created = created;
+    record.m_accountId = accountId;
+    record.m_state = state;
+    record.m_failed = failed;
+    record.m_totalSize = totalSize;
+    return record;
+}
+
+OutboxRecord OutboxIndex::entryRecord (const Entry * entry) {
+
+    TransferState state = TRANSFER_STATE_PENDING;
+    if (entry->isActive()) {
+        state = TRANSFER_STATE_ACTIVE;
+    } else if (entry->isPaused()) {
+        state = TRANSFER_STATE_PAUSED;
+    } else if (entry->isSent()) {
+        state = TRANSFER_STATE_DONE;
+    } else if (entry->isCanceled()) {
+        state = TRANSFER_STATE_CANCELLED;
+    }
+
+    return createRecord (entry->serializedTo(), entry->created(),
+        entry->accountId(), state, entry->hasError(), entry->totalSize());
+}
+
+void OutboxIndex::storeEntry (const OutboxRecord & record) {
+    if (!isOutboxEntry (record.m_path)) {
+        return;
+    }
+
+    QString outboxPath = QFileInfo (record.m_path).absolutePath();
+    OutboxIndexLock lock (outboxPath);
+    OutboxIndex index (outboxPath);
+    index.load();
+    index.insert (record);
+    index.save();
+}
+
+void OutboxIndex::updateEntryState (const QString & entryPath,
+    TransferState state, bool failed) {
+
+    if (!isOutboxEntry (entryPath)) {
+        return;
+    }
+
+    QString outboxPath = QFileInfo (entryPath).absolutePath();
+    OutboxIndexLock lock (outboxPath);
+    OutboxIndex index (outboxPath);
+    index.load();
+
+    QString fileName = QFileInfo (entryPath).fileName();
+    QMap<QString, OutboxRecord>::iterator iter = index.m_records.find (
+        fileName);
+    if (iter == index.m_records.end()) {
+        return;
+    }
+
+    if (iter->m_state == state && iter->m_failed == failed) {
+        return;
+    }
+
+    iter->m_state = state;
+    iter->m_failed = failed;
+    index.save();
+}
+
+void OutboxIndex::removeEntry (const QString & entryPath) {
+    if (!isOutboxEntry (entryPath)) {
+        return;
+    }
+
+    QString outboxPath = QFileInfo (entryPath).absolutePath();
+    OutboxIndexLock lock (outboxPath);
+    OutboxIndex index (outboxPath);
+    index.load();
+    if (index.remove (entryPath)) {
+        index.save();
+    }
+}
+
+QList<OutboxRecord> OutboxIndex::repair (const QString & outboxPath,
+    const QStringList & removedPaths, const QList<OutboxRecord> & added) {
+
+    OutboxIndexLock lock (outboxPath);
+    OutboxIndex index (outboxPath);
+    index.load();
+
+    for (int i = 0; i < removedPaths.count(); ++i) {
+        index.remove (removedPaths.at (i));
+    }
+
+    for (int i = 0; i < added.count(); ++i) {
+        index.insert (added.at (i));
+    }
+
+    index.save();
+    return index.records();
+}
@@ -0,0 +1,188 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _WEBUPLOAD_OUTBOX_INDEX_H_
+#define _WEBUPLOAD_OUTBOX_INDEX_H_
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QDateTime>
+#include <QStringList>
+#include "WebUpload/outboxrecord.h"
+#include "internalenums.h"
+
+namespace WebUpload {
+
+    class Entry;
+
+    /*!
+      \class OutboxIndexLock
+      \brief Lock held while outbox index is read, changed and written back.
+             Engine, plugins and UI all update the index, so the lock is a
+             file lock shared between processes. Lock is released when
+             object is destroyed.
+     */
+    class OutboxIndexLock {
+
+    public:
+
+        /*!
+          \brief Take lock of index in outbox. Blocks until lock is free.
+          \param outboxPath Directory where entries are serialized
+         */
+        OutboxIndexLock (const QString & outboxPath);
+
+        ~OutboxIndexLock ();
+
+        /*!
+          \brief Check if lock was taken
+          \return <code>false</code> if lock file could not be used
+         */
+        bool isLocked () const;
+
+    private:
+
+        Q_DISABLE_COPY(OutboxIndexLock)
+        int m_fd; //!< Descriptor of lock file, -1 if not locked
+    };
+
+    /*!
+      \class OutboxIndex
+      \brief Index file stored next to entries in outbox. Index is only a
+             cache of values found in entries: if it is missing or out of
+             date System will rebuild the missing records from the entries
+             themselves.
+     */
+    class OutboxIndex {
+
+    public:
+
+        /*!
+          \brief Create index for outbox
+          \param outboxPath Directory where entries are serialized
+         */
+        OutboxIndex (const QString & outboxPath);
+
+        /*!
+          \brief Read index file. Missing index file is not an error.
+          \return <code>false</code> if index file is invalid
+         */
+        bool load ();
+
+        /*!
+          \brief Write index file
+          \return <code>true</code> if index was written
+         */
+        bool save ();
+
+        /*!
+          \brief Records in index, in no particular order
+         */
+        QList<OutboxRecord> records () const;
+
+        /*!
+          \brief Get record for entry
+          \param entryPath Path of entry
+          \return Record found or invalid record
+         */
+        OutboxRecord record (const QString & entryPath) const;
+
+        /*!
+          \brief Add or replace record. Modification time of the entry file is
+                 read when record is added.
+         */
+        void insert (OutboxRecord record);
+
+        /*!
+          \brief Remove record of entry
+          \return <code>true</code> if there was record to remove
+         */
+        bool remove (const QString & entryPath);
+
+        /*!
+          \brief Check if record still matches entry file
+          \return <code>true</code> if entry has been modified after record
+                  was written or if entry file is missing
+         */
+        static bool isStale (const OutboxRecord & record);
+
+        /*!
+          \brief Check if path is an entry serialized to outbox
+          \return <code>true</code> if name of file is entry_*.xml
+         */
+        static bool isOutboxEntry (const QString & entryPath);
+
+        /*!
+          \brief Build record from values of entry
+         */
+        static OutboxRecord createRecord (const QString & entryPath,
+            const QDateTime & created, const QString & accountId,
+            TransferState state, bool failed, qint64 totalSize);
+
+        /*!
+          \brief Build record from loaded entry
+          \param entry Entry serialized to outbox
+         */
+        static OutboxRecord entryRecord (const Entry * entry);
+
+        /*!
+          \brief Store record of entry to the index of entry's outbox
+         */
+        static void storeEntry (const OutboxRecord & record);
+
+        /*!
+          \brief Update state of entry in the index of entry's outbox. Does
+                 nothing if entry isn't indexed.
+         */
+        static void updateEntryState (const QString & entryPath,
+            TransferState state, bool failed);
+
+        /*!
+          \brief Remove entry from the index of entry's outbox
+         */
+        static void removeEntry (const QString & entryPath);
+
+        /*!
+          \brief Apply repairs to index of outbox. Index is read again with
+                 the lock held, so that changes made by other processes
+                 since it was last read are not lost.
+          \param outboxPath Directory where entries are serialized
+          \param removedPaths Entries whose records are removed
+          \param added Records added or replaced
+          \return Records in the repaired index
+         */
+        static QList<OutboxRecord> repair (const QString & outboxPath,
+            const QStringList & removedPaths,
+            const QList<OutboxRecord> & added);
+
+        //! Name of lock file in outbox
+        static const char * const LOCK_FILE_NAME;
+
+        //! Name of index file in outbox
+        static const char * const INDEX_FILE_NAME;
+
+    private:
+
+        QString m_outboxPath; //!< Outbox directory
+        QMap<QString, OutboxRecord> m_records; //!< Records by file name
+    };
+}
+
+#endif
@@ -23,7 +23,9 @@
 #include "WebUpload/PostInterface"
 #include "WebUpload/UpdateInterface"
 #include "WebUpload/Entry"
+#include "WebUpload/Media"
 #include "WebUpload/Error"
+#include "WebUpload/RateLimiter"
 #include "pluginapplicationprivate.h"
 #include <fcntl.h>
 #include <QDebug>
@@ -74,6 +76,8 @@ PluginApplicationPrivate::PluginApplicationPrivate (PluginInterface * interface,
     // Incoming messages   
     connect (&m_coder, SIGNAL (stopSignal()), this, SLOT (stop()),
         Qt::QueuedConnection);
+    connect (&m_coder, SIGNAL (rateLimitSignal(qint64)), this,
+        SLOT (setRateLimit(qint64)), Qt::QueuedConnection);
     connect (&m_coder, SIGNAL (startUploadSignal(QString,WebUpload::Error)),
         this, SLOT (postStart(QString,WebUpload::Error)), Qt::QueuedConnection);
     connect (&m_coder, SIGNAL (updateAllSignal(QString)), this,
@@ -167,6 +171,14 @@ void PluginApplicationPrivate::postStart (const QString & pathToEntry,
         return;
     }
 
+    // Report media state changes, so that the engine does not need to read
+    // them back from tracker
+    for (unsigned int i = 0; i < m_entry->mediaCount (); ++i) {
+        connect (m_entry->mediaAt (i),
+            SIGNAL (stateChanged(const WebUpload::Media*)), this,
+            SLOT (postMediaStateChanged(const WebUpload::Media*)));
+    }
+
     m_post = m_interface->getPost();
     if (m_post == 0) {
         WebUpload::Error myError = WebUpload::Error::custom ("Plugin Error",
@@ -216,6 +228,10 @@ void PluginApplicationPrivate::stop () {
     }
 }
 
+void PluginApplicationPrivate::setRateLimit (qint64 bytesPerSecond) {
+    RateLimiter::shared()->setRate (bytesPerSecond);
+}
+
 void PluginApplicationPrivate::postError (WebUpload::Error error) {
     qDebug() << __FUNCTION__ << error.code();
     m_post->disconnect (this);
@@ -286,6 +302,21 @@ void PluginApplicationPrivate::postMediaStarted (WebUpload::Media* media) {
     send (m_coder.sendingMedia (index));
 }
 
+void PluginApplicationPrivate::postMediaStateChanged (
+    const WebUpload::Media * media) {
+
+    if ((m_entry == 0) || (media == 0)) {
+        return;
+    }
+
+    int index = m_entry->indexOf (const_cast<WebUpload::Media *>(media));
+    if (index < 0) {
+        return;
+    }
+
+    send (m_coder.mediaStateChanged (index, media->state ()));
+}
+
 bool PluginApplicationPrivate::initUpdate (const QString & accountStringId,
     const QStringList & optionIds) {
     
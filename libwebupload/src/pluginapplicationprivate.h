@@ -84,6 +84,12 @@ namespace WebUpload {
           \brief Stop current action
          */
         void stop ();
+
+        /*!
+          \brief Limit rate of uploads
+          \param bytesPerSecond Maximum rate, 0 if there is no limit
+         */
+        void setRateLimit (qint64 bytesPerSecond);
         
     private Q_SLOTS:
     
@@ -131,6 +137,12 @@ namespace WebUpload {
          */
         void postMediaStarted (WebUpload::Media* media);
         
+        /*!
+          \brief Slot for Media::stateChanged of media in the entry being
+                 uploaded
+         */
+        void postMediaStateChanged (const WebUpload::Media * media);
+        
         /*!
           \brief Slot for PostInterface::pending
          */
@@ -22,6 +22,7 @@
 #include "postbaseprivate.h"
 #include "WebUpload/Entry"
 #include "WebUpload/Media"
+#include "WebUpload/UploadLedger"
 #include <QDebug>
 
 #define DBG_PREFIX "PostBase:"
@@ -168,6 +169,10 @@ bool PostBase::canRetry (WebUpload::Error error) {
 }
 
 
+void PostBase::setSkipDuplicates (bool skip) {
+    d_ptr->skipDuplicates = skip;
+}
+
 void PostBase::mediaProgressSlot (float uploaded) {
 
 
@@ -206,7 +211,8 @@ void PostBase::errorFixedSlot () {
 
 PostBasePrivate::PostBasePrivate(PostBase * parent) : QObject (parent), 
     state (STATE_IDLE), totalSize(0), sentSize(0), ofItemDone(0.0),
-    prevTotalDone(0.0), publicObject (parent), authPtr (0) {
+    prevTotalDone(0.0), skipDuplicates (false), publicObject (parent),
+    authPtr (0) {
 
     reset ();
 }
@@ -233,6 +239,7 @@ void PostBasePrivate::reset () {
     sentSize = 0;
     ofItemDone = 0.0;
     prevTotalDone = 0.0;
+    mediaHash.clear ();
     transferError.clearError ();
 }
 
@@ -337,12 +344,30 @@ void PostBasePrivate::authResultSlot (int err) {
         DBG_STREAM << "Media authentication successful";
         state = STATE_UPLOAD_PENDING;
         Q_ASSERT (media->setActive());
+
+        if (skipDuplicates) {
+            mediaHash = UploadLedger::contentHash (media);
+            UploadLedger ledger (entry->accountId());
+            if (ledger.contains (mediaHash)) {
+                DBG_STREAM << "Media already sent, skipping it";
+                QMetaObject::invokeMethod (this, "mediaDoneSlot",
+                    Qt::QueuedConnection,
+                    Q_ARG(QString, ledger.destination (mediaHash)));
+                return;
+            }
+        }
+
         Q_EMIT (nowUploadMedia(media));
         return;
     } 
 
     DBG_STREAM << "Media authentication failed with code " << err;
 
+    // The token was not accepted, don't offer it again
+    if ((err == WebUpload::AuthBase::RESULT_UNAUTHORIZED) && (authPtr != 0)) {
+        authPtr->invalidateCachedAuth ();
+    }
+
     unsigned int unsentCount = entry->mediaCount () - entry->mediaSentCount ();
     reset ();
 
@@ -397,6 +422,14 @@ void PostBasePrivate::authUnknownErrorSlot (const QString &errMsg) {
 void PostBasePrivate::mediaDoneSlot (QString destUrl) {
     media->setCompleted (destUrl);
 
+    // Remember the content, so that it is not sent again to same account
+    if (mediaHash.isEmpty()) {
+        mediaHash = UploadLedger::contentHash (media);
+    }
+    UploadLedger ledger (entry->accountId());
+    ledger.record (mediaHash, destUrl);
+    mediaHash.clear ();
+
     sentSize = totalSize - entry->unsentSize ();
     ofItemDone = ((float)sentSize)/((float)totalSize);
     Q_EMIT (progress (ofItemDone));
@@ -427,6 +460,11 @@ void PostBasePrivate::mediaDoneSlot (QString destUrl) {
 }
         
 void PostBasePrivate::reAuthSlot () {
+    // Plugin asks again because the service did not accept the old token
+    if (authPtr != 0) {
+        authPtr->invalidateCachedAuth ();
+    }
+
     state = STATE_AUTH_PENDING;
     Q_EMIT (progress (0));
     startAuthentication ();
@@ -452,8 +490,13 @@ void PostBasePrivate::mediaErrorSlot (WebUpload::Error err) {
         << err.title() << ":" << err.description();
         
     media->setFailed();
+    mediaHash.clear ();
     transferError.merge (err);
 
+    if ((err.code() == WebUpload::Error::CODE_AUTH_FAILED) && (authPtr != 0)) {
+        authPtr->invalidateCachedAuth ();
+    }
+
     if (transferError.canContinue ()) {
         Media *nextMedia = entry->nextUnsentMedia ();
         if (nextMedia) {
@@ -170,6 +170,8 @@ namespace WebUpload {
         quint64 sentSize;
         float ofItemDone;
         float prevTotalDone;
+        bool skipDuplicates; //!< If media in UploadLedger are not sent
+        QByteArray mediaHash; //!< Content hash of media, if calculated
 
     private Q_SLOTS:
 
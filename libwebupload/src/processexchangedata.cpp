@@ -114,6 +114,18 @@ QByteArray ProcessExchangeData::stop () {
 }
 
 
+QByteArray ProcessExchangeData::rateLimit (qint64 bytesPerSecond) {
+
+    QByteArray data;
+    QDataStream ds (&data, QIODevice::WriteOnly);
+
+    ds << (qint32) ProcessExchangeDataPrivate::CODE_REQUEST_RATE_LIMIT;
+    ds << bytesPerSecond;
+
+    return ProcessExchangeDataPrivate::wrapSize (data);
+}
+
+
 QByteArray ProcessExchangeData::sendingMedia (quint32 index) {
 
     QByteArray data;
@@ -126,6 +138,21 @@ QByteArray ProcessExchangeData::sendingMedia (quint32 index) {
 }
 
 
+QByteArray ProcessExchangeData::mediaStateChanged (quint32 index,
+    qint32 state) {
+
+    QByteArray data;
+    QDataStream ds (&data, QIODevice::WriteOnly);
+
+    ds << 
+        (qint32) ProcessExchangeDataPrivate::CODE_REQUEST_MEDIA_STATE_CHANGED;
+    ds << index;
+    ds << state;
+
+    return ProcessExchangeDataPrivate::wrapSize (data);
+}
+
+
 QByteArray ProcessExchangeData::progress (float pAmt) {
 
     QByteArray data;
@@ -365,6 +392,15 @@ void ProcessExchangeDataPrivate::processByteArray (const QByteArray & recvdInfo)
                 Q_EMIT (q_ptr->stopSignal ());
                 break;
 
+            case CODE_REQUEST_RATE_LIMIT:
+            {
+                qint64 bytesPerSecond;
+                requestStream >> bytesPerSecond;
+                qDebug() << "rateLimitSignal";
+                Q_EMIT (q_ptr->rateLimitSignal (bytesPerSecond));
+                break;
+            }
+
             case CODE_REQUEST_SENDING_MEDIA:
             {
                 quint32 index;
@@ -374,6 +410,17 @@ void ProcessExchangeDataPrivate::processByteArray (const QByteArray & recvdInfo)
                 break;
             }
 
+            case CODE_REQUEST_MEDIA_STATE_CHANGED:
+            {
+                quint32 index;
+                qint32 state;
+                requestStream >> index;
+                requestStream >> state;
+                qDebug() << "mediaStateChangedSignal";
+                Q_EMIT (q_ptr->mediaStateChangedSignal (index, state));
+                break;
+            }
+
             case CODE_REQUEST_PROGRESS:
             {
                 float pAmt;
@@ -111,6 +111,8 @@ namespace WebUpload {
             CODE_REQUEST_UPDATE_FAILED,
             CODE_REQUEST_UPDATE_FAILED_ALTERNATIVE,
             CODE_REQUEST_OPTION_VALUE_CHANGED,
+            CODE_REQUEST_MEDIA_STATE_CHANGED,
+            CODE_REQUEST_RATE_LIMIT,
             #ifdef WARNINGS_ENABLED
             CODE_REQUEST_UPLOAD_WARNING,
             #endif
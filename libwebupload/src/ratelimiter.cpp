@@ -0,0 +1,113 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "WebUpload/RateLimiter"
+#include "ratelimiterprivate.h"
+#include <QCoreApplication>
+#include <QIODevice>
+#include <QPointer>
+#include <QTimer>
+#include <QDebug>
+
+using namespace WebUpload;
+
+// Bucket holds this much of the rate, so that bursts stay short
+#define RATE_BURST_MSEC 250
+// Smallest bucket, no use to hand out tinier reads than this
+#define RATE_MIN_BURST 4096
+
+RateLimiter::RateLimiter (QObject * parent) : QObject (parent),
+    d_ptr (new RateLimiterPrivate ()) {
+}
+
+RateLimiter::~RateLimiter () {
+    delete d_ptr;
+}
+
+RateLimiter * RateLimiter::shared () {
+    static QPointer<RateLimiter> limiter;
+
+    if (limiter.isNull()) {
+        limiter = new RateLimiter (QCoreApplication::instance());
+    }
+
+    return limiter;
+}
+
+void RateLimiter::setRate (qint64 bytesPerSecond) {
+    if (bytesPerSecond < 0) {
+        bytesPerSecond = 0;
+    }
+
+    qDebug() << "Upload rate limit" << bytesPerSecond << "B/s";
+
+    d_ptr->refill ();
+    d_ptr->rate = bytesPerSecond;
+    d_ptr->tokens = qMin (d_ptr->tokens, d_ptr->burst ());
+}
+
+qint64 RateLimiter::rate () const {
+    return d_ptr->rate;
+}
+
+qint64 RateLimiter::take (QIODevice * device, qint64 maxlen) {
+    if (d_ptr->rate <= 0 || maxlen <= 0) {
+        return maxlen;
+    }
+
+    d_ptr->refill ();
+
+    qint64 granted = qMin (maxlen, d_ptr->tokens);
+    if (granted > 0) {
+        d_ptr->tokens -= granted;
+        return granted;
+    }
+
+    // Wake reader up when a reasonable read fits in the bucket
+    qint64 wanted = qMin (maxlen, (qint64)RATE_MIN_BURST);
+    int waitMsec = (int)((wanted - d_ptr->tokens) * 1000 / d_ptr->rate) + 1;
+    if (device != 0) {
+        QTimer::singleShot (waitMsec, device, SIGNAL (readyRead()));
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+ *              RateLimiterPrivate functions
+ ****************************************************************************/
+
+RateLimiterPrivate::RateLimiterPrivate () : rate (0), tokens (0) {
+    lastRefill.start ();
+}
+
+void RateLimiterPrivate::refill () {
+    // Clock is moved only when bytes are added, so short intervals between
+    // reads of slow rates aren't lost
+    qint64 added = rate * lastRefill.elapsed () / 1000;
+    if (added > 0) {
+        tokens = qMin (tokens + added, burst ());
+        lastRefill.start ();
+    }
+}
+
+qint64 RateLimiterPrivate::burst () const {
+    return qMax (rate * RATE_BURST_MSEC / 1000, (qint64)RATE_MIN_BURST);
+}
@@ -195,6 +195,36 @@ unsigned int Service::maxMediaSizeLimit() const {
     return d_ptr->m_maxMediaSize;
 }
 
+QStringList Service::contentEncodings() const {
+    return d_ptr->m_contentEncodings;
+}
+
+qint64 Service::cellularSizeLimit() const {
+    return d_ptr->m_cellularSize;
+}
+
+bool Service::isWlanOnly (const QString & mimeType) const {
+    foreach (QString type, d_ptr->m_wlanOnlyTypes) {
+        if (type.contains (QLatin1Char('/'))) {
+            if (mimeType == type) {
+                return true;
+            }
+        } else if (mimeType.startsWith (type + QLatin1Char('/'))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Service::uploadsSmallFirst() const {
+    return d_ptr->m_smallFirst;
+}
+
+HashAlgorithm Service::contentHashAlgorithm() const {
+    return d_ptr->m_hashAlgorithm;
+}
+
 QString Service::shareButtonText (const Entry * entry) const {
 
     // Currently we only use first media to find the button text
@@ -232,7 +262,8 @@ QString Service::shareButtonText (const Entry * entry) const {
 
 ServicePrivate::ServicePrivate (Service * parent) : m_service (parent),
     m_serviceOptionsLoaded (false),
-    m_publishCustom (Service::PUBLISH_CUSTOM_XML), m_maxMedia (0), m_maxMediaSize (0) {
+    m_publishCustom (Service::PUBLISH_CUSTOM_XML), m_maxMedia (0), m_maxMediaSize (0),
+    m_cellularSize (0), m_smallFirst (false), m_hashAlgorithm (HASH_SHA1) {
 
     // Store account if relation between service and account
     if (m_service != 0) {
@@ -253,6 +284,11 @@ void ServicePrivate::clear () {
     m_mimeTypes.clear();
     m_publishCustom = Service::PUBLISH_CUSTOM_XML;
     m_publishPlugin.clear();
+    m_contentEncodings.clear();
+    m_cellularSize = 0;
+    m_wlanOnlyTypes.clear();
+    m_smallFirst = false;
+    m_hashAlgorithm = HASH_SHA1;
 }
 
 /*!
@@ -359,6 +395,34 @@ void ServicePrivate::populateMediaData (const QDomElement & element) {
         QLatin1String("0"));
     m_maxMediaSize = sizeValue.toUInt (0, 10);
 
+    //request body compression, e.g. "gzip deflate"
+    QString compression = element.attribute (QLatin1String("compression"));
+    m_contentEncodings = compression.split (QLatin1Char(' '),
+        QString::SkipEmptyParts);
+
+    //network limitations, e.g. cellularSize="5000000" wlanOnly="video"
+    QString cellularValue = element.attribute (QLatin1String("cellularSize"),
+        QLatin1String("0"));
+    m_cellularSize = cellularValue.toLongLong (0, 10);
+    QString wlanOnly = element.attribute (QLatin1String("wlanOnly"));
+    m_wlanOnlyTypes = wlanOnly.split (QLatin1Char(' '),
+        QString::SkipEmptyParts);
+
+    //smallFirst="true" if service accepts media in other than added order
+    m_smallFirst = (element.attribute (QLatin1String("smallFirst")) ==
+        QLatin1String("true"));
+
+    //content hash of media copies, e.g. hash="md5"
+    QString hashValue = element.attribute (QLatin1String("hash"));
+    if (hashValue == QLatin1String("md5")) {
+        m_hashAlgorithm = HASH_MD5;
+    } else {
+        if (!hashValue.isEmpty() && hashValue != QLatin1String("sha1")) {
+            qWarning() << "Unknown hash" << hashValue << "using sha1";
+        }
+        m_hashAlgorithm = HASH_SHA1;
+    }
+
     QDomNode node = element.firstChild();
     while (node.isNull() == false) {
 
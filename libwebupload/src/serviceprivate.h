@@ -121,6 +121,22 @@ namespace WebUpload {
         //  (0 if undefined)
         unsigned int m_maxMediaSize;
 
+        //! Content encodings accepted for request bodies, in preference
+        //  order
+        QStringList m_contentEncodings;
+
+        //! Max size of upload over cellular connection (0 if undefined)
+        qint64 m_cellularSize;
+
+        //! Media types or mime types uploaded only over WLAN
+        QStringList m_wlanOnlyTypes;
+
+        //! If small media may be uploaded before large ones
+        bool m_smallFirst;
+
+        //! Algorithm of content hashes of media copies
+        HashAlgorithm m_hashAlgorithm;
+
         //! Mime to share button map. Actually key is regexp so this isn't
         //  usually used as map but instead iterated until proper value is
         //  found.
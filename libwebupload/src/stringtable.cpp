@@ -0,0 +1,118 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "stringtable.h"
+#include <QSet>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+using namespace WebUpload;
+
+// Tables are pruned when they have doubled since the last pruning, but not
+// before they have this many values
+#define TABLE_MIN_PRUNE_SIZE 256
+
+// Media are also accessed from engine's processing thread
+static QMutex tableMutex;
+
+static QSet<QString> strings;
+static QHash<QString, QUrl> urls;
+static int pruneSize = TABLE_MIN_PRUNE_SIZE;
+
+/*!
+  \brief Drop values used only by the tables. Values are implicitly shared,
+         so a value nobody else holds a copy of is detached. Caller must
+         hold tableMutex.
+ */
+static void pruneTables () {
+    QSet<QString>::iterator stringIter = strings.begin();
+    while (stringIter != strings.end()) {
+        if (stringIter->isDetached()) {
+            stringIter = strings.erase (stringIter);
+        } else {
+            ++stringIter;
+        }
+    }
+
+    QHash<QString, QUrl>::iterator urlIter = urls.begin();
+    while (urlIter != urls.end()) {
+        if (urlIter.value().isDetached()) {
+            urlIter = urls.erase (urlIter);
+        } else {
+            ++urlIter;
+        }
+    }
+
+    pruneSize = qMax (TABLE_MIN_PRUNE_SIZE,
+        2 * (strings.size() + urls.size()));
+}
+
+QString StringTable::string (const QString & value) {
+    if (value.isEmpty()) {
+        return QString();
+    }
+
+    QMutexLocker locker (&tableMutex);
+    QSet<QString>::const_iterator iter = strings.constFind (value);
+    if (iter != strings.constEnd()) {
+        return *iter;
+    }
+
+    if (strings.size() + urls.size() >= pruneSize) {
+        pruneTables ();
+    }
+
+    strings.insert (value);
+    return value;
+}
+
+QUrl StringTable::url (const QString & value) {
+    if (value.isEmpty()) {
+        return QUrl();
+    }
+
+    QMutexLocker locker (&tableMutex);
+    QHash<QString, QUrl>::const_iterator iter = urls.constFind (value);
+    if (iter != urls.constEnd()) {
+        return iter.value();
+    }
+
+    if (strings.size() + urls.size() >= pruneSize) {
+        pruneTables ();
+    }
+
+    QUrl newUrl (value);
+    urls.insert (value, newUrl);
+    return newUrl;
+}
+
+QUrl StringTable::url (const QUrl & value) {
+    return url (value.toString());
+}
+
+void StringTable::prune () {
+    QMutexLocker locker (&tableMutex);
+    pruneTables ();
+}
+
+int StringTable::count () {
+    QMutexLocker locker (&tableMutex);
+    return strings.size() + urls.size();
+}
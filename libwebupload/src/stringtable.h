@@ -0,0 +1,80 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _WEBUPLOAD_STRING_TABLE_H_
+#define _WEBUPLOAD_STRING_TABLE_H_
+
+#include <QString>
+#include <QUrl>
+
+namespace WebUpload {
+
+    /*!
+      \class StringTable
+      \brief Table of interned strings. Values repeated in most media of an
+             entry (mime types, option ids, tags) are stored once and shared
+             between media using Qt's implicit sharing. Values no longer
+             used by any media are dropped when the table has doubled in
+             size since it was last pruned, so a long running engine does
+             not collect the tags of every entry it has handled.
+     */
+    class StringTable {
+
+    public:
+
+        /*!
+          \brief Get shared copy of string
+          \param value String to be interned
+          \return String equal to value sharing data with earlier interned
+                  equal strings
+         */
+        static QString string (const QString & value);
+
+        /*!
+          \brief Get shared copy of url
+          \param value Url as string
+          \return Url sharing data with earlier interned equal urls
+         */
+        static QUrl url (const QString & value);
+
+        /*!
+          \brief Get shared copy of url
+          \param value Url to be interned
+          \return Url sharing data with earlier interned equal urls
+         */
+        static QUrl url (const QUrl & value);
+
+        /*!
+          \brief Drop values that are not used outside the table. Called
+                 automatically as the table grows.
+         */
+        static void prune ();
+
+        /*!
+          \brief Number of values in the table, for diagnostics
+          \return Count of strings and urls
+         */
+        static int count ();
+
+    private:
+        StringTable ();
+    };
+}
+
+#endif
@@ -24,8 +24,10 @@
 #include "WebUpload/Account"
 #include "WebUpload/enums.h"
 #include "systemprivate.h"
+#include "outboxindex.h"
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
 #include <QStringList>
 #include <QTemporaryFile>
 #include <Accounts/Account>
@@ -77,27 +79,99 @@ QString System::entryOutputPath () const {
     return d_ptr->entryOutboxPath;
 }
 
+static bool recordAgeLessThan (const OutboxRecord & r1,
+    const OutboxRecord & r2) {
+
+    return r1.created() < r2.created();
+}
+
 QList <QSharedPointer<Entry> > System::outboxEntries () {
     QList <QSharedPointer<Entry> > list;
+    QList <OutboxRecord> records = outboxIndex ();
+
+    for (int i = 0; i < records.count(); ++i) {
+        QString path = records.at (i).path();
+        QSharedPointer <Entry> entry = QSharedPointer <Entry> (new Entry);
+        if (entry->init (path)) {
+            list.append (entry);
+        } else {
+            qWarning() << "Invalid entry found in outbox, removing it..." <<
+                path;
+            Entry::cleanUp (path);
+        }
+    }
+
+    return list;
+}
+
+QList <OutboxRecord> System::outboxIndex () {
 
     QDir dir = d_ptr->entryOutboxPath;
     QStringList filters;
     filters << "entry_*.xml";
-    dir.setNameFilters (filters);
     QStringList entryFiles = dir.entryList (filters, QDir::Files, QDir::Name);
 
+    // Index is read without the lock: loading entries below updates the
+    // index too, and the repairs are applied to a fresh copy afterwards
+    OutboxIndex index (dir.absolutePath());
+    bool changed = false;
+    if (!index.load ()) {
+        qWarning() << "Outbox index will be rebuilt";
+        changed = true;
+    }
+
+    QStringList removedPaths;
+    QList <OutboxRecord> added;
+
+    // Forget entries that no longer exist
+    QList <OutboxRecord> records = index.records ();
+    for (int i = 0; i < records.count(); ++i) {
+        QString fileName = QFileInfo (records.at (i).path()).fileName();
+        if (!entryFiles.contains (fileName)) {
+            removedPaths << records.at (i).path();
+        }
+    }
+
+    // Load entries missing from index or modified after indexing
     for (int i = 0; i < entryFiles.count(); ++i) {
-        QSharedPointer <Entry> entry = QSharedPointer <Entry> (new Entry);
-        if (entry->init (dir.filePath(entryFiles.at (i)))) {
-            list.append (entry);
-        } else {
+        QString path = dir.filePath (entryFiles.at (i));
+        OutboxRecord record = index.record (path);
+        if (record.isValid() && !OutboxIndex::isStale (record)) {
+            continue;
+        }
+
+        qDebug() << "Indexing outbox entry" << path;
+        removedPaths << path;
+
+        Entry entry;
+        if (!entry.init (path)) {
             qWarning() << "Invalid entry found in outbox, removing it..." <<
-                dir.filePath(entryFiles.at (i)) ;
-            Entry::cleanUp (dir.filePath(entryFiles.at (i)));
+                path;
+            Entry::cleanUp (path);
+        } else {
+            // Finished entries are indexed too, so that they are not loaded
+            // again on every call
+            added << OutboxIndex::entryRecord (&entry);
         }
     }
 
-    return list;
+    if (changed || !removedPaths.isEmpty()) {
+        records = OutboxIndex::repair (dir.absolutePath(), removedPaths,
+            added);
+    }
+
+    // Only unfinished entries are listed, whether their records were
+    // repaired or written when entry was serialized
+    QList <OutboxRecord> unfinished;
+    for (int i = 0; i < records.count(); ++i) {
+        if (!records.at (i).isSent() && !records.at (i).isCanceled()) {
+            unfinished << records.at (i);
+        }
+    }
+    records = unfinished;
+
+    qSort (records.begin(), records.end(), recordAgeLessThan);
+    return records;
 }
 
 QString System::serializeEntryToOutbox (Entry * entry) {
@@ -282,6 +282,11 @@ void UpdateBasePrivate::authResultSlot (int err) {
     } 
 
     qDebug() << "Media authentication failed with code " << err;
+
+    // The token was not accepted, don't offer it again
+    if ((err == WebUpload::AuthBase::RESULT_UNAUTHORIZED) && (authPtr != 0)) {
+        authPtr->invalidateCachedAuth ();
+    }
     reset ();
 
     QStringList failedIds;
@@ -358,6 +363,10 @@ void UpdateBasePrivate::optionDoneSlot () {
 
 void UpdateBasePrivate::optionFailedSlot (WebUpload::Error::Code errCode) {
         
+    if ((errCode == WebUpload::Error::CODE_AUTH_FAILED) && (authPtr != 0)) {
+        authPtr->invalidateCachedAuth ();
+    }
+
     //TODO: If not so fatal error, we could continue
     if (state == STATE_CANCEL) {
         Q_EMIT (canceled());
@@ -371,6 +380,12 @@ void UpdateBasePrivate::optionFailedSlot (WebUpload::Error::Code errCode) {
 
 void UpdateBasePrivate::optionFailedSlot (WebUpload::Error optionError) {
 
+    if ((optionError.code() == WebUpload::Error::CODE_AUTH_FAILED) &&
+        (authPtr != 0)) {
+
+        authPtr->invalidateCachedAuth ();
+    }
+
     if (state == STATE_CANCEL) {
         Q_EMIT (canceled());
     } else {
@@ -382,6 +397,13 @@ void UpdateBasePrivate::optionFailedSlot (WebUpload::Error optionError) {
 }
 
 void UpdateBasePrivate::reAuthSlot () {
+    AuthBase * authP = publicObject->getAuthPtr();
+
+    // Plugin asks again because the service did not accept the old token
+    if (authP != 0) {
+        authP->invalidateCachedAuth (accountWas);
+    }
+
     state = STATE_AUTH;
-    startAuthentication(publicObject->getAuthPtr());
+    startAuthentication(authP);
 }
@@ -0,0 +1,151 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "WebUpload/UploadLedger"
+#include "uploadledgerprivate.h"
+#include "WebUpload/Media"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QStringList>
+#include <QDebug>
+
+using namespace WebUpload;
+
+// Records kept per account, oldest are dropped first
+#define LEDGER_MAX_RECORDS 1000
+// Size of reads when hashing files
+#define LEDGER_HASH_BLOCK 65536
+
+UploadLedger::UploadLedger (const QString & accountId) :
+    d_ptr (new UploadLedgerPrivate (accountId)) {
+}
+
+UploadLedger::~UploadLedger () {
+    delete d_ptr;
+}
+
+QByteArray UploadLedger::contentHash (const QString & filePath) {
+    QFile file (filePath);
+    if (!file.open (QIODevice::ReadOnly)) {
+        qWarning() << "Can't hash" << filePath << file.errorString();
+        return QByteArray();
+    }
+
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    while (!file.atEnd()) {
+        QByteArray block = file.read (LEDGER_HASH_BLOCK);
+        if (block.isEmpty()) {
+            qWarning() << "Failed to read" << filePath << file.errorString();
+            return QByteArray();
+        }
+        hash.addData (block);
+    }
+
+    return hash.result();
+}
+
+QByteArray UploadLedger::contentHash (const Media * media) {
+    if (media == 0 || media->copyFilePath().isEmpty()) {
+        return QByteArray();
+    }
+
+    // Hash calculated while the copy was made. Reading the copy again here
+    // would block the caller for the whole file.
+    return media->contentHash();
+}
+
+bool UploadLedger::contains (const QByteArray & hash) const {
+    if (hash.isEmpty()) {
+        return false;
+    }
+
+    return d_ptr->settings.contains (UploadLedgerPrivate::key (hash) +
+        QLatin1String("/time"));
+}
+
+QString UploadLedger::destination (const QByteArray & hash) const {
+    if (hash.isEmpty()) {
+        return QString();
+    }
+
+    return d_ptr->settings.value (UploadLedgerPrivate::key (hash) +
+        QLatin1String("/url")).toString();
+}
+
+void UploadLedger::record (const QByteArray & hash, const QString & destUrl) {
+    if (hash.isEmpty()) {
+        return;
+    }
+
+    QString key = UploadLedgerPrivate::key (hash);
+    d_ptr->settings.setValue (key + QLatin1String("/url"), destUrl);
+    d_ptr->settings.setValue (key + QLatin1String("/time"),
+        QDateTime::currentDateTime());
+    d_ptr->prune ();
+}
+
+void UploadLedger::remove (const QByteArray & hash) {
+    // Empty key would remove the whole account
+    if (hash.isEmpty()) {
+        return;
+    }
+
+    d_ptr->settings.remove (UploadLedgerPrivate::key (hash));
+}
+
+bool UploadLedger::isEmpty () const {
+    return d_ptr->settings.childGroups().isEmpty();
+}
+
+/* -- private class functions ----------------------------------------------- */
+
+UploadLedgerPrivate::UploadLedgerPrivate (const QString & accountId) :
+    settings ("nokia", "webupload-ledger") {
+
+    // Keep the account on one level in QSettings
+    QString group = accountId;
+    group.replace ('/', '_');
+    settings.beginGroup (group);
+}
+
+QString UploadLedgerPrivate::key (const QByteArray & hash) {
+    return QString::fromLatin1 (hash.toHex());
+}
+
+void UploadLedgerPrivate::prune () {
+    QStringList keys = settings.childGroups();
+
+    while (keys.size() > LEDGER_MAX_RECORDS) {
+        QString oldestKey;
+        QDateTime oldest;
+        foreach (QString key, keys) {
+            QDateTime time = settings.value (key +
+                QLatin1String("/time")).toDateTime();
+            if (oldestKey.isEmpty() || time < oldest) {
+                oldestKey = key;
+                oldest = time;
+            }
+        }
+
+        settings.remove (oldestKey);
+        keys.removeOne (oldestKey);
+    }
+}
@@ -0,0 +1,26 @@
+PKGCONFIG += exempi-2.0
+SOURCES += main.cpp \
+           ../src/metaapplication.cpp \
+           ../src/atom.cpp \
+           ../src/mp4backend.cpp \
+           ../src/imagebackend.cpp \
+           ../src/xmphandler.cpp \
+           ../src/mpeg4atomutility.cpp
+TEMPLATE = app
+CONFIG += warn_on thread qt link_pkgconfig
+TARGET = metawriter-benchmark
+QT -= gui
+INCLUDEPATH += ../src
+HEADERS += ../src/backendinterface.h \
+           ../src/metaapplication.h \
+           ../src/magic.h \
+           ../src/metamandatatypes.h \
+           ../src/atom.h \
+           ../src/mp4backend.h \
+           ../src/imagebackend.h \
+           ../src/xmphandler.h \
+           ../src/mpeg4atomutility.h
+
+QMAKE_CXXFLAGS += -O2 -Werror -Wall
+
+# Benchmark is run from the build tree, it is not installed
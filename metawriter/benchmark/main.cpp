@@ -0,0 +1,532 @@
+ 
+/*
+ * This file is part of Web Upload Engine for MeeGo social networking uploads
+ *
+ * Copyright (C) 2010-2011 Nokia Corporation and/or its subsidiary(-ies). All rights reserved.
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense,     
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER  
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS  
+ * IN THE SOFTWARE. 
+ */
+
+
+
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QtEndian>
+#include <QDebug>
+#include <getopt.h>
+#include <iostream>
+#include <sys/resource.h>
+#include "metaapplication.h"
+#include "magic.h"
+
+using namespace Metaman;
+
+/*
+ * Benchmark for metawriter. Creates synthetic MP4 files with different
+ * atom layouts and measures how fast metadata can be written to a new file
+ * and in place, and how much memory it takes.
+ *
+ * Usage: metawriter-benchmark [-l layout] [-s size in MB] [-d work directory]
+ *                             [-c corpus directory]
+ */
+
+const qint64 DEFAULT_MEDIA_SIZE_MB = 2048;
+const qint64 MEGABYTE = 1024 * 1024;
+
+// Layout parameters
+const int MANY_TRACKS_COUNT          = 256;
+const int MANY_TRACKS_CHUNKS         = 64;
+const int HUGE_STBL_CHUNKS           = 1000000;
+const int NESTED_UDTA_ITEMS          = 2048;
+const qint64 SMALL_MEDIA_SIZE        = MEGABYTE;
+const qint64 CORPUS_MEDIA_SIZE       = 1024;
+const int CORPUS_SCALE_DIVISOR       = 1000;
+
+/// Synthetic file layouts
+enum Layout {
+    LAYOUT_LARGE_MDAT,
+    LAYOUT_MANY_TRACKS,
+    LAYOUT_HUGE_STBL,
+    LAYOUT_NESTED_UDTA,
+    LAYOUT_COUNT
+};
+
+const char* layoutNames[LAYOUT_COUNT] = {
+    "large-mdat",
+    "many-tracks",
+    "huge-stbl",
+    "nested-udta"
+};
+
+
+
+QByteArray atomPreamble(const QByteArray& name, qint64 size)
+{
+    QByteArray preamble;
+
+    if (size > ATOM_MAX_COMPACT_SIZE) {
+        quint32 sizeMarker = qToBigEndian(ATOM_SIZE_LARGE);
+        quint64 largeSize = qToBigEndian((quint64)size);
+        preamble.append((char*)(&sizeMarker), ATOM_SIZE_PREAMBLE_LENGTH);
+        preamble.append(name);
+        preamble.append((char*)(&largeSize), ATOM_LARGE_SIZE_PREAMBLE_LENGTH);
+    }
+    else {
+        quint32 compactSize = qToBigEndian((quint32)size);
+        preamble.append((char*)(&compactSize), ATOM_SIZE_PREAMBLE_LENGTH);
+        preamble.append(name);
+    }
+
+    return preamble;
+}
+
+
+
+QByteArray atom(const QByteArray& name, const QByteArray& payload)
+{
+    return atomPreamble(name, ATOM_HEADER_LENGTH + payload.size()) + payload;
+}
+
+
+
+QByteArray bigEndian32(quint32 value)
+{
+    quint32 raw = qToBigEndian(value);
+    return QByteArray((const char*)(&raw), sizeof(raw));
+}
+
+
+
+QByteArray fileTypeAtom()
+{
+    QByteArray payload = BRAND_3GP4;
+    payload.append(QByteArray(4, 0));
+    payload.append(BRAND_3GP4);
+    return atom(ATOM_NAME_FTYP, payload);
+}
+
+
+
+QByteArray movieHeaderAtom()
+{
+    // 108 byte version 0 movie header is enough for the backend
+    return atom(ATOM_NAME_MVHD, QByteArray(100, 0));
+}
+
+
+
+QByteArray chunkOffsetAtom(int chunks, qint64 firstOffset, qint64 spacing)
+{
+    QByteArray payload(4, 0); // version and flags
+    payload.append(bigEndian32(chunks));
+    payload.reserve(payload.size() + chunks * 4);
+
+    for (int i = 0; i < chunks; ++i) {
+        payload.append(bigEndian32((quint32)(firstOffset + i * spacing)));
+    }
+
+    return atom(ATOM_NAME_STCO, payload);
+}
+
+
+
+QByteArray sampleSizeAtom(int samples, quint32 sampleSize)
+{
+    QByteArray payload(4, 0); // version and flags
+    payload.append(bigEndian32(0));
+    payload.append(bigEndian32(samples));
+    payload.reserve(payload.size() + samples * 4);
+
+    for (int i = 0; i < samples; ++i) {
+        payload.append(bigEndian32(sampleSize));
+    }
+
+    return atom("stsz", payload);
+}
+
+
+
+QByteArray trackAtom(const QByteArray& sampleTable, const QByteArray& userData)
+{
+    QByteArray stbl = atom(ATOM_NAME_STBL, sampleTable);
+    QByteArray minf = atom(ATOM_NAME_MINF, stbl);
+    QByteArray mdia = atom(ATOM_NAME_MDIA, atom("mdhd", QByteArray(24, 0)) +
+                                           minf);
+    QByteArray trak = atom("tkhd", QByteArray(84, 0)) + mdia;
+
+    if (!userData.isEmpty()) {
+        trak.append(atom(ATOM_NAME_USERDATA, userData));
+    }
+
+    return atom(ATOM_NAME_TRAK, trak);
+}
+
+
+
+QByteArray itunesItem(const QByteArray& name, const QByteArray& value)
+{
+    QByteArray data = bigEndian32(ATOM_CLASS_TEXT);
+    data.append(QByteArray(4, 0)); // locale
+    data.append(value);
+    return atom(name, atom(ATOM_NAME_DATA, data));
+}
+
+
+
+/**
+ * \brief Build the movie atom of a layout
+ * @param layout Layout
+ * @param mdatDataStart Offset of the media data in the file
+ * @param mediaSize Size of the media data
+ * @param scale Divisor for the table sizes, 1 for the benchmark
+ * @return moov atom
+ */
+QByteArray movieAtom(Layout layout,
+                     qint64 mdatDataStart,
+                     qint64 mediaSize,
+                     int scale)
+{
+    QByteArray moov = movieHeaderAtom();
+
+    if (layout == LAYOUT_MANY_TRACKS) {
+        int tracks = qMax(1, MANY_TRACKS_COUNT / scale);
+        qint64 spacing = qMax<qint64>(1, mediaSize / (tracks * MANY_TRACKS_CHUNKS));
+
+        for (int i = 0; i < tracks; ++i) {
+            qint64 first = mdatDataStart + i * MANY_TRACKS_CHUNKS * spacing;
+            moov.append(trackAtom(chunkOffsetAtom(MANY_TRACKS_CHUNKS,
+                                                  first,
+                                                  spacing),
+                                  QByteArray()));
+        }
+    }
+    else if (layout == LAYOUT_HUGE_STBL) {
+        int chunks = qMax(1, HUGE_STBL_CHUNKS / scale);
+        qint64 spacing = qMax<qint64>(1, mediaSize / chunks);
+        QByteArray sampleTable = sampleSizeAtom(chunks, spacing) +
+                                 chunkOffsetAtom(chunks, mdatDataStart, spacing);
+        moov.append(trackAtom(sampleTable, QByteArray()));
+    }
+    else if (layout == LAYOUT_NESTED_UDTA) {
+        // User data in the movie and in the track, the movie one holding a
+        // big iTunes item list
+        QByteArray ilst;
+        int items = qMax(1, NESTED_UDTA_ITEMS / scale);
+
+        for (int i = 0; i < items; ++i) {
+            ilst.append(itunesItem(ATOM_NAME_cCMT,
+                                   "comment " + QByteArray::number(i)));
+        }
+
+        QByteArray meta(4, 0); // version and flags
+        meta.append(atom(ATOM_NAME_HDLR, QByteArray(4, 0) + "mdirappl" +
+                                         QByteArray(13, 0)));
+        meta.append(atom(ATOM_NAME_ILST, ilst));
+
+        QByteArray trackUserData = atom(ATOM_NAME_META, meta);
+        moov.append(trackAtom(chunkOffsetAtom(1, mdatDataStart, 0),
+                              trackUserData));
+        moov.append(atom(ATOM_NAME_USERDATA, atom(ATOM_NAME_META, meta)));
+    }
+
+    return atom(ATOM_NAME_MOOV, moov);
+}
+
+
+
+bool writeMediaData(QFile& file, qint64 mediaSize)
+{
+    // Media data with a recognizable pattern, so that it really gets read
+    // and written instead of being a sparse hole
+    QByteArray block(qMin(mediaSize, MEGABYTE), 0);
+    for (int i = 0; i < block.size(); ++i) {
+        block[i] = (char)(i % 251);
+    }
+
+    qint64 remaining = mediaSize;
+    while (remaining > 0) {
+        qint64 chunk = qMin<qint64>(remaining, block.size());
+
+        if (file.write(block.constData(), chunk) != chunk) {
+            return false;
+        }
+
+        remaining -= chunk;
+    }
+
+    return true;
+}
+
+
+
+/**
+ * \brief Create a synthetic file
+ * The large media data layout has moov after mdat. The others place moov
+ * first, so that growing the metadata moves the media data and all the
+ * chunk offsets have to be relocated.
+ * @param path Path of the file
+ * @param layout Layout of the file
+ * @param mediaSize Size of the media data
+ * @param scale Divisor for the table sizes
+ * @return True on success
+ */
+bool createSyntheticFile(const QString& path,
+                         Layout layout,
+                         qint64 mediaSize,
+                         int scale)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QByteArray ftyp = fileTypeAtom();
+    int mdatHeaderLength = (mediaSize + ATOM_HEADER_LENGTH > ATOM_MAX_COMPACT_SIZE)
+                           ? ATOM_LARGE_HEADER_LENGTH : ATOM_HEADER_LENGTH;
+    QByteArray mdatHeader = atomPreamble(ATOM_NAME_MDAT,
+                                         mediaSize + mdatHeaderLength);
+    bool ok = (file.write(ftyp) == ftyp.size());
+
+    if (layout == LAYOUT_LARGE_MDAT) {
+        QByteArray moov = movieAtom(layout, 0, mediaSize, scale);
+        ok = ok && file.write(mdatHeader) == mdatHeader.size() &&
+             writeMediaData(file, mediaSize) &&
+             file.write(moov) == moov.size();
+    }
+    else {
+        // The size of moov doesn't depend on the offsets in it
+        qint64 moovSize = movieAtom(layout, 0, mediaSize, scale).size();
+        qint64 mdatDataStart = ftyp.size() + moovSize + mdatHeader.size();
+        QByteArray moov = movieAtom(layout, mdatDataStart, mediaSize, scale);
+        ok = ok && file.write(moov) == moov.size() &&
+             file.write(mdatHeader) == mdatHeader.size() &&
+             writeMediaData(file, mediaSize);
+    }
+
+    return ok;
+}
+
+
+
+bool runMetawriter(const QString& input, const QString& output)
+{
+    MetaApplication metaApp(OPERATION_MODE_STANDARD);
+    metaApp.setInputFile(input);
+    metaApp.setOutputFile(output);
+
+    return (metaApp.ableToProcess() &&
+            metaApp.readFile() == OPERATION_OK &&
+            metaApp.setTitle("metawriter benchmark") == OPERATION_OK &&
+            metaApp.eraseAuthorAndGps() == OPERATION_OK &&
+            metaApp.writeFile() == OPERATION_OK);
+}
+
+
+
+long peakResidentSetKb()
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+
+    return usage.ru_maxrss;
+}
+
+
+
+void quietMessageHandler(QtMsgType type, const char* message)
+{
+    Q_UNUSED(type);
+    Q_UNUSED(message);
+}
+
+
+
+void report(const char* layout,
+            const char* mode,
+            bool ok,
+            qint64 bytes,
+            qint64 elapsedMs)
+{
+    std::cout << layout << " " << mode << ": ";
+
+    if (!ok) {
+        std::cout << "FAILED" << std::endl;
+        return;
+    }
+
+    // Peak RSS covers the whole process, so run one layout per process
+    // with -l to see the memory use of each
+    double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+    std::cout << elapsedMs << " ms, "
+              << (bytes / (double)MEGABYTE) / seconds << " MB/s, "
+              << "peak RSS " << peakResidentSetKb() << " kB" << std::endl;
+}
+
+
+
+bool runLayout(Layout layout, qint64 mediaSize, const QString& workDir)
+{
+    const char* name = layoutNames[layout];
+    QString input = workDir + "/metawriter-benchmark-" + name + "-in.mp4";
+    QString output = workDir + "/metawriter-benchmark-" + name + "-out.mp4";
+
+    if (layout != LAYOUT_LARGE_MDAT) {
+        mediaSize = qMin(mediaSize, SMALL_MEDIA_SIZE);
+    }
+
+    if (!createSyntheticFile(input, layout, mediaSize, 1)) {
+        std::cout << "could not create " << qPrintable(input) << std::endl;
+        return false;
+    }
+
+    qint64 fileSize = QFileInfo(input).size();
+    QElapsedTimer timer;
+
+    timer.start();
+    bool copyOk = runMetawriter(input, output);
+    report(name, "copy", copyOk, fileSize, timer.elapsed());
+
+    timer.restart();
+    bool inPlaceOk = copyOk && runMetawriter(output, output);
+    report(name, "in place", inPlaceOk, fileSize, timer.elapsed());
+
+    QFile::remove(input);
+    QFile::remove(output);
+
+    return (copyOk && inPlaceOk);
+}
+
+
+
+bool writeCorpus(const QString& corpusDir)
+{
+    // Small versions of the layouts, e.g. as a seed corpus for the fuzzer
+    QDir dir;
+
+    if (!dir.mkpath(corpusDir)) {
+        return false;
+    }
+
+    for (int i = 0; i < LAYOUT_COUNT; ++i) {
+        QString path = corpusDir + "/" + layoutNames[i] + ".mp4";
+
+        if (!createSyntheticFile(path,
+                                 Layout(i),
+                                 CORPUS_MEDIA_SIZE,
+                                 CORPUS_SCALE_DIVISOR)) {
+            std::cout << "could not create " << qPrintable(path) << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    qint64 mediaSizeMb = DEFAULT_MEDIA_SIZE_MB;
+    QString workDir = QDir::tempPath();
+    QString corpusDir;
+    int selectedLayout = -1;
+    bool printHelp = false;
+    int optionChar;
+
+    while ((optionChar = getopt(argc, argv, "l:s:d:c:h")) != -1) {
+        switch (optionChar) {
+            case 'l':
+            {
+                for (int i = 0; i < LAYOUT_COUNT; ++i) {
+                    if (QByteArray(optarg) == layoutNames[i]) {
+                        selectedLayout = i;
+                    }
+                }
+
+                printHelp = printHelp || (selectedLayout < 0);
+                break;
+            }
+
+            case 's':
+            {
+                mediaSizeMb = QByteArray(optarg).toLongLong();
+                break;
+            }
+
+            case 'd':
+            {
+                workDir = QString(optarg);
+                break;
+            }
+
+            case 'c':
+            {
+                corpusDir = QString(optarg);
+                break;
+            }
+
+            default:
+            {
+                printHelp = true;
+                break;
+            }
+        }
+    }
+
+    if (printHelp || mediaSizeMb <= 0) {
+        std::cout << "Usage: " << argv[0] << " [-l layout] [-s size in MB]"
+                  << " [-d work directory] [-c corpus directory]"
+                  << std::endl << "Layouts:";
+
+        for (int i = 0; i < LAYOUT_COUNT; ++i) {
+            std::cout << " " << layoutNames[i];
+        }
+
+        std::cout << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!corpusDir.isEmpty()) {
+        return writeCorpus(corpusDir) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Debug output of the backend would dominate the measurement
+    qInstallMsgHandler(quietMessageHandler);
+    bool ok = true;
+
+    for (int i = 0; i < LAYOUT_COUNT; ++i) {
+        if (selectedLayout < 0 || selectedLayout == i) {
+            ok = runLayout(Layout(i), mediaSizeMb * MEGABYTE, workDir) && ok;
+        }
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
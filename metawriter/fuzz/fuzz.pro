@@ -0,0 +1,34 @@
+PKGCONFIG += exempi-2.0
+SOURCES += main.cpp \
+           ../src/metaapplication.cpp \
+           ../src/atom.cpp \
+           ../src/mp4backend.cpp \
+           ../src/imagebackend.cpp \
+           ../src/xmphandler.cpp \
+           ../src/mpeg4atomutility.cpp
+TEMPLATE = app
+CONFIG += warn_on thread qt link_pkgconfig
+TARGET = metawriter-fuzz
+QT -= gui
+INCLUDEPATH += ../src
+HEADERS += ../src/backendinterface.h \
+           ../src/metaapplication.h \
+           ../src/magic.h \
+           ../src/metamandatatypes.h \
+           ../src/atom.h \
+           ../src/mp4backend.h \
+           ../src/imagebackend.h \
+           ../src/xmphandler.h \
+           ../src/mpeg4atomutility.h
+
+QMAKE_CXXFLAGS += -O1 -g -Werror -Wall
+
+# qmake CONFIG+=libfuzzer builds a libFuzzer target with clang. Without it
+# the target is a standalone runner for AFL and crash reproduction.
+libfuzzer {
+    DEFINES += METAWRITER_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer,address,undefined
+    QMAKE_LFLAGS += -fsanitize=fuzzer,address,undefined
+}
+
+# Fuzzer is run from the build tree, it is not installed
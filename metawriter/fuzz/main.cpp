@@ -0,0 +1,164 @@
+ 
+/*
+ * This file is part of Web Upload Engine for MeeGo social networking uploads
+ *
+ * Copyright (C) 2010-2011 Nokia Corporation and/or its subsidiary(-ies). All rights reserved.
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense,     
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER  
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS  
+ * IN THE SOFTWARE. 
+ */
+
+
+
+
+#include <QCoreApplication>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <iostream>
+#include "metaapplication.h"
+#include "metamandatatypes.h"
+
+using namespace Metaman;
+
+/*
+ * Fuzz target for the metawriter parsers. Every input is written to a
+ * file and run through ableToProcess(), readFile(), a few edits and
+ * writeFile(), both to a new file and in place.
+ *
+ * The target is only built with qmake CONFIG+=fuzz. Built with
+ * CONFIG+=libfuzzer this is a libFuzzer target. Otherwise it is
+ * a standalone runner that takes input files as arguments or one input
+ * from stdin, which works with AFL and for reproducing crashes.
+ *
+ * A seed corpus can be created with metawriter-benchmark -c <directory>.
+ */
+
+namespace {
+    QString inputPath;
+    QString outputPath;
+}
+
+
+
+void quietMessageHandler(QtMsgType type, const char* message)
+{
+    Q_UNUSED(type);
+    Q_UNUSED(message);
+}
+
+
+
+void initialize()
+{
+    static bool initialized = false;
+
+    if (initialized) {
+        return;
+    }
+
+    initialized = true;
+    qInstallMsgHandler(quietMessageHandler);
+
+    QString prefix = QDir::tempPath() + "/metawriter-fuzz-" +
+                     QString::number(getpid());
+    inputPath = prefix + "-in";
+    outputPath = prefix + "-out";
+}
+
+
+
+void processFile(const QString& input, const QString& output)
+{
+    MetaApplication metaApp;
+    metaApp.setInputFile(input);
+    metaApp.setOutputFile(output);
+
+    if (!metaApp.ableToProcess() || metaApp.readFile() != OPERATION_OK) {
+        return;
+    }
+
+    // Both growing and shrinking the metadata, so that media data moves
+    // and the offset tables get rewritten
+    metaApp.setTitle(QByteArray(300, 't'));
+    metaApp.setDescription(QByteArray());
+    metaApp.eraseAuthorAndGps();
+    metaApp.writeFile();
+}
+
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    initialize();
+
+    QFile input(inputPath);
+
+    if (!input.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return 0;
+    }
+
+    input.write((const char*)data, size);
+    input.close();
+
+    processFile(inputPath, outputPath);
+    processFile(outputPath, outputPath);
+
+    QFile::remove(inputPath);
+    QFile::remove(outputPath);
+
+    return 0;
+}
+
+
+
+#ifndef METAWRITER_LIBFUZZER
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList inputs = app.arguments().mid(1);
+
+    if (inputs.isEmpty()) {
+        QFile standardInput;
+        standardInput.open(stdin, QIODevice::ReadOnly);
+        QByteArray data = standardInput.readAll();
+        LLVMFuzzerTestOneInput((const uint8_t*)data.constData(), data.size());
+        return EXIT_SUCCESS;
+    }
+
+    foreach (const QString& path, inputs) {
+        QFile file(path);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            std::cerr << "cannot open " << qPrintable(path) << std::endl;
+            continue;
+        }
+
+        QByteArray data = file.readAll();
+        std::cout << qPrintable(path) << std::endl;
+        LLVMFuzzerTestOneInput((const uint8_t*)data.constData(), data.size());
+    }
+
+    return EXIT_SUCCESS;
+}
+#endif
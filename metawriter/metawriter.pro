@@ -3,3 +3,15 @@ TEMPLATE = subdirs
 CONFIG += warn_on \
           qt \
           thread 
+
+# qmake CONFIG+=benchmark adds the layout benchmark, which is not needed
+# for packaging
+benchmark {
+    SUBDIRS += benchmark
+}
+
+# qmake CONFIG+=fuzz adds the fuzz target, which is not needed for
+# packaging
+fuzz {
+    SUBDIRS += fuzz
+}
@@ -38,9 +38,9 @@ using namespace Metaman;
 Atom::Atom(const QByteArray& name,
            AtomType type,
            AtomStorage storage,
-           qint32 size,
+           qint64 size,
            const QByteArray& contents,
-           qint32 locationInFile,
+           qint64 locationInFile,
            bool expandable,
            Atom* parent,
            QFile* sourceFile) :
@@ -49,10 +49,12 @@ Atom::Atom(const QByteArray& name,
     m_storage(storage),
     m_originalSize(size),
     m_locationInFile(locationInFile),
+    m_buffer(contents),
     m_data(contents),
     m_expandable(expandable),
     m_parent(parent),
-    m_sourceFile(sourceFile)
+    m_sourceFile(sourceFile),
+    m_largeSize(false)
 {
     if (m_name.size() > ATOM_NAME_PREAMBLE_LENGTH) {
         m_name.truncate(ATOM_NAME_PREAMBLE_LENGTH);
@@ -143,48 +145,99 @@ QByteArray Atom::collapse()
 {
     qDebug() << "Atom::collapse() : "  << m_name << "(" << m_expandable << ")";
 
-    QByteArray data;    
+    // Gather first and copy once, so that nested containers don't copy
+    // their contents again at every level
+    QList<QByteArray> segments;
+    collectSegments(segments);
 
+    qint64 totalSize = 0;
+    foreach (const QByteArray& segment, segments) {
+        totalSize += segment.size();
+    }
+
+    QByteArray data;
+    data.reserve(totalSize);
+
+    foreach (const QByteArray& segment, segments) {
+        data.append(segment);
+    }
+
+    m_buffer = data;
+    m_data = data;
+    qDeleteAll(m_children);
+    m_children.clear();
+    m_expandable = true;
+
+    return data;
+}
+
+
+
+void Atom::collectSegments(QList<QByteArray>& segments) const
+{
     // This check ensures size and name don't get included twice in the data.
     // for expandable atoms these are already included in m_data.
     if (!m_expandable) {
-        qint32 atomSize = qToBigEndian(size());
-        data.append((char*)(&atomSize), ATOM_SIZE_PREAMBLE_LENGTH);
-        data.append(name());
+        segments << header();
     }
 
-    qDebug() << "atom is expandable: " << m_expandable;
-    qDebug() << "atom type: " << m_type;
-
     if (m_expandable ||
         m_type == ATOM_TYPE_DATA ||
         m_type == ATOM_TYPE_HYBRID ||
         m_type == ATOM_TYPE_UNKNOWN) {
-        qDebug() << "appending data chunk for " << m_name << ", size " << m_data.size();
-        data.append(m_data);
+        if (!m_data.isEmpty()) {
+            segments << m_data;
+        }
     }
 
     if (!m_expandable &&
         (m_type == ATOM_TYPE_CONTAINER ||
          m_type == ATOM_TYPE_HYBRID)) {
 
-        qDebug() << "appending children (" << m_children.count() << ") for " << m_name;
         foreach (Atom* child, m_children) {
-            data.append(child->collapse());
+            child->collectSegments(segments);
         }
     }
+}
 
-    m_data = data;
-    qDeleteAll(m_children);
-    m_children.clear();
-    m_expandable = true;
+
+
+QByteArray Atom::header() const
+{
+    QByteArray data;
+    const qint64 atomSize = size();
+
+    if (m_largeSize || atomSize > ATOM_MAX_COMPACT_SIZE) {
+        quint32 sizeMarker = qToBigEndian(ATOM_SIZE_LARGE);
+        quint64 largeSize = qToBigEndian((quint64)atomSize);
+        data.append((char*)(&sizeMarker), ATOM_SIZE_PREAMBLE_LENGTH);
+        data.append(name());
+        data.append((char*)(&largeSize), ATOM_LARGE_SIZE_PREAMBLE_LENGTH);
+    }
+    else {
+        quint32 compactSize = qToBigEndian((quint32)atomSize);
+        data.append((char*)(&compactSize), ATOM_SIZE_PREAMBLE_LENGTH);
+        data.append(name());
+    }
 
     return data;
 }
 
 
 
-QByteArray Atom::dataChunk(qint32 offset, qint32 chunkSize) const
+QByteArray Atom::dataView(int offset, int length) const
+{
+    if (offset < 0 || offset >= m_data.size()) {
+        return QByteArray();
+    }
+
+    return QByteArray::fromRawData(m_data.constData() + offset,
+                                   qMin(length, m_data.size() - offset));
+}
+
+
+
+QByteArray Atom::dataChunk(qint64 offset, qint32 chunkSize) const
 {
     QByteArray dataChunk;
 
@@ -213,26 +266,23 @@ void Atom::setData(const QByteArray& data)
         expand();
     }
 
+    m_buffer = data;
     m_data = data;
 }
 
 
 
-qint32 Atom::originalSize() const
+qint64 Atom::originalSize() const
 {
     return m_originalSize;
 }
 
 
 
-qint32 Atom::size() const
+qint64 Atom::size() const
 {
     //qDebug() << "Atom::size() : " << m_name;
-    qint32 size = 0;
-
-    if (!m_expandable) {
-	size += ATOM_SIZE_PREAMBLE_LENGTH + ATOM_NAME_PREAMBLE_LENGTH;
-    }
+    qint64 size = 0;
 
     if (m_expandable ||
         m_type == ATOM_TYPE_DATA ||
@@ -249,12 +299,44 @@ qint32 Atom::size() const
             size += child->size();
         }
     }
+
+    if (!m_expandable) {
+        // Switch to the largesize field if the atom has grown too big for
+        // the normal size preamble
+        if (m_largeSize || size + ATOM_HEADER_LENGTH > ATOM_MAX_COMPACT_SIZE) {
+            size += ATOM_LARGE_HEADER_LENGTH;
+        }
+        else {
+            size += ATOM_HEADER_LENGTH;
+        }
+    }
     
     return size;
 }
 
 
 
+bool Atom::hasLargeSize() const
+{
+    return m_largeSize;
+}
+
+
+
+void Atom::setLargeSize(bool largeSize)
+{
+    m_largeSize = largeSize;
+}
+
+
+
+int Atom::headerLength() const
+{
+    return (m_largeSize ? ATOM_LARGE_HEADER_LENGTH : ATOM_HEADER_LENGTH);
+}
+
+
+
 QList<Atom*> Atom::children()
 {
     if (isExpandable()) {
@@ -279,8 +361,7 @@ void Metaman::Atom::analyzeDataAtom()
 
     int dataSize = m_data.size();
 
-    if (ATOM_SIZE_PREAMBLE_LENGTH + ATOM_NAME_PREAMBLE_LENGTH + dataSize !=
-        m_originalSize) {
+    if (headerLength() + dataSize != m_originalSize) {
         // Actual data size doesn't match what size header says
         m_expandable = true;
     }
@@ -297,8 +378,9 @@ void Metaman::Atom::analyzeContainerAtom()
 {
     qDebug() << "analyzeContainerAtom()";
 
-    qint32 sizeOfFirstChild =
-            m_data.left(ATOM_SIZE_PREAMBLE_LENGTH).toHex().toInt(0,16);
+    int childHeaderLength = 0;
+    qint64 sizeOfFirstChild =
+            Mpeg4AtomUtility::readAtomSize(m_data, 0, childHeaderLength);
 
     if (sizeOfFirstChild > m_data.size()) {
         // The atom claims to have more data than there actually is.
@@ -362,15 +444,16 @@ void Metaman::Atom::analyzeHybridAtom()
     const int lastPossibleAtomOffset =
             m_data.size() - ATOM_SIZE_PREAMBLE_LENGTH - ATOM_NAME_PREAMBLE_LENGTH;
 
-    if (offset > lastPossibleAtomOffset) {
-        // The loop iterated all the way to the end. No children were
+    if (offset < 0 || offset > lastPossibleAtomOffset) {
+        // The loop iterated all the way to the end, or found a name too
+        // close to the beginning to have a size preamble. No children were
         // found, although a hybrid atom should have some. No additional
         // information about the atom content was learned.
         m_expandable = true;
     }
     else {
-        QByteArray children = m_data.right(m_data.size() - offset);
-        m_data.truncate(offset);
+        QByteArray children = dataView(offset, m_data.size() - offset);
+        m_data = dataView(0, offset);
         qDeleteAll(m_children);
         m_children = extractChildren(children);
         m_expandable = false;
@@ -384,8 +467,9 @@ bool Metaman::Atom::expand()
     qDebug() << "Atom::expand() " << m_name;
 
     // Size and name are already stored in corresponding member variables,
-    // so they can be dropped from the raw data block.
-    m_data.remove(0, ATOM_SIZE_PREAMBLE_LENGTH + ATOM_NAME_PREAMBLE_LENGTH);
+    // so they can be dropped from the raw data block. The data stays in
+    // m_buffer, only the view to it changes.
+    m_data = dataView(headerLength(), m_data.size());
 
     if (m_expandable) {
         if (m_type == ATOM_TYPE_DATA) {
@@ -511,13 +595,20 @@ Atom* Metaman::Atom::hasChild(const QByteArray& name)
 
 
 
-qint32 Metaman::Atom::locationInFile() const
+qint64 Metaman::Atom::locationInFile() const
 {
     return m_locationInFile;
 }
 
 
 
+QFile* Metaman::Atom::sourceFile() const
+{
+    return m_sourceFile;
+}
+
+
+
 QList<Atom*> Metaman::Atom::extractChildren(const QByteArray& data)
 {
     qDebug() << "extractChildren()";
@@ -529,41 +620,38 @@ QList<Atom*> Metaman::Atom::extractChildren(const QByteArray& data)
     QList<Atom*> children;
 
     while (index < data.size()) {
-        qint32 locationInSourceFile = locationInFile() + index;
-        const QByteArray childSizeBytes = data.mid(index, ATOM_SIZE_PREAMBLE_LENGTH);
-        const qint32 childSize = childSizeBytes.toHex().toInt(0, 16);
-
-        if (index + ATOM_SIZE_PREAMBLE_LENGTH >= data.length()) {
+        qint64 locationInSourceFile = locationInFile() + index;
+        int childHeaderLength = 0;
+        qint64 childSize = Mpeg4AtomUtility::readAtomSize(data,
+                                                          index,
+                                                          childHeaderLength);
+
+        if (childHeaderLength == 0 ||
+            index + childHeaderLength >= data.length()) {
             break;
         }
-        else {
-            index += ATOM_SIZE_PREAMBLE_LENGTH;
-        }
-
-        const QByteArray childName = data.mid(index,
-                                              ATOM_NAME_PREAMBLE_LENGTH);
 
-        if (index + ATOM_NAME_PREAMBLE_LENGTH >= data.length()) {
-            break;
+        if (childSize == ATOM_SIZE_TO_END) {
+            // Last atom in its parent, extends to the end of the data
+            childSize = data.length() - index;
         }
-        else {
-            index += ATOM_NAME_PREAMBLE_LENGTH;
+        else if (childSize < childHeaderLength) {
+            qDebug() << "invalid child atom size " << childSize;
+            break;
         }
 
+        const QByteArray childName = data.mid(index + ATOM_SIZE_PREAMBLE_LENGTH,
+                                              ATOM_NAME_PREAMBLE_LENGTH);
+
         AtomType childType         = Mpeg4AtomUtility::resolveAtomType(childName);
         AtomStorage childStorage   = ATOM_STORAGE_MEMORY;
         Atom* parent               = this;
-        const QByteArray payload  = data.mid(index, childSize -
-                                             ATOM_SIZE_PREAMBLE_LENGTH -
-                                             ATOM_NAME_PREAMBLE_LENGTH);
-	const QByteArray rawAtomData = childSizeBytes + childName + payload;
+        // The child refers to the same buffer as its parent
+        const QByteArray rawAtomData = QByteArray::fromRawData(
+                data.constData() + index,
+                (int)qMin<qint64>(childSize, data.size() - index));
 
-        if (index + payload.size() > data.length()) {
-            break;
-        }
-        else {
-            index += payload.size();
-        }
+        index += rawAtomData.size();
 
         bool expandable = true;
         Atom* childAtom = new Atom(childName,
@@ -576,6 +664,8 @@ QList<Atom*> Metaman::Atom::extractChildren(const QByteArray& data)
                                    parent);
 
         if (childAtom != 0) {
+            childAtom->m_buffer = m_buffer;
+            childAtom->setLargeSize(childHeaderLength == ATOM_LARGE_HEADER_LENGTH);
             children << childAtom;
         }
     }
@@ -53,7 +53,7 @@ public:
      * @param name Atom name
      * @param type Atom type
      * @param storage Atom storage (memory/file)
-     * @param size Atom size
+     * @param size Atom size, including the preambles
      * @param contents Atom contents (if data or hybrid atom)
      * @param locationInFile Original location in source file or 0 if N/A
      * @param analyzed True if the data block of the atom has been analyzed
@@ -62,9 +62,9 @@ public:
     Atom(const QByteArray& name,
          AtomType type,
          AtomStorage storage,
-         qint32 size,
+         qint64 size,
          const QByteArray& contents,
-         qint32 locationInFile,
+         qint64 locationInFile,
          bool expandable,
          Atom* parent = 0,
          QFile* sourceFile = 0);
@@ -135,6 +135,17 @@ public:
      * @return Atom contents (including preambles and children)
      */
     QByteArray collapse();
+
+    /**
+     * \brief Collect the serialized form of the atom as a list of segments
+     * Unlike collapse(), this doesn't change the atom tree nor concatenate
+     * anything. The segments refer to the data of the atoms wherever
+     * possible, and written one after another they form the same bytes that
+     * collapse() would return. The segments are valid as long as the atom
+     * tree is not modified.
+     * @param segments (out) Segments are appended to this list
+     */
+    void collectSegments(QList<QByteArray>& segments) const;
     
     /**
      * \brief Returns a partial block of atom data
@@ -144,7 +155,7 @@ public:
      * @param chunkSize Size of the chunk to be returned
      * @return Data chunk
      */
-    QByteArray dataChunk(qint32 offset, qint32 chunkSize) const;
+    QByteArray dataChunk(qint64 offset, qint32 chunkSize) const;
     
     /**
      * \brief Set the data of the atom
@@ -157,21 +168,48 @@ public:
      * Only applicable for the atoms read from a source file
      * @return The original size of the atom
      */
-    qint32 originalSize() const;
+    qint64 originalSize() const;
     
     /**
      * \brief Returns the location of the atom in the source file
      * Only applicable for the atoms read from a source file
      * @return Location of the atom as an offset from the beginning of the file
      */
-    qint32 locationInFile() const;
+    qint64 locationInFile() const;
     
+    /**
+     * \brief Returns the file the atom was read from
+     * @return Pointer to the source file, or null if N/A
+     */
+    QFile* sourceFile() const;
+
     /**
      * \brief Returns the current size of the atom
      * Includes children and preambles
      * @return The size of the atom
      */
-    qint32 size() const;
+    qint64 size() const;
+
+    /**
+     * \brief Tells if the atom uses a 64 bit (largesize) size preamble
+     * @return True if the size is stored in the largesize field
+     */
+    bool hasLargeSize() const;
+
+    /**
+     * \brief Set whether the atom uses a 64 bit (largesize) size preamble
+     * Atoms read from a file keep the preamble they had there, so that the
+     * positions of the atoms following them do not change.
+     * @param largeSize True to use the largesize field
+     */
+    void setLargeSize(bool largeSize);
+
+    /**
+     * \brief Returns the length of the size and name preambles of the atom
+     * as stored in the raw data of an unanalyzed atom
+     * @return Preamble length in bytes
+     */
+    int headerLength() const;
     
     /**
      * \brief Returns a list of the children of the atom
@@ -250,11 +288,28 @@ private:
 
     /**
      * \brief Constructs a list of allocated child atoms from the given data
-     * This assumes that the given data contains only child atoms
-     * @param data Data block that contains the child atoms
+     * This assumes that the given data contains only child atoms. The
+     * children refer to the data instead of copying it.
+     * @param data Data block that contains the child atoms. Must be a part
+     *        of m_buffer.
      * @return The list of children
      */
     QList<Atom*> extractChildren(const QByteArray& data);
+
+    /**
+     * \brief Builds the size and name preambles of an analyzed atom
+     * @return Preambles for the current size of the atom
+     */
+    QByteArray header() const;
+
+    /**
+     * \brief Returns a part of m_data without copying it
+     * The returned array refers to the bytes owned by m_buffer.
+     * @param offset Offset of the part in m_data
+     * @param length Length of the part. Clamped to the end of m_data.
+     * @return Part of the data
+     */
+    QByteArray dataView(int offset, int length) const;
       
     /**
      * \brief A utility function that analyzes a data atom
@@ -285,12 +340,17 @@ private:
     QList<Atom*>    m_children;
 
     /// Original size of the atom
-    qint32          m_originalSize;
+    qint64          m_originalSize;
 
     /// Location of the atom in the source file
-    qint32          m_locationInFile;
+    qint64          m_locationInFile;
 
-    /// Data of the atom. Doesn't include preambles
+    /// Buffer holding the bytes m_data refers to. Shared with the parent and
+    /// the children, so that analyzing an atom doesn't copy its data.
+    QByteArray      m_buffer;
+
+    /// Data of the atom. Doesn't include preambles. Always refers to the
+    /// contents of m_buffer.
     QByteArray      m_data;
 
     /// Tells if the atom is expandable or not
@@ -301,6 +361,9 @@ private:
 
     /// A pointer to the file this atom was read from. Can be NULL.
     QFile*          m_sourceFile;
+
+    /// Tells if the size is stored in the 64 bit largesize field
+    bool            m_largeSize;
 };
 
 }
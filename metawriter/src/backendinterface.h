@@ -45,6 +45,11 @@ class BackendInterface
 {
 public:
 
+    /**
+     * \brief Destructor
+     */
+    virtual ~BackendInterface() {}
+
     /**
      * \brief Read file contents
      * @param inputFile The file to read from
@@ -0,0 +1,609 @@
+ 
+/*
+ * This file is part of Web Upload Engine for MeeGo social networking uploads
+ *
+ * Copyright (C) 2010-2011 Nokia Corporation and/or its subsidiary(-ies). All rights reserved.
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense,     
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER  
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS  
+ * IN THE SOFTWARE. 
+ */
+
+
+
+ 
+#include "imagebackend.h"
+#include "magic.h"
+#include "mpeg4atomutility.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+#include <string.h>
+
+using namespace Metaman;
+
+ImageBackend::ImageBackend(OperationMode operationMode) :
+    m_format(IMAGE_FORMAT_UNKNOWN),
+    m_droppedKinds(SEGMENT_DATA),
+    m_sourceFile(0)
+{
+    // Segments are dropped as a whole, tag styles make no difference
+    Q_UNUSED(operationMode);
+    qDebug() << "Using ImageBackend";
+}
+
+
+
+ImageBackend::~ImageBackend()
+{
+}
+
+
+
+bool ImageBackend::ableToProcess(QFile& inputFile)
+{
+    qDebug() << "ImageBackend::ableToProcess()";
+
+    if (!inputFile.isOpen()) {
+        return false;
+    }
+
+    return (readFormat(inputFile) != IMAGE_FORMAT_UNKNOWN);
+}
+
+
+
+OperationResult ImageBackend::readFile(QFile& inputFile)
+{
+    qDebug() << "ImageBackend::readFile()";
+    m_sourceFile = &inputFile;
+    m_segments.clear();
+
+    if (!inputFile.isOpen()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    m_format = readFormat(inputFile);
+
+    qint64 size = inputFile.size();
+    QByteArray contents;
+    uchar* mapping = inputFile.map(0, size);
+    const uchar* data = mapping;
+
+    if (mapping == 0) {
+        // Images are small enough to be read in when mapping is not
+        // supported
+        inputFile.seek(0);
+        contents = inputFile.readAll();
+        data = (const uchar*)contents.constData();
+        size = contents.size();
+    }
+
+    bool valid = false;
+
+    switch (m_format) {
+        case IMAGE_FORMAT_JPEG:
+            valid = scanJpeg(data, size);
+            break;
+        case IMAGE_FORMAT_PNG:
+            valid = scanPng(data, size);
+            break;
+        case IMAGE_FORMAT_GIF:
+            valid = scanGif(data, size);
+            break;
+        default:
+            break;
+    }
+
+    if (mapping != 0) {
+        inputFile.unmap(mapping);
+    }
+
+    if (!valid) {
+        qWarning() << "Invalid image structure";
+        m_segments.clear();
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    qDebug() << "found " << m_segments.count() << " segments";
+    return OPERATION_OK;
+}
+
+
+
+OperationResult ImageBackend::writeFile(QFile& outputFile)
+{
+    qDebug() << "ImageBackend::writeFile()";
+
+    if (m_sourceFile == 0 || m_segments.isEmpty() || !outputFile.isOpen()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    outputFile.seek(0);
+    int index = 0;
+
+    // Segments are only left out, so when writing over the source file the
+    // data always moves towards the start of the file and can be copied
+    // front to back.
+    while (index < m_segments.count()) {
+        if (m_segments.at(index).kind & m_droppedKinds) {
+            index++;
+            continue;
+        }
+
+        // Copy consecutive kept segments with one call
+        qint64 offset = m_segments.at(index).offset;
+        qint64 length = 0;
+
+        while (index < m_segments.count() &&
+               !(m_segments.at(index).kind & m_droppedKinds)) {
+            length += m_segments.at(index).length;
+            index++;
+        }
+
+        if (Mpeg4AtomUtility::copyFileData(*m_sourceFile,
+                                           offset,
+                                           length,
+                                           outputFile) != length) {
+            qWarning() << "Could not copy image data";
+            return OPERATION_GENERAL_ERROR;
+        }
+    }
+
+    if (outputFile.pos() < outputFile.size()) {
+        outputFile.resize(outputFile.pos());
+    }
+
+    return OPERATION_OK;
+}
+
+
+
+OperationResult ImageBackend::removeAllMetaData()
+{
+    return dropSegments(SEGMENT_EXIF |
+                        SEGMENT_XMP |
+                        SEGMENT_IPTC |
+                        SEGMENT_COMMENT |
+                        SEGMENT_TEXT);
+}
+
+
+
+OperationResult ImageBackend::removeAuthor()
+{
+    if (!fieldsRemovable()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    return dropSegments(SEGMENT_EXIF | SEGMENT_XMP | SEGMENT_IPTC | SEGMENT_TEXT);
+}
+
+
+
+OperationResult ImageBackend::removeDescription()
+{
+    return dropSegments(SEGMENT_XMP | SEGMENT_IPTC | SEGMENT_COMMENT | SEGMENT_TEXT);
+}
+
+
+
+OperationResult ImageBackend::removeGpsString()
+{
+    if (!fieldsRemovable()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    return dropSegments(SEGMENT_EXIF | SEGMENT_XMP);
+}
+
+
+
+OperationResult ImageBackend::removeGeoTag()
+{
+    if (!fieldsRemovable()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    return dropSegments(SEGMENT_XMP | SEGMENT_IPTC);
+}
+
+
+
+OperationResult ImageBackend::removeTitle()
+{
+    return dropSegments(SEGMENT_XMP | SEGMENT_IPTC | SEGMENT_TEXT);
+}
+
+
+
+OperationResult ImageBackend::setDescription(const QByteArray& description)
+{
+    Q_UNUSED(description);
+    qWarning() << "Setting image description is not supported";
+    return OPERATION_GENERAL_ERROR;
+}
+
+
+
+OperationResult ImageBackend::setTitle(const QByteArray& title)
+{
+    Q_UNUSED(title);
+    qWarning() << "Setting image title is not supported";
+    return OPERATION_GENERAL_ERROR;
+}
+
+
+
+OperationResult ImageBackend::setAuthor(const QByteArray& author)
+{
+    Q_UNUSED(author);
+    qWarning() << "Setting image author is not supported";
+    return OPERATION_GENERAL_ERROR;
+}
+
+
+
+OperationResult ImageBackend::setGpsString(const QByteArray& GPSLatitude,
+                                           const QByteArray& GPSLongitude,
+                                           const QByteArray& GPSAltitude,
+                                           const QByteArray& GPSAltitudeRef)
+{
+    Q_UNUSED(GPSLatitude);
+    Q_UNUSED(GPSLongitude);
+    Q_UNUSED(GPSAltitude);
+    Q_UNUSED(GPSAltitudeRef);
+    qWarning() << "Setting image GPS information is not supported";
+    return OPERATION_GENERAL_ERROR;
+}
+
+
+
+OperationResult ImageBackend::setKeywords(const QList<QByteArray>& keywords)
+{
+    Q_UNUSED(keywords);
+    qWarning() << "Setting image keywords is not supported";
+    return OPERATION_GENERAL_ERROR;
+}
+
+
+
+OperationResult ImageBackend::setGeotag(const QByteArray& geotag)
+{
+    Q_UNUSED(geotag);
+    qWarning() << "Setting image geotag is not supported";
+    return OPERATION_GENERAL_ERROR;
+}
+
+
+
+bool ImageBackend::fieldsRemovable() const
+{
+    // Exif holds the camera settings and orientation next to the author
+    // and location, and the IFD entries are not edited. Dropping the whole
+    // segment would lose them, so JPEG and PNG can only be stripped of all
+    // metadata here.
+    if (m_format == IMAGE_FORMAT_JPEG || m_format == IMAGE_FORMAT_PNG) {
+        qWarning() << "Removing single fields from JPEG and PNG images is "
+                      "not supported";
+        return false;
+    }
+
+    return true;
+}
+
+
+
+ImageBackend::ImageFormat ImageBackend::readFormat(QFile& inputFile)
+{
+    ImageFormat format = IMAGE_FORMAT_UNKNOWN;
+
+    inputFile.seek(0);
+    QByteArray signature = inputFile.read(PNG_SIGNATURE.size());
+
+    if (signature.startsWith(JPEG_SIGNATURE)) {
+        format = IMAGE_FORMAT_JPEG;
+    }
+    else if (signature.startsWith(PNG_SIGNATURE)) {
+        format = IMAGE_FORMAT_PNG;
+    }
+    else if (signature.startsWith(GIF87_SIGNATURE) ||
+             signature.startsWith(GIF89_SIGNATURE)) {
+        format = IMAGE_FORMAT_GIF;
+    }
+
+    return format;
+}
+
+
+
+bool ImageBackend::scanJpeg(const uchar* data, qint64 size)
+{
+    if (size < JPEG_SIGNATURE.size()) {
+        return false;
+    }
+
+    addSegment(0, JPEG_SIGNATURE.size(), SEGMENT_DATA);
+    qint64 pos = JPEG_SIGNATURE.size();
+
+    while (pos < size) {
+        const qint64 markerStart = pos;
+
+        if (data[pos] != JPEG_MARKER_PREFIX) {
+            qDebug() << "no JPEG marker at " << pos;
+            return false;
+        }
+
+        // Any number of fill bytes may precede the marker
+        while (pos < size && data[pos] == JPEG_MARKER_PREFIX) {
+            pos++;
+        }
+
+        if (pos >= size) {
+            return false;
+        }
+
+        const uchar marker = data[pos++];
+
+        if (marker == JPEG_MARKER_EOI) {
+            // Keep anything after the image as it is
+            addSegment(markerStart, size - markerStart, SEGMENT_DATA);
+            return true;
+        }
+
+        if (marker == JPEG_MARKER_TEM ||
+            (marker >= JPEG_MARKER_RST0 && marker <= JPEG_MARKER_RST7)) {
+            // Markers without a payload
+            addSegment(markerStart, pos - markerStart, SEGMENT_DATA);
+            continue;
+        }
+
+        if (pos + JPEG_SEGMENT_LENGTH_LENGTH > size) {
+            return false;
+        }
+
+        const qint64 segmentLength = qFromBigEndian<quint16>(data + pos);
+
+        if (segmentLength < JPEG_SEGMENT_LENGTH_LENGTH ||
+            pos + segmentLength > size) {
+            qDebug() << "invalid JPEG segment at " << markerStart;
+            return false;
+        }
+
+        const char* payload = (const char*)data + pos +
+                              JPEG_SEGMENT_LENGTH_LENGTH;
+        const int payloadLength = segmentLength - JPEG_SEGMENT_LENGTH_LENGTH;
+        SegmentKind kind = SEGMENT_DATA;
+
+        if (marker == JPEG_MARKER_APP1) {
+            QByteArray identifier = QByteArray::fromRawData(payload,
+                                                            payloadLength);
+
+            if (identifier.startsWith(JPEG_EXIF_IDENTIFIER)) {
+                kind = SEGMENT_EXIF;
+            }
+            else if (identifier.startsWith(JPEG_XMP_IDENTIFIER) ||
+                     identifier.startsWith(JPEG_XMP_EXTENSION_IDENTIFIER)) {
+                kind = SEGMENT_XMP;
+            }
+        }
+        else if (marker == JPEG_MARKER_APP13) {
+            QByteArray identifier = QByteArray::fromRawData(payload,
+                                                            payloadLength);
+
+            if (identifier.startsWith(JPEG_IPTC_IDENTIFIER)) {
+                kind = SEGMENT_IPTC;
+            }
+        }
+        else if (marker == JPEG_MARKER_COM) {
+            kind = SEGMENT_COMMENT;
+        }
+
+        pos += segmentLength;
+        addSegment(markerStart, pos - markerStart, kind);
+
+        if (marker == JPEG_MARKER_SOS) {
+            // Entropy coded data follows. Metadata markers are not expected
+            // after the first scan, so the rest of the file is kept as it is.
+            addSegment(pos, size - pos, SEGMENT_DATA);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+bool ImageBackend::scanPng(const uchar* data, qint64 size)
+{
+    if (size < PNG_SIGNATURE.size()) {
+        return false;
+    }
+
+    addSegment(0, PNG_SIGNATURE.size(), SEGMENT_DATA);
+    qint64 pos = PNG_SIGNATURE.size();
+
+    while (pos + PNG_CHUNK_OVERHEAD <= size) {
+        const qint64 chunkLength = PNG_CHUNK_OVERHEAD +
+                                   (qint64)qFromBigEndian<quint32>(data + pos);
+
+        if (pos + chunkLength > size) {
+            qDebug() << "truncated PNG chunk at " << pos;
+            return false;
+        }
+
+        const QByteArray type((const char*)data + pos + PNG_CHUNK_TYPE_OFFSET,
+                              PNG_CHUNK_TYPE_LENGTH);
+        SegmentKind kind = SEGMENT_DATA;
+
+        if (type == PNG_CHUNK_ITXT) {
+            // Keyword is the first thing in the chunk data
+            const char* keyword = (const char*)data + pos +
+                                  PNG_CHUNK_DATA_OFFSET;
+            bool isXmp = chunkLength - PNG_CHUNK_OVERHEAD >
+                         PNG_XMP_KEYWORD.size() &&
+                         strncmp(keyword,
+                                 PNG_XMP_KEYWORD.constData(),
+                                 PNG_XMP_KEYWORD.size() + 1) == 0;
+            kind = isXmp ? SEGMENT_XMP : SEGMENT_TEXT;
+        }
+        else if (type == PNG_CHUNK_TEXT || type == PNG_CHUNK_ZTXT) {
+            kind = SEGMENT_TEXT;
+        }
+        else if (type == PNG_CHUNK_EXIF) {
+            kind = SEGMENT_EXIF;
+        }
+
+        addSegment(pos, chunkLength, kind);
+        pos += chunkLength;
+
+        if (type == PNG_CHUNK_IEND) {
+            if (pos < size) {
+                addSegment(pos, size - pos, SEGMENT_DATA);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+bool ImageBackend::scanGif(const uchar* data, qint64 size)
+{
+    if (size < GIF_HEADER_LENGTH) {
+        return false;
+    }
+
+    qint64 pos = GIF_HEADER_LENGTH;
+    const uchar screenFlags = data[GIF_SCREEN_FLAGS_OFFSET];
+
+    if (screenFlags & GIF_COLOR_TABLE_FLAG) {
+        pos += 3 * (1 << ((screenFlags & GIF_COLOR_TABLE_SIZE_MASK) + 1));
+    }
+
+    if (pos > size) {
+        return false;
+    }
+
+    addSegment(0, pos, SEGMENT_DATA);
+
+    while (pos < size) {
+        const qint64 blockStart = pos;
+        const uchar introducer = data[pos++];
+        SegmentKind kind = SEGMENT_DATA;
+
+        if (introducer == GIF_TRAILER) {
+            addSegment(blockStart, size - blockStart, SEGMENT_DATA);
+            return true;
+        }
+        else if (introducer == GIF_EXTENSION_INTRODUCER) {
+            if (pos >= size) {
+                return false;
+            }
+
+            const uchar label = data[pos++];
+
+            if (label == GIF_LABEL_COMMENT) {
+                kind = SEGMENT_COMMENT;
+            }
+            else if (label == GIF_LABEL_APPLICATION &&
+                     pos + 1 + GIF_XMP_IDENTIFIER.size() <= size &&
+                     data[pos] == GIF_XMP_IDENTIFIER.size() &&
+                     memcmp(data + pos + 1,
+                            GIF_XMP_IDENTIFIER.constData(),
+                            GIF_XMP_IDENTIFIER.size()) == 0) {
+                kind = SEGMENT_XMP;
+            }
+        }
+        else if (introducer == GIF_IMAGE_SEPARATOR) {
+            if (pos + GIF_IMAGE_DESCRIPTOR_LENGTH > size) {
+                return false;
+            }
+
+            const uchar imageFlags = data[pos + GIF_IMAGE_FLAGS_OFFSET];
+            pos += GIF_IMAGE_DESCRIPTOR_LENGTH;
+
+            if (imageFlags & GIF_COLOR_TABLE_FLAG) {
+                pos += 3 * (1 << ((imageFlags & GIF_COLOR_TABLE_SIZE_MASK) + 1));
+            }
+
+            // LZW minimum code size
+            pos++;
+
+            if (pos > size) {
+                return false;
+            }
+        }
+        else {
+            qDebug() << "unknown GIF block at " << blockStart;
+            return false;
+        }
+
+        if (!skipGifSubBlocks(data, size, pos)) {
+            return false;
+        }
+
+        addSegment(blockStart, pos - blockStart, kind);
+    }
+
+    return false;
+}
+
+
+
+bool ImageBackend::skipGifSubBlocks(const uchar* data, qint64 size, qint64& pos)
+{
+    while (pos < size) {
+        const uchar blockSize = data[pos++];
+
+        if (blockSize == 0) {
+            return true;
+        }
+
+        pos += blockSize;
+    }
+
+    return false;
+}
+
+
+
+void ImageBackend::addSegment(qint64 offset, qint64 length, SegmentKind kind)
+{
+    Segment segment;
+    segment.offset = offset;
+    segment.length = length;
+    segment.kind = kind;
+    m_segments << segment;
+}
+
+
+
+OperationResult ImageBackend::dropSegments(int kinds)
+{
+    if (m_segments.isEmpty()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    m_droppedKinds |= kinds;
+    return OPERATION_OK;
+}
@@ -0,0 +1,191 @@
+ 
+/*
+ * This file is part of Web Upload Engine for MeeGo social networking uploads
+ *
+ * Copyright (C) 2010-2011 Nokia Corporation and/or its subsidiary(-ies). All rights reserved.
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense,     
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER  
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS  
+ * IN THE SOFTWARE. 
+ */
+
+
+
+ 
+#ifndef IMAGEBACKEND_H
+#define IMAGEBACKEND_H
+
+#include <backendinterface.h>
+#include "metamandatatypes.h"
+#include <QList>
+
+class QByteArray;
+class QFile;
+
+namespace Metaman {
+
+/*!
+    \class ImageBackend
+    \brief Metadata filtering for JPEG, PNG and GIF images
+    The image is scanned once for its segments (JPEG markers, PNG chunks,
+    GIF blocks). Metadata segments are then left out while the rest of the
+    file is copied with a single pass. Metadata can only be removed, not
+    set. Segments are removed as a whole, so author and location can only
+    be removed from GIF images, which have no Exif.
+ */
+class ImageBackend : public BackendInterface
+{
+public:
+    /**
+     * \brief Constructor
+     * @param operationMode Operation mode
+     */
+    ImageBackend(OperationMode operationMode = OPERATION_MODE_ALL);
+
+    /**
+     * \brief Destructor
+     */
+    virtual ~ImageBackend();
+
+    /// \reimp
+    virtual OperationResult readFile(QFile& inputFile);
+    virtual OperationResult writeFile(QFile& outputFile);
+    virtual OperationResult removeAllMetaData();
+    virtual OperationResult removeAuthor();
+    virtual OperationResult removeDescription();
+    virtual OperationResult removeGpsString();
+    virtual OperationResult removeGeoTag();
+    virtual OperationResult removeTitle();
+    virtual OperationResult setDescription(const QByteArray& description);
+    virtual OperationResult setTitle(const QByteArray& title);
+    virtual OperationResult setAuthor(const QByteArray& author);
+    virtual OperationResult setGpsString(const QByteArray& GPSLatitude,
+                                         const QByteArray& GPSLongitude,
+                                         const QByteArray& GPSAltitude,
+                                         const QByteArray& GPSAltitudeRef);
+    virtual OperationResult setKeywords(const QList<QByteArray>& keywords);
+    virtual OperationResult setGeotag(const QByteArray& geotag);
+    virtual bool ableToProcess(QFile& inputFile);
+    /// \reimp_end
+
+private:
+
+    /// Supported image formats
+    enum ImageFormat {
+        IMAGE_FORMAT_UNKNOWN,
+        IMAGE_FORMAT_JPEG,
+        IMAGE_FORMAT_PNG,
+        IMAGE_FORMAT_GIF
+    };
+
+    /// Kinds of segments. Everything but SEGMENT_DATA is metadata.
+    enum SegmentKind {
+        SEGMENT_DATA    = 0x00,
+        SEGMENT_EXIF    = 0x01,
+        SEGMENT_XMP     = 0x02,
+        SEGMENT_IPTC    = 0x04,
+        SEGMENT_COMMENT = 0x08,
+        SEGMENT_TEXT    = 0x10
+    };
+
+    /// A continuous range of the source file
+    struct Segment {
+        qint64 offset;
+        qint64 length;
+        SegmentKind kind;
+    };
+
+    /**
+     * \brief Recognize the image format from the file signature
+     * @param inputFile Input file
+     * @return Image format
+     */
+    static ImageFormat readFormat(QFile& inputFile);
+
+    /**
+     * \brief Split a JPEG file into markers
+     * @param data File contents
+     * @param size File size
+     * @return True if the file is a valid JPEG
+     */
+    bool scanJpeg(const uchar* data, qint64 size);
+
+    /**
+     * \brief Split a PNG file into chunks
+     * @param data File contents
+     * @param size File size
+     * @return True if the file is a valid PNG
+     */
+    bool scanPng(const uchar* data, qint64 size);
+
+    /**
+     * \brief Split a GIF file into blocks
+     * @param data File contents
+     * @param size File size
+     * @return True if the file is a valid GIF
+     */
+    bool scanGif(const uchar* data, qint64 size);
+
+    /**
+     * \brief Skip GIF data sub-blocks
+     * @param data File contents
+     * @param size File size
+     * @param pos Position of the first sub-block, moved past the terminator
+     * @return True if the terminator was found
+     */
+    static bool skipGifSubBlocks(const uchar* data, qint64 size, qint64& pos);
+
+    /**
+     * \brief Add a segment to the segment list
+     * @param offset Offset of the segment in the source file
+     * @param length Length of the segment
+     * @param kind Kind of the segment
+     */
+    void addSegment(qint64 offset, qint64 length, SegmentKind kind);
+
+    /**
+     * \brief Check if author and location can be removed without losing
+     *        other metadata
+     * @return False for formats that keep them in Exif
+     */
+    bool fieldsRemovable() const;
+
+    /**
+     * \brief Leave out segments of the given kinds when writing
+     * @param kinds SegmentKind values or'ed together
+     * @return Operation result
+     */
+    OperationResult dropSegments(int kinds);
+
+private:
+
+    /// Format of the source file
+    ImageFormat m_format;
+
+    /// Segments of the source file in file order
+    QList<Segment> m_segments;
+
+    /// Kinds of segments left out when writing
+    int m_droppedKinds;
+
+    /// Source file
+    QFile* m_sourceFile;
+};
+
+}
+
+#endif
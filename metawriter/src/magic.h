@@ -37,6 +37,10 @@ namespace Metaman {
     const int MAX_ATOMS               = 1024;
     const int DEFAULT_DATA_CHUNK_SIZE = 4096;
 
+    // Buffer size used for copying media data when the kernel cannot copy
+    // it directly between the files
+    const int DATA_COPY_BUFFER_SIZE   = 1024 * 1024;
+
     //
     // Magic values for MP4 / Quicktime / MPEG-4 Part 12 formats
     //
@@ -45,7 +49,15 @@ namespace Metaman {
     
     // Brands
     const QByteArray BRAND_3GP4 = "3gp4";
+    const QByteArray BRAND_3GP5 = "3gp5";
+    const QByteArray BRAND_3GP6 = "3gp6";
+    const QByteArray BRAND_3G2A = "3g2a";
+    const QByteArray BRAND_MP41 = "mp41";
     const QByteArray BRAND_MP42 = "mp42";
+    const QByteArray BRAND_ISOM = "isom";
+    const QByteArray BRAND_M4A  = "M4A ";
+    const QByteArray BRAND_M4V  = "M4V ";
+    const QByteArray BRAND_QT   = "qt  ";
 
     // Box sizes and known locations
     const int ATOM_SIZE_PREAMBLE_LENGTH     = 4;
@@ -54,6 +66,21 @@ namespace Metaman {
     const int ATOM_NAME_FTYP_OFFSET         = 4;
     const int FILE_BRAND_OFFSET             = ATOM_NAME_FTYP_OFFSET +
                                               ATOM_NAME_PREAMBLE_LENGTH;
+    const int ATOM_HEADER_LENGTH            = ATOM_SIZE_PREAMBLE_LENGTH +
+                                              ATOM_NAME_PREAMBLE_LENGTH;
+
+    // 64 bit atoms: size preamble is ATOM_SIZE_LARGE and the real size
+    // follows the name as a 64 bit "largesize" field
+    const int ATOM_LARGE_SIZE_PREAMBLE_LENGTH = 8;
+    const int ATOM_LARGE_HEADER_LENGTH      = ATOM_HEADER_LENGTH +
+                                              ATOM_LARGE_SIZE_PREAMBLE_LENGTH;
+    const quint32 ATOM_SIZE_LARGE           = 1;
+
+    // Size preamble value of an atom that extends to the end of the file
+    const quint32 ATOM_SIZE_TO_END          = 0;
+
+    // Largest atom size that fits in the normal size preamble
+    const qint64 ATOM_MAX_COMPACT_SIZE      = Q_INT64_C(0xFFFFFFFF);
 
     // Atom classes
     const qint32 ATOM_CLASS_TEXT(0x00000001);
@@ -83,6 +110,23 @@ namespace Metaman {
     const QByteArray ATOM_NAME_cNAM         = QByteArray("\xA9") +
                                               QByteArray("nam");
     const QByteArray ATOM_NAME_UUID         = "uuid";
+    const QByteArray ATOM_NAME_MDIA         = "mdia";
+    const QByteArray ATOM_NAME_MINF         = "minf";
+    const QByteArray ATOM_NAME_STBL         = "stbl";
+    const QByteArray ATOM_NAME_STCO         = "stco";
+    const QByteArray ATOM_NAME_CO64         = "co64";
+
+    // Atoms holding absolute file offsets that are not relocated. Movie
+    // fragments (moof), their random access index (mfra) and auxiliary
+    // sample information offsets (saio) would point to wrong places once
+    // the media data moves.
+    const QByteArray ATOM_NAME_MOOF         = "moof";
+    const QByteArray ATOM_NAME_MFRA         = "mfra";
+    const QByteArray ATOM_NAME_SAIO         = "saio";
+
+    // Chunk offset tables: version and flags, entry count, entries
+    const int CHUNK_OFFSET_TABLE_HEADER_LENGTH = 8;
+    const int CHUNK_OFFSET_COUNT_OFFSET        = 4;
 
 
     // Properties of known atoms
@@ -90,7 +134,7 @@ namespace Metaman {
     const AtomProperty atomProperties[] = {
         // Top level atoms
         {ATOM_NAME_FTYP,        ATOM_TYPE_DATA,         ATOM_STORAGE_MEMORY},
-        {ATOM_NAME_FREE,        ATOM_TYPE_CONTAINER,    ATOM_STORAGE_MEMORY},
+        {ATOM_NAME_FREE,        ATOM_TYPE_DATA,         ATOM_STORAGE_MEMORY},
         {ATOM_NAME_MOOV,        ATOM_TYPE_CONTAINER,    ATOM_STORAGE_MEMORY},
         {ATOM_NAME_MDAT,        ATOM_TYPE_DATA,         ATOM_STORAGE_FILE},
 
@@ -112,7 +156,14 @@ namespace Metaman {
         {ATOM_NAME_cCMT,        ATOM_TYPE_CONTAINER,    ATOM_STORAGE_MEMORY},
         {ATOM_NAME_cNAM,        ATOM_TYPE_CONTAINER,    ATOM_STORAGE_MEMORY},
         
-        {ATOM_NAME_UUID,        ATOM_TYPE_DATA,         ATOM_STORAGE_MEMORY}
+        {ATOM_NAME_UUID,        ATOM_TYPE_DATA,         ATOM_STORAGE_MEMORY},
+
+        // Sample table atoms needed for chunk offset relocation
+        {ATOM_NAME_MDIA,        ATOM_TYPE_CONTAINER,    ATOM_STORAGE_MEMORY},
+        {ATOM_NAME_MINF,        ATOM_TYPE_CONTAINER,    ATOM_STORAGE_MEMORY},
+        {ATOM_NAME_STBL,        ATOM_TYPE_CONTAINER,    ATOM_STORAGE_MEMORY},
+        {ATOM_NAME_STCO,        ATOM_TYPE_DATA,         ATOM_STORAGE_MEMORY},
+        {ATOM_NAME_CO64,        ATOM_TYPE_DATA,         ATOM_STORAGE_MEMORY}
     };
 
     // Standard ISO/3GPP style tags
@@ -131,6 +182,7 @@ namespace Metaman {
     const QByteArray ATOM_PATH_AUTHOR_ALTERNATIVE = "moov.udta.auth";
     const QByteArray ATOM_PATH_GEOTAG_ALTERNATIVE = "moov.udta.loci";
     const QByteArray ATOM_PATH_UUID               = "uuid";
+    const QByteArray ATOM_PATH_SAMPLETABLE_IN_TRAK = "mdia.minf.stbl";
 
     //iTunes style tags
     const QByteArray ATOM_PATH_ITUNESDATA =
@@ -165,6 +217,65 @@ namespace Metaman {
     const QByteArray XMP_LANGUAGE_DEFAULT          = "x-default";
     const QByteArray XMP_LANGUAGE_NONE             = "";
 
+    // Room left for later edits when a packet has to grow
+    const int XMP_DEFAULT_PADDING                  = 2048;
+
+
+
+    //
+    // Magic values for image formats
+    //
+
+    const QByteArray JPEG_SIGNATURE         = QByteArray("\xFF\xD8", 2);
+    const QByteArray PNG_SIGNATURE          = QByteArray("\x89PNG\r\n\x1A\n", 8);
+    const QByteArray GIF87_SIGNATURE        = "GIF87a";
+    const QByteArray GIF89_SIGNATURE        = "GIF89a";
+
+    // JPEG markers and the identifiers that start APPn segment payloads
+    const uchar JPEG_MARKER_PREFIX          = 0xFF;
+    const uchar JPEG_MARKER_TEM             = 0x01;
+    const uchar JPEG_MARKER_RST0            = 0xD0;
+    const uchar JPEG_MARKER_RST7            = 0xD7;
+    const uchar JPEG_MARKER_EOI             = 0xD9;
+    const uchar JPEG_MARKER_SOS             = 0xDA;
+    const uchar JPEG_MARKER_APP1            = 0xE1;
+    const uchar JPEG_MARKER_APP13           = 0xED;
+    const uchar JPEG_MARKER_COM             = 0xFE;
+    const int JPEG_MARKER_LENGTH            = 2;
+    const int JPEG_SEGMENT_LENGTH_LENGTH    = 2;
+
+    const QByteArray JPEG_EXIF_IDENTIFIER   = QByteArray("Exif\0\0", 6);
+    const QByteArray JPEG_XMP_IDENTIFIER    = "http://ns.adobe.com/xap/1.0/";
+    const QByteArray JPEG_XMP_EXTENSION_IDENTIFIER =
+            "http://ns.adobe.com/xmp/extension/";
+    const QByteArray JPEG_IPTC_IDENTIFIER   = "Photoshop 3.0";
+
+    // PNG chunks: length, type, data and CRC
+    const int PNG_CHUNK_OVERHEAD            = 12;
+    const int PNG_CHUNK_TYPE_OFFSET         = 4;
+    const int PNG_CHUNK_TYPE_LENGTH         = 4;
+    const int PNG_CHUNK_DATA_OFFSET         = 8;
+    const QByteArray PNG_CHUNK_TEXT         = "tEXt";
+    const QByteArray PNG_CHUNK_ZTXT         = "zTXt";
+    const QByteArray PNG_CHUNK_ITXT         = "iTXt";
+    const QByteArray PNG_CHUNK_EXIF         = "eXIf";
+    const QByteArray PNG_CHUNK_IEND         = "IEND";
+    const QByteArray PNG_XMP_KEYWORD        = "XML:com.adobe.xmp";
+
+    // GIF header, logical screen descriptor and block introducers
+    const int GIF_HEADER_LENGTH             = 13;
+    const int GIF_SCREEN_FLAGS_OFFSET       = 10;
+    const int GIF_IMAGE_DESCRIPTOR_LENGTH   = 9;
+    const int GIF_IMAGE_FLAGS_OFFSET        = 8;
+    const uchar GIF_COLOR_TABLE_FLAG        = 0x80;
+    const uchar GIF_COLOR_TABLE_SIZE_MASK   = 0x07;
+    const uchar GIF_EXTENSION_INTRODUCER    = 0x21;
+    const uchar GIF_IMAGE_SEPARATOR         = 0x2C;
+    const uchar GIF_TRAILER                 = 0x3B;
+    const uchar GIF_LABEL_COMMENT           = 0xFE;
+    const uchar GIF_LABEL_APPLICATION       = 0xFF;
+    const QByteArray GIF_XMP_IDENTIFIER     = "XMP DataXMP";
+
 }
 
 
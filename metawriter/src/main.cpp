@@ -30,11 +30,20 @@
 #include <QStringList>
 #include <QDebug>
 #include "metaapplication.h"
+#include "xmphandler.h"
 #include <getopt.h>
 #include <QByteArray>
 #include <QString>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
 #include "metamandatatypes.h"
 #include <iostream>
+#include <stdio.h>
 
 using namespace Metaman;
 
@@ -45,6 +54,7 @@ void printUsage(char* appName)
     std::cout << std::endl << std::endl;
     std::cout << "-i --input              input file" << std::endl;
     std::cout << "-o --output             output file" << std::endl;
+    std::cout << "-p --in-place           modify input file in place" << std::endl;
     std::cout << "-t --title              set/remove title" << std::endl;
     std::cout << "-d --description        set/remove description" << std::endl;
     std::cout << "-k --keyword            add keyword" << std::endl;
@@ -54,13 +64,20 @@ void printUsage(char* appName)
     std::cout << "--itunes                use itunes-style tags" << std::endl;
     std::cout << "--standard              use standard tags" << std::endl;
     std::cout << "--xmp                   use xmp metadata" << std::endl;
+    std::cout << "-b --batch              read jobs from a file, - for stdin" << std::endl;
+    std::cout << "-j --jobs               number of parallel jobs in batch mode" << std::endl;
     std::cout << "-h --help               print this message" << std::endl;
+    std::cout << std::endl;
+    std::cout << "In batch mode every line of the job file holds the options of one" << std::endl;
+    std::cout << "job, quoted like on a command line. Empty lines and lines starting" << std::endl;
+    std::cout << "with # are skipped. Status of each job is printed as" << std::endl;
+    std::cout << "\"<line> OK|FAILED <input file>\"." << std::endl;
     std::cout << std::endl << std::endl;
 }
 
 
 
-void readInputActions(int argc,
+bool readInputActions(int argc,
                       char* argv[],
                       bool& setTitle,
                       bool& setDescription,
@@ -76,11 +93,13 @@ void readInputActions(int argc,
                       QByteArray& title,
                       QByteArray& description,
                       QByteArray& geotag,
-                      QList<QByteArray>& keywords)
+                      QList<QByteArray>& keywords,
+                      QString& batchFile,
+                      int& jobCount)
 {
-
-
-    static struct option longOptions[] =
+    // Not static, the flags point to the variables of this call. Batch mode
+    // parses the options of every job with this function.
+    struct option longOptions[] =
     {
         {"standard", no_argument, &standardTagFlag, 1},
         {"itunes", no_argument, &itunesTagFlag, 1},
@@ -94,18 +113,25 @@ void readInputActions(int argc,
         {"help", no_argument, 0, 'h'},
         {"erase-all", no_argument, 0, 'x'},
         {"erase-author-gps", no_argument, 0, 'c'},
+        {"in-place", no_argument, 0, 'p'},
+        {"batch", required_argument, 0, 'b'},
+        {"jobs", required_argument, 0, 'j'},
 
         {0, 0, 0, 0}
     };
 
     int optionChar;
     int index;
+    bool inPlace = false;
+
+    // Restart the scanning, this may not be the first argument list parsed
+    optind = 0;
 
     while (true) {
 
         optionChar=getopt_long(argc,
                                argv,
-                               "i:t::d::o:k:g::hxc",
+                               "i:t::d::o:k:g::hxcpb:j:",
                                longOptions,
                                &index);
 
@@ -136,7 +162,7 @@ void readInputActions(int argc,
                 }
                 else {
                     qWarning() << "Error: Title conflict";
-                    exit(EXIT_FAILURE);
+                    return false;
                 }
                 
                 break;
@@ -153,7 +179,7 @@ void readInputActions(int argc,
                 }
                 else {
                     qWarning() << "Error: Description conflict";
-                    exit(EXIT_FAILURE);
+                    return false;
                 }
                 
                 break;
@@ -169,7 +195,7 @@ void readInputActions(int argc,
                 }
                 else {
                     qWarning() << "Error: Geotag conflict";
-                    exit(EXIT_FAILURE);
+                    return false;
                 }
                 
                 break;
@@ -191,7 +217,7 @@ void readInputActions(int argc,
                 }
                 else {
                     qWarning() << "Error: Input file conflict";
-                    exit(EXIT_FAILURE);
+                    return false;
                 }
 
                 break;
@@ -204,7 +230,7 @@ void readInputActions(int argc,
                 }
                 else {
                     qWarning() << "Error: Output file conflict";
-                    exit(EXIT_FAILURE);
+                    return false;
                 }
 
                 break;
@@ -228,6 +254,24 @@ void readInputActions(int argc,
                 break;
             }
 
+            case 'p':
+            {
+                inPlace = true;
+                break;
+            }
+
+            case 'b':
+            {
+                batchFile = QString(optarg);
+                break;
+            }
+
+            case 'j':
+            {
+                jobCount = QByteArray(optarg).toInt();
+                break;
+            }
+
             case '?':
             default:
             {
@@ -237,15 +281,28 @@ void readInputActions(int argc,
         }
     }
 
+    if (inPlace) {
+        // Output to the input file. Only the metadata gets rewritten if it
+        // fits in the space of the old metadata and free atoms.
+        if (!outputFile.isEmpty() && outputFile != inputFile) {
+            qWarning() << "Error: Output file conflict";
+            return false;
+        }
+
+        outputFile = inputFile;
+    }
+
     if (eraseAll && (setTitle || setDescription)) {
         qWarning() << "Conflicting options";
-        exit(EXIT_FAILURE);
+        return false;
     }
+
+    return true;
 }
 
 
 
-int processActions(MetaApplication* metaApp,
+int processActions(MetaApplication*& metaApp,
                    char* appName,
                    bool setTitle,
                    bool setDescription,
@@ -383,6 +440,290 @@ int processActions(MetaApplication* metaApp,
 
 
 
+QList<QByteArray> splitJobLine(const QByteArray& line)
+{
+    // Splits like a shell would: whitespace separates arguments, quotes
+    // group them and a backslash escapes the next character
+    QList<QByteArray> arguments;
+    QByteArray argument;
+    bool inArgument = false;
+    char quote = 0;
+
+    for (int i = 0; i < line.size(); ++i) {
+        char c = line.at(i);
+
+        if (c == '\\' && quote != '\'' && i + 1 < line.size()) {
+            argument += line.at(++i);
+            inArgument = true;
+        }
+        else if (quote != 0) {
+            if (c == quote) {
+                quote = 0;
+            }
+            else {
+                argument += c;
+            }
+        }
+        else if (c == '"' || c == '\'') {
+            quote = c;
+            inArgument = true;
+        }
+        else if (c == ' ' || c == '\t') {
+            if (inArgument) {
+                arguments << argument;
+                argument.clear();
+                inArgument = false;
+            }
+        }
+        else {
+            argument += c;
+            inArgument = true;
+        }
+    }
+
+    if (inArgument) {
+        arguments << argument;
+    }
+
+    return arguments;
+}
+
+
+
+/*!
+    \class BatchJob
+    \brief One line of a batch file, run in the thread pool
+ */
+class BatchJob : public QRunnable
+{
+public:
+    BatchJob(int lineNumber, char* appName) :
+        m_lineNumber(lineNumber),
+        m_appName(appName),
+        m_setTitle(false),
+        m_setDescription(false),
+        m_setGeotag(false),
+        m_eraseAll(false),
+        m_eraseAuthorAndGps(false),
+        m_printHelp(false),
+        m_itunesTagFlag(0),
+        m_standardTagFlag(0),
+        m_xmpFlag(0),
+        m_valid(false),
+        m_result(EXIT_FAILURE)
+    {
+        setAutoDelete(false);
+    }
+
+    /**
+     * \brief Read the options of the job
+     * @param arguments Options of the job, not including the program name
+     * @return True if the options are valid
+     */
+    bool parse(const QList<QByteArray>& arguments)
+    {
+        // getopt wants writable strings and may reorder them
+        QList<QByteArray> storage = arguments;
+        storage.prepend(QByteArray(m_appName));
+        QVector<char*> argv;
+
+        for (int i = 0; i < storage.count(); ++i) {
+            argv << storage[i].data();
+        }
+
+        argv << 0;
+
+        QString batchFile;
+        int jobCount = 0;
+
+        bool valid = readInputActions(storage.count(),
+                                      argv.data(),
+                                      m_setTitle,
+                                      m_setDescription,
+                                      m_setGeotag,
+                                      m_eraseAll,
+                                      m_eraseAuthorAndGps,
+                                      m_printHelp,
+                                      m_itunesTagFlag,
+                                      m_standardTagFlag,
+                                      m_xmpFlag,
+                                      m_inputFile,
+                                      m_outputFile,
+                                      m_title,
+                                      m_description,
+                                      m_geotag,
+                                      m_keywords,
+                                      batchFile,
+                                      jobCount);
+
+        if (!batchFile.isEmpty()) {
+            qWarning() << "Error: Batch files cannot be nested";
+            valid = false;
+        }
+
+        m_valid = valid;
+        return valid;
+    }
+
+    /// \reimp
+    virtual void run()
+    {
+        MetaApplication* metaApp = 0;
+        m_result = processActions(metaApp,
+                                  m_appName,
+                                  m_setTitle,
+                                  m_setDescription,
+                                  m_setGeotag,
+                                  m_eraseAll,
+                                  m_eraseAuthorAndGps,
+                                  m_printHelp,
+                                  m_itunesTagFlag,
+                                  m_standardTagFlag,
+                                  m_xmpFlag,
+                                  m_inputFile,
+                                  m_outputFile,
+                                  m_title,
+                                  m_description,
+                                  m_geotag,
+                                  m_keywords);
+        delete metaApp;
+        metaApp = 0;
+
+        reportStatus();
+    }
+    /// \reimp_end
+
+    /**
+     * \brief Print the status line of the job
+     */
+    void reportStatus() const
+    {
+        static QMutex outputMutex;
+        QMutexLocker locker(&outputMutex);
+
+        std::cout << m_lineNumber
+                  << (m_result == EXIT_SUCCESS ? " OK " : " FAILED ")
+                  << m_inputFile.toLocal8Bit().constData() << std::endl;
+    }
+
+    /**
+     * \brief Tells if the options of the job were valid
+     * @return True if the job can be run
+     */
+    bool isValid() const
+    {
+        return m_valid;
+    }
+
+    /**
+     * \brief Returns the exit status of the job
+     * @return EXIT_SUCCESS or EXIT_FAILURE
+     */
+    int result() const
+    {
+        return m_result;
+    }
+
+private:
+    int m_lineNumber;
+    char* m_appName;
+    bool m_setTitle;
+    bool m_setDescription;
+    bool m_setGeotag;
+    bool m_eraseAll;
+    bool m_eraseAuthorAndGps;
+    bool m_printHelp;
+    int m_itunesTagFlag;
+    int m_standardTagFlag;
+    int m_xmpFlag;
+    QString m_inputFile;
+    QString m_outputFile;
+    QByteArray m_title;
+    QByteArray m_description;
+    QByteArray m_geotag;
+    QList<QByteArray> m_keywords;
+    bool m_valid;
+    int m_result;
+};
+
+
+
+int processBatch(char* appName, const QString& batchFile, int jobCount)
+{
+    QFile file;
+    bool opened = false;
+
+    if (batchFile == "-") {
+        opened = file.open(stdin, QIODevice::ReadOnly);
+    }
+    else {
+        file.setFileName(batchFile);
+        opened = file.open(QIODevice::ReadOnly);
+    }
+
+    if (!opened) {
+        qWarning() << "Error: Cannot open batch file " << batchFile;
+        return EXIT_FAILURE;
+    }
+
+    // All the jobs are parsed before any of them runs, getopt cannot be
+    // used from several threads
+    QList<BatchJob*> jobs;
+    int lineNumber = 0;
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        lineNumber++;
+
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        jobs << new BatchJob(lineNumber, appName);
+
+        if (!jobs.last()->parse(splitJobLine(line))) {
+            // Keep the job, so that it gets reported as failed
+            qWarning() << "Error: Invalid job on line " << lineNumber;
+        }
+    }
+
+    file.close();
+
+    if (jobCount <= 0) {
+        jobCount = QThread::idealThreadCount();
+    }
+
+    // Keep the XMP toolkit initialized over all the jobs
+    XmpHandler::acquireToolkit();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(jobCount, 1));
+    int result = EXIT_SUCCESS;
+
+    foreach (BatchJob* job, jobs) {
+        if (job->isValid()) {
+            pool.start(job);
+        }
+        else {
+            job->reportStatus();
+        }
+    }
+
+    pool.waitForDone();
+    XmpHandler::releaseToolkit();
+
+    foreach (BatchJob* job, jobs) {
+        if (job->result() != EXIT_SUCCESS) {
+            result = EXIT_FAILURE;
+        }
+    }
+
+    qDeleteAll(jobs);
+    return result;
+}
+
+
+
 int Q_DECL_EXPORT main(int argc, char *argv[])
 {
     QCoreApplication app(argc, argv);
@@ -402,25 +743,38 @@ int Q_DECL_EXPORT main(int argc, char *argv[])
     QString inputFile;
     QString outputFile;
     QList<QByteArray> keywords;
+    QString batchFile;
+    int jobCount = 1;
+
+    bool validOptions = readInputActions(argc,
+                                         argv,
+                                         setTitle,
+                                         setDescription,
+                                         setGeotag,
+                                         eraseAll,
+                                         eraseAuthorAndGps,
+                                         printHelp,
+                                         itunesTagFlag,
+                                         standardTagFlag,
+                                         xmpFlag,
+                                         inputFile,
+                                         outputFile,
+                                         title,
+                                         description,
+                                         geotag,
+                                         keywords,
+                                         batchFile,
+                                         jobCount);
+
+    if (!validOptions) {
+        return EXIT_FAILURE;
+    }
 
-    readInputActions(argc,
-                     argv,
-                     setTitle,
-                     setDescription,
-                     setGeotag,
-                     eraseAll,
-                     eraseAuthorAndGps,
-                     printHelp,
-                     itunesTagFlag,
-                     standardTagFlag,
-                     xmpFlag,
-                     inputFile,
-                     outputFile,
-                     title,
-                     description,
-                     geotag,
-                     keywords);
     char* appName = argv[0];
+
+    if (!batchFile.isEmpty() && !printHelp) {
+        return processBatch(appName, batchFile, jobCount);
+    }
     
     MetaApplication* metaApp = 0;
     int processingResult = processActions(metaApp,
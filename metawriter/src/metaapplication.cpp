@@ -30,6 +30,7 @@
 #include "backendinterface.h"
 #include "magic.h"
 #include "mp4backend.h"
+#include "imagebackend.h"
 
 #include <QByteArray>
 #include <QString>
@@ -40,6 +41,18 @@
 
 using namespace Metaman;
 
+namespace {
+    BackendInterface* createMp4Backend(OperationMode operationMode)
+    {
+        return new Mp4Backend(operationMode);
+    }
+
+    BackendInterface* createImageBackend(OperationMode operationMode)
+    {
+        return new ImageBackend(operationMode);
+    }
+}
+
 MetaApplication::MetaApplication():
     m_backend(0),
     m_operationMode(OPERATION_MODE_ALL)
@@ -155,21 +168,24 @@ bool MetaApplication::ableToProcess()
     m_inputFile.open(openMode);
 
     if (m_inputFile.isOpen()) {
-        if (hasFtypAtom(m_inputFile)) {
+        delete m_backend; // Just to make sure this won't leak memory
+        m_backend = 0;
 
-            // Ftyp atom means that the file is based on QuickTime/MPEG-4 Part 12
-            // format. Let the MP4 backend make some further test to see if the
-            // file can be handled.
-            delete m_backend; // Just to make sure this won't leak memory
-            m_backend = new Mp4Backend(m_operationMode);
+        foreach (BackendFactory factory, backendFactories()) {
+            BackendInterface* backend = factory(m_operationMode);
 
-            if (m_backend != 0) {
-                canProcess = m_backend->ableToProcess(m_inputFile);
+            if (backend != 0 && backend->ableToProcess(m_inputFile)) {
+                m_backend = backend;
+                canProcess = true;
+                break;
             }
+
+            delete backend;
         }
-        else {
+
+        if (!canProcess) {
             // Cannot handle this type of file; no suitable handler found
-            canProcess = false;
+            qDebug() << "no backend for " << m_inputFilePath;
         }
 
         if (!canProcess) {
@@ -241,25 +257,23 @@ OperationResult MetaApplication::readFile()
 
 
 
-bool MetaApplication::hasFtypAtom(QFile& file)
+void MetaApplication::registerBackend(BackendFactory factory)
 {
-    bool hasFtyp = false;
-    qint32 rawData = 0;
-    
-    if (file.isOpen()) {
-        QDataStream dataStream(&file);
-        dataStream.skipRawData(ATOM_NAME_FTYP_OFFSET);
-        dataStream >> rawData;
+    if (factory != 0 && !backendFactories().contains(factory)) {
+        backendFactories() << factory;
     }
+}
 
-    rawData = qToBigEndian(rawData);
-    QByteArray readAtomName((char*)(&rawData), ATOM_NAME_PREAMBLE_LENGTH);
 
-    if (readAtomName == ATOM_NAME_FTYP) {
-        hasFtyp = true;
-    }
 
-    return hasFtyp;
+QList<MetaApplication::BackendFactory>& MetaApplication::backendFactories()
+{
+    // Cheap format checks first. Image files are recognized from a few
+    // bytes, MP4 files need their atoms scanned.
+    static QList<BackendFactory> factories =
+            QList<BackendFactory>() << createImageBackend
+                                    << createMp4Backend;
+    return factories;
 }
 
 
@@ -32,6 +32,7 @@
 #include <QString>
 #include <QByteArray>
 #include <QFile>
+#include <QList>
 #include "metamandatatypes.h"
 
 namespace Metaman {
@@ -53,6 +54,9 @@ namespace Metaman {
             FORMAT_3GPP2
         };
 
+        /// Function that creates a file format backend
+        typedef BackendInterface* (*BackendFactory)(OperationMode operationMode);
+
         /**
          * \brief Constructor
          */
@@ -141,13 +145,22 @@ namespace Metaman {
          * @return Operation result
          */
         OperationResult setGeotag(const QByteArray& geotag);
+        /**
+         * \brief Register a file format backend
+         * ableToProcess() tries the backends in registration order and
+         * uses the first one that accepts the input file. The built-in
+         * backends come first. Registering is not thread safe, so it must
+         * be done before any files are processed.
+         * @param factory Function creating the backend
+         */
+        static void registerBackend(BackendFactory factory);
+
     private:
         /**
-         * \brief Check if the file is a Mpeg4 type of file
-         * @param File to be evaluated
-         * @return True if yes, false if not
+         * \brief Returns the registered backend factories
+         * @return Backend factories in registration order
          */
-        bool hasFtypAtom(QFile& file);
+        static QList<BackendFactory>& backendFactories();
         
     private:
 
@@ -37,6 +37,7 @@
 #include <QtEndian>
 #include "xmphandler.h"
 #include "mpeg4atomutility.h"
+#include <climits>
 
 //be7acfcb-97a9-42e8-9c71-999491e3afac is UUID for XMP data:
 //http://www.adobe.com/content/dam/Adobe/en/devnet/xmp/pdfs/XMPSpecificationPart3.pdf
@@ -49,7 +50,10 @@ Mp4Backend::Mp4Backend(OperationMode operationMode)
    m_sourceFile(0),
    m_operationMode(operationMode),
    m_xmpHandler(0),
-   m_xmpReadFromUUID (false)
+   m_xmpReadFromUUID (false),
+   m_xmpPacketSize(0),
+   m_scannedFile(0),
+   m_scannedSize(0)
 {
     qDebug() << "Using Mp4Backend, operation mode: " << m_operationMode;
 }
@@ -541,44 +545,86 @@ OperationResult Mp4Backend::setAtomData(const QByteArray& content,
 OperationResult Mp4Backend::readFile(QFile& inputFile)
 {
     qDebug() << "readFile()";
-    OperationResult operationResult = OPERATION_GENERAL_ERROR;
     m_sourceFile = &inputFile;
 
-    if (inputFile.isOpen()) {
+    if (!inputFile.isOpen()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    if (!scanTopLevelAtoms(inputFile)) {
+        qWarning() << "Invalid atom structure";
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    // Metadata atoms are held in QByteArrays, which are indexed with int
+    foreach (const Mpeg4AtomUtility::AtomInfo& info, m_topLevelAtoms) {
+        if (Mpeg4AtomUtility::resolveAtomStorage(info.name) ==
+            ATOM_STORAGE_MEMORY && info.size > INT_MAX) {
+            qWarning() << "Atom too large to read: " << info.name;
+            return OPERATION_GENERAL_ERROR;
+        }
+    }
+
+    // As the root atom is a fake atom, these properties are really not
+    // meaningful.
+    QByteArray rootAtomName("");
+    QByteArray emptyContents;
+    qint64 rootAtomOriginalSize = -1;
+    qint64 locationOfRootAtomInFile = -1;
+    Atom* parentForRootAtom = 0;
+
+    delete m_rootAtom;
+    m_rootAtom = new Atom(rootAtomName,
+                          ATOM_TYPE_PSEUDO,
+                          ATOM_STORAGE_MEMORY,
+                          rootAtomOriginalSize,
+                          emptyContents,
+                          locationOfRootAtomInFile,
+                          parentForRootAtom);
+
+    uchar* mapping = inputFile.map(0, inputFile.size());
+
+    if (mapping != 0) {
+        // Metadata atoms are copied out of the mapping, so that the tree
+        // stays valid when the file is written over later on
+        foreach (const Mpeg4AtomUtility::AtomInfo& info, m_topLevelAtoms) {
+            AtomStorage atomStorage =
+                    Mpeg4AtomUtility::resolveAtomStorage(info.name);
+            qint64 contentsLength = (atomStorage == ATOM_STORAGE_MEMORY)
+                                    ? info.size : info.headerLength;
+            QByteArray contents((const char*)mapping + info.location,
+                                contentsLength);
+
+            Atom* atom = new Atom(info.name,
+                                  Mpeg4AtomUtility::resolveAtomType(info.name),
+                                  atomStorage,
+                                  info.size,
+                                  contents,
+                                  info.location,
+                                  true,
+                                  m_rootAtom,
+                                  &inputFile);
+            atom->setLargeSize(info.headerLength == ATOM_LARGE_HEADER_LENGTH);
+            m_rootAtom->appendChild(atom);
+        }
+
+        inputFile.unmap(mapping);
+    }
+    else {
+        qDebug() << "cannot map input file, reading atoms one by one";
         inputFile.seek(0);
         QDataStream in(&inputFile);
 
-        // As the root atom is a fake atom, these properties are really not
-        // meaningful.
-        QByteArray rootAtomName("");
-        QByteArray emptyContents;
-        qint32 rootAtomOriginalSize = -1;
-        qint32 locationOfRootAtomInFile = -1;
-        Atom* parentForRootAtom = 0;
-
-        m_rootAtom = new Atom(rootAtomName,
-                              ATOM_TYPE_PSEUDO,
-                              ATOM_STORAGE_MEMORY,
-                              rootAtomOriginalSize,
-                              emptyContents,
-                              locationOfRootAtomInFile,
-                              parentForRootAtom);
-
-        // This is a failsafe guard that prevents an infinite loop
-        int counter = 0; 
-
-        while (!in.atEnd() && counter <= MAX_ATOMS) {
+        for (int i = 0; i < m_topLevelAtoms.count(); ++i) {
             Atom* atom = Mpeg4AtomUtility::readAtom(in, m_rootAtom);
             m_rootAtom->appendChild(atom);
-            counter++;
         }
+    }
 
-        if (m_operationMode & OPERATION_MODE_XMP) {
-            operationResult = prepareXmpHandler();
-        }
-        else {
-            operationResult = OPERATION_OK;
-        }
+    OperationResult operationResult = OPERATION_OK;
+
+    if (m_operationMode & OPERATION_MODE_XMP) {
+        operationResult = prepareXmpHandler();
     }
 
     return operationResult;
@@ -595,6 +641,9 @@ OperationResult Mp4Backend::writeFile(QFile& outputFile)
         return OPERATION_GENERAL_ERROR;
     }
 
+    // The file may change, so the earlier scan cannot be trusted after this
+    m_scannedFile = 0;
+
     qDebug() << "top level children:";
     foreach (Atom* atom, m_rootAtom->children()) {
         qDebug() << atom->name();
@@ -606,6 +655,32 @@ OperationResult Mp4Backend::writeFile(QFile& outputFile)
         // This will update the data of the xmp atom.
         operationResult = finalizeXmpProcessing();
     }
+
+    if (operationResult == OPERATION_OK && &outputFile == m_sourceFile) {
+        // Try to patch the metadata without touching the media data
+        if (writeInPlace(outputFile) == OPERATION_OK) {
+            return OPERATION_OK;
+        }
+
+        qDebug() << "in place write not possible, rewriting the file";
+    }
+
+    if (operationResult == OPERATION_OK) {
+        // Metadata changes may have moved the media data
+        operationResult = relocateChunkOffsets();
+    }
+
+    if (operationResult == OPERATION_OK && &outputFile == m_sourceFile) {
+        // Media data is copied front to back, so when writing over the
+        // source file it must not move towards the end of the file.
+        foreach (const MediaDataMove& move, mediaDataMoves()) {
+            if (move.newStart > move.originalStart) {
+                qWarning() << "Cannot grow metadata in place";
+                operationResult = OPERATION_GENERAL_ERROR;
+                break;
+            }
+        }
+    }
     
     if (outputFile.isOpen() &&
         m_rootAtom != 0     &&
@@ -623,6 +698,12 @@ OperationResult Mp4Backend::writeFile(QFile& outputFile)
             }
         }
 
+        if (operationResult == OPERATION_OK &&
+            outputFile.pos() < outputFile.size()) {
+            // Output got shorter than the file it overwrote
+            outputFile.resize(outputFile.pos());
+        }
+
         qDebug() << "file written";
     }
 
@@ -639,62 +720,105 @@ bool Mp4Backend::ableToProcess(QFile& inputFile)
         return false;
     }
 
-    if (Mpeg4AtomUtility::has64BitAtoms(inputFile)) {
+    QByteArray brand = readBrand(inputFile);
+
+    // 3GPP, MPEG-4 video and audio and QuickTime files share the atom
+    // structure and the metadata locations this backend handles
+    static const QList<QByteArray> supportedBrands = QList<QByteArray>()
+        << BRAND_3GP4 << BRAND_3GP5 << BRAND_3GP6 << BRAND_3G2A
+        << BRAND_MP41 << BRAND_MP42 << BRAND_ISOM
+        << BRAND_M4A << BRAND_M4V << BRAND_QT;
+
+    if (!supportedBrands.contains(brand)) {
         return false;
     }
 
-    QByteArray brand = readBrand(inputFile);
+    if (!scanTopLevelAtoms(inputFile)) {
+        return false;
+    }
 
-    if (brand != BRAND_3GP4 && brand != BRAND_MP42) {
-        // It is also possible that this handler works on other brands too,
-        // but those haven't been tested.
+    // The brand is only meaningful if it came from a file type atom
+    if (m_topLevelAtoms.isEmpty() ||
+        m_topLevelAtoms.first().name != ATOM_NAME_FTYP) {
         return false;
     }
 
-    qint32 index = 0;
-    QByteArray atomName;
-    qint32 atomSize = 0;
+    // Only chunk offset tables are relocated when media data moves, so
+    // fragmented files cannot be handled
+    foreach (const Mpeg4AtomUtility::AtomInfo& info, m_topLevelAtoms) {
+        if (info.name == ATOM_NAME_MOOF || info.name == ATOM_NAME_MFRA) {
+            qDebug() << "fragmented file, not supported";
+            return false;
+        }
+    }
+
+    return true;
+}
 
-    inputFile.seek(0);
-    QList<QByteArray> atomNames;
 
-    int failsafeCounter = 0;
-    qDebug() << "file size " << inputFile.size();
-    while(!inputFile.atEnd() && failsafeCounter <= MAX_ATOMS) {
-        Mpeg4AtomUtility::readAtomInfoFromFile(inputFile,
-                                               index,
-                                               atomName,
-                                               atomSize);
-        qDebug() << "found atom" << atomName << atomSize << index;
-       atomNames.append(atomName);
-       index += atomSize;
-       qDebug() << "index after round: " << index;
 
-       failsafeCounter++;
+bool Mp4Backend::scanTopLevelAtoms(QFile& inputFile)
+{
+    if (m_scannedFile == &inputFile && m_scannedSize == inputFile.size()) {
+        qDebug() << "using earlier scan of " << m_topLevelAtoms.count()
+                 << " atoms";
+        return true;
     }
 
-    if (failsafeCounter > MAX_ATOMS) {
-        qDebug() << "failsafe guard aborted the processing";
-        return false;
-    }
+    m_scannedFile = 0;
+    m_topLevelAtoms.clear();
 
-    if (atomNames.indexOf(ATOM_NAME_MOOV) < atomNames.indexOf(ATOM_NAME_MDAT)){
-        // It is extremely essential to maintain the mdat atom position in the
-        // file because this backend doesn't currently implement for example
-        // sample table chunk offset recalculation. This means that if mdat
-        // position changes, the video file becomes unplayable.
-        // If moov atom is placed after mdat atom, modifications in the
-        // metadata don't affect mdat element position.
-        return false;
+    const qint64 fileSize = inputFile.size();
+    bool valid = false;
+    uchar* mapping = inputFile.map(0, fileSize);
+
+    if (mapping != 0) {
+        valid = Mpeg4AtomUtility::scanAtoms(mapping,
+                                            fileSize,
+                                            m_topLevelAtoms);
+        inputFile.unmap(mapping);
     }
+    else {
+        // Mapping is not supported by all file systems. Read the preambles
+        // directly from the file instead.
+        qDebug() << "cannot map input file, reading atom preambles";
+        qint64 index = 0;
+        valid = true;
+
+        while (index < fileSize && valid) {
+            Mpeg4AtomUtility::AtomInfo info;
+            inputFile.seek(index);
+            QByteArray header = inputFile.read(ATOM_LARGE_HEADER_LENGTH);
+
+            info.location = index;
+            info.size = Mpeg4AtomUtility::readAtomSize(header,
+                                                       0,
+                                                       info.headerLength);
+
+            if (info.size == ATOM_SIZE_TO_END) {
+                info.size = fileSize - index;
+            }
 
-    inputFile.seek(index);
+            valid = (info.headerLength != 0 &&
+                     info.size >= info.headerLength &&
+                     info.size <= fileSize - index &&
+                     m_topLevelAtoms.count() < MAX_ATOMS);
 
-    if (!inputFile.atEnd()) {
-        return false;
+            if (valid) {
+                info.name = header.mid(ATOM_SIZE_PREAMBLE_LENGTH,
+                                       ATOM_NAME_PREAMBLE_LENGTH);
+                m_topLevelAtoms << info;
+                index += info.size;
+            }
+        }
     }
 
-    return true;
+    if (valid) {
+        m_scannedFile = &inputFile;
+        m_scannedSize = fileSize;
+    }
+
+    return valid;
 }
 
 
@@ -742,6 +866,7 @@ OperationResult Mp4Backend::prepareXmpHandler()
     }
 
     OperationResult result = OPERATION_OK;
+    m_xmpPacketSize = xmpData.size();
         
     if (m_xmpHandler != 0) {
         m_xmpHandler->setXmpDataToBeProcessed(xmpData);
@@ -762,8 +887,19 @@ OperationResult Mp4Backend::finalizeXmpProcessing()
 {
     OperationResult result = OPERATION_OK;
 
+    if (m_xmpHandler != 0 && !m_xmpHandler->isModified()) {
+        // Leave the atom as it is, it was not touched
+        return result;
+    }
+
     if (m_xmpHandler != 0) {
-        QByteArray xmpData = m_xmpHandler->getProcessedData();
+        // All edits of this run are applied to the packet at once
+        result = m_xmpHandler->commitEdits();
+    }
+
+    if (m_xmpHandler != 0 && result == OPERATION_OK) {
+        // Keeping the packet size lets the atom be rewritten in place
+        QByteArray xmpData = m_xmpHandler->getProcessedData(m_xmpPacketSize);
         Atom* xmpAtom = 0;
         
         if (m_xmpReadFromUUID == false) {
@@ -882,3 +1018,379 @@ OperationResult Mp4Backend::setKeywords(const QList<QByteArray>& keywords)
     
     return operationResult;
 }
+
+
+
+QList<Mp4Backend::MediaDataMove> Mp4Backend::mediaDataMoves() const
+{
+    QList<MediaDataMove> moves;
+
+    if (m_rootAtom == 0) {
+        return moves;
+    }
+
+    // Top level atoms are written one after another from the beginning of
+    // the output file. Atoms stored in file are copied as they are, others
+    // are written from memory with their current size.
+    qint64 position = 0;
+
+    foreach (Atom* atom, m_rootAtom->children()) {
+        if (atom->storage() == ATOM_STORAGE_FILE) {
+            MediaDataMove move;
+            move.originalStart = atom->locationInFile();
+            move.originalEnd = atom->locationInFile() + atom->originalSize();
+            move.newStart = position;
+            moves << move;
+
+            position += atom->originalSize();
+        }
+        else {
+            position += atom->size();
+        }
+    }
+
+    return moves;
+}
+
+
+
+qint64 Mp4Backend::relocatedOffset(qint64 offset,
+                                   const QList<MediaDataMove>& moves)
+{
+    foreach (const MediaDataMove& move, moves) {
+        if (offset >= move.originalStart && offset < move.originalEnd) {
+            return offset - move.originalStart + move.newStart;
+        }
+    }
+
+    // Not pointing to media data. Nothing to relocate.
+    return offset;
+}
+
+
+
+QList<Atom*> Mp4Backend::chunkOffsetTables()
+{
+    QList<Atom*> tables;
+    Atom* moov = Mpeg4AtomUtility::findAtom(ATOM_PATH_ALLMETADATA, m_rootAtom);
+
+    if (moov == 0) {
+        return tables;
+    }
+
+    foreach (Atom* trak, moov->children()) {
+        if (trak->name() != ATOM_NAME_TRAK) {
+            continue;
+        }
+
+        Atom* stbl = Mpeg4AtomUtility::findAtom(ATOM_PATH_SAMPLETABLE_IN_TRAK,
+                                                trak);
+
+        if (stbl == 0) {
+            continue;
+        }
+
+        foreach (Atom* table, stbl->children()) {
+            if (table->name() == ATOM_NAME_STCO ||
+                table->name() == ATOM_NAME_CO64) {
+                if (table->isExpandable()) {
+                    table->expand();
+                }
+
+                if (table->isExpandable()) {
+                    qWarning() << "Chunk offset table size mismatch";
+                    continue;
+                }
+
+                tables << table;
+            }
+        }
+    }
+
+    return tables;
+}
+
+
+
+bool Mp4Backend::hasUnrelocatableOffsets()
+{
+    Atom* moov = Mpeg4AtomUtility::findAtom(ATOM_PATH_ALLMETADATA, m_rootAtom);
+
+    if (moov == 0) {
+        return false;
+    }
+
+    foreach (Atom* trak, moov->children()) {
+        if (trak->name() != ATOM_NAME_TRAK) {
+            continue;
+        }
+
+        Atom* stbl = Mpeg4AtomUtility::findAtom(ATOM_PATH_SAMPLETABLE_IN_TRAK,
+                                                trak);
+
+        if (stbl == 0) {
+            continue;
+        }
+
+        foreach (Atom* table, stbl->children()) {
+            if (table->name() == ATOM_NAME_SAIO) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+
+OperationResult Mp4Backend::relocateChunkOffsets()
+{
+    QList<MediaDataMove> moves = mediaDataMoves();
+    bool moved = false;
+
+    foreach (const MediaDataMove& move, moves) {
+        if (move.newStart != move.originalStart) {
+            moved = true;
+            break;
+        }
+    }
+
+    if (!moved) {
+        return OPERATION_OK;
+    }
+
+    qDebug() << "media data moves, relocating chunk offsets";
+
+    if (hasUnrelocatableOffsets()) {
+        qWarning() << "Sample table has offsets that cannot be relocated";
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    // Converting stco to co64 makes moov bigger, which moves the media data
+    // again. Repeat until no more conversions are needed. Offsets are still
+    // the original ones at this point.
+    bool converted = true;
+
+    while (converted) {
+        converted = false;
+
+        foreach (Atom* table, chunkOffsetTables()) {
+            if (table->name() != ATOM_NAME_STCO) {
+                continue;
+            }
+
+            QByteArray data = table->data();
+
+            if (data.size() < CHUNK_OFFSET_TABLE_HEADER_LENGTH) {
+                qWarning() << "Invalid chunk offset table";
+                return OPERATION_GENERAL_ERROR;
+            }
+
+            const uchar* raw = (const uchar*)data.constData();
+            quint32 count = qFromBigEndian<quint32>(raw +
+                                                    CHUNK_OFFSET_COUNT_OFFSET);
+
+            if (CHUNK_OFFSET_TABLE_HEADER_LENGTH + (qint64)count * 4 >
+                data.size()) {
+                qWarning() << "Truncated chunk offset table";
+                return OPERATION_GENERAL_ERROR;
+            }
+
+            bool needsLargeOffsets = false;
+
+            for (quint32 i = 0; i < count; ++i) {
+                qint64 offset = qFromBigEndian<quint32>(raw +
+                    CHUNK_OFFSET_TABLE_HEADER_LENGTH + i * 4);
+
+                if (relocatedOffset(offset, moves) > ATOM_MAX_COMPACT_SIZE) {
+                    needsLargeOffsets = true;
+                    break;
+                }
+            }
+
+            if (!needsLargeOffsets) {
+                continue;
+            }
+
+            QByteArray co64Data = data.left(CHUNK_OFFSET_TABLE_HEADER_LENGTH);
+
+            for (quint32 i = 0; i < count; ++i) {
+                quint64 offset = qToBigEndian((quint64)qFromBigEndian<quint32>(
+                    raw + CHUNK_OFFSET_TABLE_HEADER_LENGTH + i * 4));
+                co64Data.append((const char*)(&offset), sizeof(offset));
+            }
+
+            Atom* stbl = table->parentAtom();
+            int index = stbl->children().indexOf(table);
+            Atom* co64 = new Atom(ATOM_NAME_CO64,
+                                  ATOM_TYPE_DATA,
+                                  ATOM_STORAGE_MEMORY,
+                                  co64Data.size() + ATOM_HEADER_LENGTH,
+                                  co64Data,
+                                  -1,
+                                  false,
+                                  stbl);
+            stbl->addChild(co64, index);
+            stbl->removeChild(table);
+
+            converted = true;
+        }
+
+        if (converted) {
+            moves = mediaDataMoves();
+        }
+    }
+
+    foreach (Atom* table, chunkOffsetTables()) {
+        QByteArray data = table->data();
+        const int entrySize = (table->name() == ATOM_NAME_CO64) ? 8 : 4;
+
+        if (data.size() < CHUNK_OFFSET_TABLE_HEADER_LENGTH) {
+            qWarning() << "Invalid chunk offset table";
+            return OPERATION_GENERAL_ERROR;
+        }
+
+        uchar* raw = (uchar*)data.data();
+        quint32 count = qFromBigEndian<quint32>(raw + CHUNK_OFFSET_COUNT_OFFSET);
+
+        if (CHUNK_OFFSET_TABLE_HEADER_LENGTH + (qint64)count * entrySize >
+            data.size()) {
+            qWarning() << "Truncated chunk offset table";
+            return OPERATION_GENERAL_ERROR;
+        }
+
+        for (quint32 i = 0; i < count; ++i) {
+            uchar* entry = raw + CHUNK_OFFSET_TABLE_HEADER_LENGTH +
+                           i * entrySize;
+
+            if (entrySize == 8) {
+                qint64 offset = (qint64)qFromBigEndian<quint64>(entry);
+                qToBigEndian((quint64)relocatedOffset(offset, moves), entry);
+            }
+            else {
+                qint64 offset = qFromBigEndian<quint32>(entry);
+                qToBigEndian((quint32)relocatedOffset(offset, moves), entry);
+            }
+        }
+
+        table->setData(data);
+    }
+
+    return OPERATION_OK;
+}
+
+
+
+bool Mp4Backend::balanceWithFreeSpace()
+{
+    QList<FreeSpaceAdjustment> adjustments;
+    QList<Atom*> atoms = m_rootAtom->children();
+    qint64 gapStart = 0;
+    qint64 gapLength = 0;
+    Atom* freeAtom = 0;
+
+    // All gaps are checked before any atom is changed, so that the tree
+    // stays intact for a full rewrite if the media data has to move
+    for (int i = 0; i < atoms.count(); ++i) {
+        Atom* atom = atoms.at(i);
+
+        if (atom->storage() != ATOM_STORAGE_FILE) {
+            gapLength += atom->size();
+
+            if (freeAtom == 0 && atom->name() == ATOM_NAME_FREE) {
+                freeAtom = atom;
+            }
+
+            continue;
+        }
+
+        // Atoms before this media data atom must fill the original gap
+        qint64 sizeDelta = gapLength - (atom->locationInFile() - gapStart);
+
+        if (sizeDelta != 0) {
+            FreeSpaceAdjustment adjustment = {0, atom, -sizeDelta};
+
+            if (freeAtom != 0 &&
+                freeAtom->size() - sizeDelta >= freeAtom->headerLength()) {
+                adjustment.freeAtom = freeAtom;
+            }
+            else if (sizeDelta > -ATOM_HEADER_LENGTH) {
+                qDebug() << "not enough free space before " << atom->name();
+                return false;
+            }
+
+            adjustments << adjustment;
+        }
+
+        gapStart = atom->locationInFile() + atom->originalSize();
+        gapLength = 0;
+        freeAtom = 0;
+    }
+
+    foreach (const FreeSpaceAdjustment& adjustment, adjustments) {
+        if (adjustment.freeAtom != 0) {
+            Mpeg4AtomUtility::adjustFreeSpace(adjustment.freeAtom,
+                                              adjustment.sizeDelta);
+            qDebug() << "free atom adjusted by " << adjustment.sizeDelta;
+        }
+        else {
+            QByteArray padding(adjustment.sizeDelta - ATOM_HEADER_LENGTH, 0);
+            Atom* padAtom = new Atom(ATOM_NAME_FREE,
+                                     ATOM_TYPE_DATA,
+                                     ATOM_STORAGE_MEMORY,
+                                     adjustment.sizeDelta,
+                                     padding,
+                                     -1,
+                                     false,
+                                     m_rootAtom);
+            m_rootAtom->addChild(padAtom, m_rootAtom->children().indexOf(
+                                              adjustment.mediaAtom));
+            qDebug() << "added free atom of size " << adjustment.sizeDelta;
+        }
+    }
+
+    return true;
+}
+
+
+
+OperationResult Mp4Backend::writeInPlace(QFile& file)
+{
+    qDebug() << "Mp4Backend::writeInPlace()";
+
+    if (!file.isOpen() || !(file.openMode() & QIODevice::WriteOnly)) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    if (!balanceWithFreeSpace()) {
+        return OPERATION_GENERAL_ERROR;
+    }
+
+    // Nothing moves, so chunk offsets stay valid as they are
+    QDataStream out(&file);
+    qint64 position = 0;
+
+    foreach (Atom* atom, m_rootAtom->children()) {
+        if (atom->storage() == ATOM_STORAGE_FILE) {
+            position = atom->locationInFile() + atom->originalSize();
+            continue;
+        }
+
+        file.seek(position);
+        OperationResult result = Mpeg4AtomUtility::writeAtom(out, atom);
+
+        if (result != OPERATION_OK) {
+            return result;
+        }
+
+        position = file.pos();
+    }
+
+    if (position != file.size()) {
+        file.resize(position);
+    }
+
+    qDebug() << "metadata written in place";
+    return OPERATION_OK;
+}
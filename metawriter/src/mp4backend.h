@@ -31,6 +31,8 @@
 
 #include <backendinterface.h>
 #include "metamandatatypes.h"
+#include "mpeg4atomutility.h"
+#include <QList>
 
 class QByteArray;
 class QDataStream;
@@ -146,6 +148,16 @@ private:
      */
     QByteArray readBrand(QFile& inputFile);
 
+    /**
+     * \brief Find the top level atoms of the input file
+     * The file is memory mapped and the atom preambles are parsed from the
+     * mapping in a single walk. The result is kept, so that the walk done
+     * by ableToProcess() is reused by readFile().
+     * \param inputFile Input file
+     * \return True if the file consists of valid atoms, false if not
+     */
+    bool scanTopLevelAtoms(QFile& inputFile);
+
     /**
      * \brief Drop metadata that is selected not to be handled
      * This is to ensure that there are no conflicting metadata.
@@ -154,6 +166,81 @@ private:
      */
     OperationResult dropUnhandledMetadata();
 
+    /// Original and new position of an atom whose data is copied from file
+    struct MediaDataMove {
+        qint64 originalStart;
+        qint64 originalEnd;
+        qint64 newStart;
+    };
+
+    /**
+     * \brief Calculate where the media data atoms will be written
+     * \return Original and new positions of media data atoms
+     */
+    QList<MediaDataMove> mediaDataMoves() const;
+
+    /**
+     * \brief Find the position of a media data offset in the output file
+     * \param offset Offset in the source file
+     * \param moves Media data positions, see mediaDataMoves()
+     * \return Offset in the output file
+     */
+    static qint64 relocatedOffset(qint64 offset,
+                                  const QList<MediaDataMove>& moves);
+
+    /**
+     * \brief Find chunk offset tables (stco and co64) of all tracks
+     * \return List of chunk offset table atoms
+     */
+    QList<Atom*> chunkOffsetTables();
+
+    /**
+     * \brief Check if sample tables have absolute offsets other than the
+     *        chunk offsets, such as auxiliary sample information offsets
+     * \return True if there are offsets relocateChunkOffsets() cannot fix
+     */
+    bool hasUnrelocatableOffsets();
+
+    /**
+     * \brief Update sample table chunk offsets to match the output file
+     * Needed when the media data moves, for example when moov is placed
+     * before mdat and its size changes. A stco table is converted to co64
+     * if the new offsets do not fit in 32 bits.
+     * \return Operation status
+     */
+    OperationResult relocateChunkOffsets();
+
+    /// Size change of a gap between media data atoms, see
+    /// balanceWithFreeSpace()
+    struct FreeSpaceAdjustment {
+        /// Free atom to resize, null if padding is added
+        Atom* freeAtom;
+        /// Media data atom that ends the gap
+        Atom* mediaAtom;
+        qint64 sizeDelta;
+    };
+
+    /**
+     * \brief Balance size changes of metadata with free atoms
+     * Size changes of the atoms between two media data atoms are absorbed
+     * by a free atom in the same gap, so that media data does not move. A
+     * new free atom is added to a gap that shrinks and has no free atom.
+     * Size of the atoms after the last media data atom may change freely.
+     * Nothing is changed unless every gap can be balanced.
+     * \return True if media data stays in place, false if not
+     */
+    bool balanceWithFreeSpace();
+
+    /**
+     * \brief Write only the metadata atoms over the source file
+     * Media data atoms are left untouched, so the amount of data written
+     * does not depend on the size of the media.
+     * \param file Source file, open for writing
+     * \return Operation status. Fails without touching the file if media
+     *         data would have to move.
+     */
+    OperationResult writeInPlace(QFile& file);
+
 private:
 
     /// A pointer to the root atom
@@ -170,6 +257,18 @@ private:
     
     // If true XMP was read from UUID
     bool m_xmpReadFromUUID;
+
+    /// Size of the XMP packet read from the file, 0 if there was none
+    int m_xmpPacketSize;
+
+    /// Top level atoms of the scanned file, see scanTopLevelAtoms()
+    QList<Mpeg4AtomUtility::AtomInfo> m_topLevelAtoms;
+
+    /// The file m_topLevelAtoms belongs to, null if not scanned
+    QFile* m_scannedFile;
+
+    /// Size of the file when it was scanned
+    qint64 m_scannedSize;
     
 };
 
@@ -35,6 +35,19 @@
 #include <QFile>
 #include <QList>
 #include <QDebug>
+#include <QtEndian>
+#include <QVector>
+#include <limits.h>
+#include <sys/sendfile.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// copy_file_range() is available since glibc 2.27
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE
+#endif
 
 QByteArray Mpeg4AtomUtility::findAtomPath(Metaman::Atom* atom)
 {
@@ -61,10 +74,10 @@ Metaman::Atom* Mpeg4AtomUtility::readAtom(QDataStream& in,
                                           Metaman::Atom* atomParent)
 {
     qDebug() << "readAtom()";
-    qint32 locationInFile = -1;
+    qint64 locationInFile = -1;
 
     if (in.device() != 0) {
-        locationInFile = (qint32)in.device()->pos();
+        locationInFile = in.device()->pos();
     }
 
     QFile* inputFile = qobject_cast<QFile*>(in.device());
@@ -72,31 +85,41 @@ Metaman::Atom* Mpeg4AtomUtility::readAtom(QDataStream& in,
         qCritical () << "Could not cast input data stream to file";
         return 0;
     }
-    qint32 sizePreambleLength = Metaman::ATOM_SIZE_PREAMBLE_LENGTH;
     
-    QByteArray atomSizeBytes = inputFile->read(sizePreambleLength);
-    qint32 atomSize = atomSizeBytes.toHex().toInt(0,16);
-    QByteArray atomName = inputFile->read(Metaman::ATOM_NAME_PREAMBLE_LENGTH);
+    QByteArray atomHeader = inputFile->read(Metaman::ATOM_HEADER_LENGTH);
+    int headerLength = 0;
+    qint64 atomSize = readAtomSize(atomHeader, 0, headerLength);
+
+    if (headerLength == Metaman::ATOM_LARGE_HEADER_LENGTH) {
+        atomHeader += inputFile->read(Metaman::ATOM_LARGE_SIZE_PREAMBLE_LENGTH);
+        atomSize = readAtomSize(atomHeader, 0, headerLength);
+    }
+
+    if (headerLength == 0) {
+        qWarning() << "Truncated atom at " << locationInFile;
+        return 0;
+    }
+
+    if (atomSize == Metaman::ATOM_SIZE_TO_END) {
+        atomSize = inputFile->size() - locationInFile;
+    }
+
+    QByteArray atomName = atomHeader.mid(Metaman::ATOM_SIZE_PREAMBLE_LENGTH,
+                                         Metaman::ATOM_NAME_PREAMBLE_LENGTH);
     
     // Size and name are included also here because of how expand() and 
     // collapse() work.
-    QByteArray atomData = atomSizeBytes + atomName;
+    QByteArray atomData = atomHeader;
 
     Metaman::AtomType atomType = resolveAtomType(atomName);
     Metaman::AtomStorage atomStorage = resolveAtomStorage(atomName);
 
     if (atomStorage == Metaman::ATOM_STORAGE_MEMORY) {
-        atomData += inputFile->read(atomSize -
-                                    Metaman::ATOM_SIZE_PREAMBLE_LENGTH -
-                                    Metaman::ATOM_NAME_PREAMBLE_LENGTH);
+        atomData += inputFile->read(atomSize - headerLength);
         qDebug() << "read " << atomData.size() << " bytes of data";
     }
     else {
-        qint32 currentPos = inputFile->pos();
-        inputFile->seek(currentPos +
-                        atomSize -
-                        Metaman::ATOM_SIZE_PREAMBLE_LENGTH -
-                        Metaman::ATOM_NAME_PREAMBLE_LENGTH);
+        inputFile->seek(locationInFile + atomSize);
     }
 
     bool expandable = true;
@@ -111,6 +134,10 @@ Metaman::Atom* Mpeg4AtomUtility::readAtom(QDataStream& in,
                                             atomParent,
                                             inputFile);
 
+    if (atom != 0) {
+        atom->setLargeSize(headerLength == Metaman::ATOM_LARGE_HEADER_LENGTH);
+    }
+
     return atom;
 }
 
@@ -138,24 +165,53 @@ Metaman::OperationResult Mpeg4AtomUtility::writeAtom(QDataStream& out, Metaman::
     }
 
     if (atom->storage() == Metaman::ATOM_STORAGE_MEMORY) {
-        QByteArray data = atom->collapse();
-        qDebug() << "WRITING ATOM SIZE " << data.size() << "/" << atom->size();
-        out.writeRawData(data, data.size());
+        QList<QByteArray> segments;
+        atom->collectSegments(segments);
+
+        qint64 atomSize = atom->size();
+        qint64 written = writeSegments(segments, out.device());
+        qDebug() << "WRITING ATOM SIZE " << written << "/" << atomSize;
+
+        if (written != atomSize) {
+            qWarning() << "Could not write atom " << atom->name();
+            operationResult = Metaman::OPERATION_GENERAL_ERROR;
+        }
+    }
+    else if (atom->sourceFile() != 0 &&
+             qobject_cast<QFile*>(out.device()) != 0) {
+        QFile* outputFile = qobject_cast<QFile*>(out.device());
+        qint64 atomSize = atom->originalSize();
+        qint64 copied = copyFileData(*atom->sourceFile(),
+                                     atom->locationInFile(),
+                                     atomSize,
+                                     *outputFile);
+
+        if (copied != atomSize) {
+            qWarning() << "Unexpected end of data in atom " << atom->name();
+            operationResult = Metaman::OPERATION_GENERAL_ERROR;
+        }
     }
     else {
-        qint32 atomSize = atom->originalSize();
-        qint32 remaining = atomSize;
-        qint32 chunkSize = Metaman::DEFAULT_DATA_CHUNK_SIZE;
+        qint64 atomSize = atom->originalSize();
+        qint64 remaining = atomSize;
+        qint32 chunkSize = Metaman::DATA_COPY_BUFFER_SIZE;
 
         while (remaining > 0) {
 
             if (remaining < chunkSize) {
-                chunkSize = remaining;
+                chunkSize = (qint32)remaining;
             }
 
-            qint32 dataOffset    = atomSize - remaining;
+            qint64 dataOffset    = atomSize - remaining;
             QByteArray dataChunk = atom->dataChunk(dataOffset, chunkSize);
             qint32 bytesRead     = dataChunk.size();
+
+            if (bytesRead == 0) {
+                qWarning() << "Unexpected end of data in atom " << atom->name();
+                operationResult = Metaman::OPERATION_GENERAL_ERROR;
+                break;
+            }
+
             out.writeRawData(dataChunk, bytesRead);
             remaining -= bytesRead;
         }
@@ -167,42 +223,283 @@ Metaman::OperationResult Mpeg4AtomUtility::writeAtom(QDataStream& out, Metaman::
 
 
 
-bool Mpeg4AtomUtility::has64BitAtoms(QFile& inputFile)
+qint64 Mpeg4AtomUtility::writeSegments(const QList<QByteArray>& segments,
+                                       QIODevice* device)
 {
-    bool hasLargeAtoms = false;
+    qint64 written = 0;
 
-    if (inputFile.isOpen()) {
-        inputFile.seek(0);
-        QByteArray atomLength = inputFile.read(Metaman::ATOM_SIZE_PREAMBLE_LENGTH);
+    if (device == 0) {
+        return written;
+    }
+
+    QFile* file = qobject_cast<QFile*>(device);
+
+    if (file == 0 || file->handle() == -1) {
+        foreach (const QByteArray& segment, segments) {
+            qint64 result = device->write(segment);
+
+            if (result != segment.size()) {
+                break;
+            }
+
+            written += result;
+        }
+
+        return written;
+    }
+
+    // Anything written through Qt must reach the file before the kernel
+    // writes next to it
+    file->flush();
+    qint64 startOffset = file->pos();
+
+    if (::lseek(file->handle(), startOffset, SEEK_SET) == -1) {
+        return written;
+    }
+
+    QVector<struct iovec> vectors;
+    vectors.reserve(segments.count());
+
+    foreach (const QByteArray& segment, segments) {
+        struct iovec vector;
+        vector.iov_base = (void*)segment.constData();
+        vector.iov_len = segment.size();
+        vectors << vector;
+    }
+
+    int first = 0;
+
+    while (first < vectors.count()) {
+        int count = qMin(vectors.count() - first, IOV_MAX);
+        ssize_t result = ::writev(file->handle(), vectors.data() + first,
+                                  count);
+
+        if (result <= 0) {
+            break;
+        }
+
+        written += result;
+
+        // Skip the fully written segments and continue a partially written
+        // one where it was left
+        while (first < vectors.count() &&
+               result >= (ssize_t)vectors[first].iov_len) {
+            result -= vectors[first].iov_len;
+            ++first;
+        }
 
-        if (atomLength.toInt() == 1) {
-            hasLargeAtoms = true;
+        if (result > 0) {
+            vectors[first].iov_base = (char*)vectors[first].iov_base + result;
+            vectors[first].iov_len -= result;
         }
     }
+
+    // Keep Qt's idea of the position in sync with what was written
+    file->seek(startOffset + written);
+
+    return written;
+}
+
+
+
+qint64 Mpeg4AtomUtility::copyFileData(QFile& source,
+                                      qint64 offset,
+                                      qint64 length,
+                                      QFile& target)
+{
+    // Anything written through Qt must reach the file before the kernel
+    // copies data next to it
+    target.flush();
+    qint64 targetOffset = target.pos();
+    qint64 copied = 0;
+
+    if (&source == &target || source.fileName() == target.fileName()) {
+        if (offset == targetOffset) {
+            // Writing over the source in place, the data is already there
+            target.seek(targetOffset + length);
+            return length;
+        }
+    }
+    else if (source.handle() != -1 && target.handle() != -1) {
+        int sourceFd = source.handle();
+        int targetFd = target.handle();
+
+#ifdef HAVE_COPY_FILE_RANGE
+        loff_t sourcePos = offset;
+        loff_t targetPos = targetOffset;
+
+        while (copied < length) {
+            ssize_t result = ::copy_file_range(sourceFd, &sourcePos,
+                                               targetFd, &targetPos,
+                                               length - copied, 0);
+            if (result <= 0) {
+                break;
+            }
+
+            copied += result;
+        }
+#endif
+
+        if (copied < length &&
+            ::lseek(targetFd, targetOffset + copied, SEEK_SET) != -1) {
+            off_t sourcePos = offset + copied;
+
+            while (copied < length) {
+                ssize_t result = ::sendfile(targetFd, sourceFd, &sourcePos,
+                                            length - copied);
+                if (result <= 0) {
+                    break;
+                }
+
+                copied += result;
+            }
+        }
+    }
+
+    if (copied < length) {
+        // Kernel copy not possible. Copy the rest through one buffer, which
+        // is reused for all the chunks.
+        QByteArray buffer(qMin<qint64>(length - copied,
+                                       Metaman::DATA_COPY_BUFFER_SIZE), 0);
+
+        while (copied < length) {
+            qint64 chunkSize = qMin<qint64>(length - copied, buffer.size());
+
+            if (!source.seek(offset + copied)) {
+                break;
+            }
+
+            qint64 bytesRead = source.read(buffer.data(), chunkSize);
+
+            if (bytesRead <= 0 ||
+                !target.seek(targetOffset + copied) ||
+                target.write(buffer.constData(), bytesRead) != bytesRead) {
+                break;
+            }
+
+            copied += bytesRead;
+        }
+    }
+
+    // Keep Qt's idea of the position in sync with what was written
+    target.seek(targetOffset + copied);
+
+    qDebug() << "copied " << copied << "/" << length << " bytes";
+    return copied;
+}
+
+
+
+qint64 Mpeg4AtomUtility::readAtomSize(const QByteArray& data,
+                                      int offset,
+                                      int& headerLength)
+{
+    return readAtomSize((const uchar*)data.constData(),
+                        data.size(),
+                        offset,
+                        headerLength);
+}
+
+
+
+qint64 Mpeg4AtomUtility::readAtomSize(const uchar* data,
+                                      qint64 dataLength,
+                                      qint64 offset,
+                                      int& headerLength)
+{
+    headerLength = 0;
+
+    if (offset < 0 || offset + Metaman::ATOM_HEADER_LENGTH > dataLength) {
+        return 0;
+    }
+
+    const uchar* atomBegin = data + offset;
+    qint64 atomSize = qFromBigEndian<quint32>(atomBegin);
+
+    if (atomSize == Metaman::ATOM_SIZE_LARGE) {
+        if (offset + Metaman::ATOM_LARGE_HEADER_LENGTH > dataLength) {
+            return 0;
+        }
+
+        atomSize = (qint64)qFromBigEndian<quint64>(atomBegin +
+                                                   Metaman::ATOM_HEADER_LENGTH);
+        headerLength = Metaman::ATOM_LARGE_HEADER_LENGTH;
+    }
     else {
-        // This should never happen, but if the file cannot be read,
-        // mark this test as failed to be safe.
-        hasLargeAtoms = true;
+        headerLength = Metaman::ATOM_HEADER_LENGTH;
     }
 
-    return hasLargeAtoms;
+    return atomSize;
+}
+
+
+
+bool Mpeg4AtomUtility::scanAtoms(const uchar* data,
+                                 qint64 dataLength,
+                                 QList<AtomInfo>& atoms)
+{
+    atoms.clear();
+    qint64 index = 0;
+
+    while (index < dataLength) {
+        if (atoms.count() >= Metaman::MAX_ATOMS) {
+            qDebug() << "failsafe guard aborted the scan";
+            return false;
+        }
+
+        AtomInfo info;
+        info.location = index;
+        info.size = readAtomSize(data, dataLength, index, info.headerLength);
+
+        if (info.headerLength == 0) {
+            qDebug() << "truncated atom at " << index;
+            return false;
+        }
+
+        if (info.size == Metaman::ATOM_SIZE_TO_END) {
+            info.size = dataLength - index;
+        }
+
+        if (info.size < info.headerLength ||
+            info.size > dataLength - index) {
+            qDebug() << "invalid atom at " << index;
+            return false;
+        }
+
+        info.name = QByteArray((const char*)data + index +
+                               Metaman::ATOM_SIZE_PREAMBLE_LENGTH,
+                               Metaman::ATOM_NAME_PREAMBLE_LENGTH);
+        atoms << info;
+        index += info.size;
+    }
+
+    return true;
 }
 
 
 
 bool Mpeg4AtomUtility::readAtomInfoFromFile(QFile& inputFile,
-                                            qint32 index,
+                                            qint64 index,
                                             QByteArray& atomName,
-                                            qint32& atomSize)
+                                            qint64& atomSize)
 {
     bool success = false;
 
     if (inputFile.isOpen()) {
         inputFile.seek(index);
-        QByteArray size = inputFile.read(Metaman::ATOM_SIZE_PREAMBLE_LENGTH);
-        atomSize = size.toHex().toInt(0,16);
-        atomName = inputFile.read(Metaman::ATOM_NAME_PREAMBLE_LENGTH);
-        success = true;
+        QByteArray header = inputFile.read(Metaman::ATOM_LARGE_HEADER_LENGTH);
+        int headerLength = 0;
+        atomSize = readAtomSize(header, 0, headerLength);
+
+        if (headerLength != 0) {
+            if (atomSize == Metaman::ATOM_SIZE_TO_END) {
+                atomSize = inputFile.size() - index;
+            }
+
+            atomName = header.mid(Metaman::ATOM_SIZE_PREAMBLE_LENGTH,
+                                  Metaman::ATOM_NAME_PREAMBLE_LENGTH);
+            success = true;
+        }
     }
 
     return success;
@@ -319,10 +616,8 @@ Metaman::Atom* Mpeg4AtomUtility::createAtom(const QByteArray& name,
         parent->expand();
     }
 
-    qint32 originalSize = contents.size() +
-                          Metaman::ATOM_SIZE_PREAMBLE_LENGTH +
-                          Metaman::ATOM_NAME_PREAMBLE_LENGTH;
-    qint32 locationInFile = -1;
+    qint64 originalSize = contents.size() + Metaman::ATOM_HEADER_LENGTH;
+    qint64 locationInFile = -1;
 
     // The atom is not expandable (i.e analyzed) because we already know what's
     // in it and we don't add any unanalyzed data to it.
@@ -429,17 +724,17 @@ bool Mpeg4AtomUtility::isKnownAtom(const QByteArray& atomName)
 
 
 
-Metaman::OperationResult Mpeg4AtomUtility::adjustFreeSpace(Metaman::Atom* freeAtom, qint32 sizeDelta)
+Metaman::OperationResult Mpeg4AtomUtility::adjustFreeSpace(Metaman::Atom* freeAtom, qint64 sizeDelta)
 {
     bool result = false;
 
     if (freeAtom != 0 && freeAtom->name() == Metaman::ATOM_NAME_FREE) {
-        qint32 currentSize = freeAtom->size();
-        qint32 newSize = currentSize + sizeDelta;
+        qint64 currentSize = freeAtom->size();
+        qint64 newSize = currentSize + sizeDelta;
+        int headerLength = freeAtom->headerLength();
 
-        if (newSize > 0) {
-            QByteArray atomData = freeAtom->data();
-            atomData.fill(0, newSize);
+        if (newSize >= headerLength) {
+            QByteArray atomData(newSize - headerLength, 0);
             freeAtom->setData(atomData);
             result = true;
         }
@@ -39,6 +39,14 @@ namespace Metaman {
 }
 
 namespace Mpeg4AtomUtility {
+    /// Location and size of an atom found by scanAtoms()
+    struct AtomInfo {
+        QByteArray name;
+        qint64 location;
+        qint64 size;
+        int headerLength;
+    };
+
     /**
      * \brief Find the full path to the given atom
      * @param atom Atom for which to find the path
@@ -55,16 +63,52 @@ namespace Mpeg4AtomUtility {
      * @return True on success, false on failure
      */
     bool readAtomInfoFromFile(QFile& inputFile,
-                              qint32 index,
+                              qint64 index,
                               QByteArray& atomName,
-                              qint32& atomSize);
-    
+                              qint64& atomSize);
+
+    /**
+     * \brief Read the size of an atom from its preambles
+     * Both the normal 32 bit size and the 64 bit largesize field are
+     * understood.
+     * @param data Data containing the atom preambles
+     * @param offset Offset of the atom beginning in data
+     * @param headerLength Length of the size and name preambles (out), 0 if
+     *        data does not contain complete preambles
+     * @return Size of the atom. ATOM_SIZE_TO_END if the atom extends to the
+     *         end of the file.
+     */
+    qint64 readAtomSize(const QByteArray& data,
+                        int offset,
+                        int& headerLength);
+
+    /**
+     * \brief Read the size of an atom from its preambles in raw memory
+     * @param data Data containing the atom preambles, e.g. a file mapping
+     * @param dataLength Length of data
+     * @param offset Offset of the atom beginning in data
+     * @param headerLength Length of the size and name preambles (out), 0 if
+     *        data does not contain complete preambles
+     * @return Size of the atom. ATOM_SIZE_TO_END if the atom extends to the
+     *         end of the file.
+     */
+    qint64 readAtomSize(const uchar* data,
+                        qint64 dataLength,
+                        qint64 offset,
+                        int& headerLength);
+
     /**
-     * \brief Check if the file has large (64 bit) atoms
-     * @param inputFile The file to check
-     * @return True if the file has large atoms, false if not
+     * \brief Walk the atoms following each other in the given data
+     * Only the preambles are looked at, nothing is copied.
+     * @param data Data to be scanned, e.g. a mapping of a whole file
+     * @param dataLength Length of data
+     * @param atoms (out) Found atoms in the order they appear
+     * @return True if the atoms cover the data exactly, false if an atom is
+     *         invalid, truncated or there are more than MAX_ATOMS of them
      */
-    bool has64BitAtoms(QFile& inputFile);
+    bool scanAtoms(const uchar* data,
+                   qint64 dataLength,
+                   QList<AtomInfo>& atoms);
 
     /**
      * \brief Read atom data and allocate an atom object
@@ -75,7 +119,42 @@ namespace Mpeg4AtomUtility {
     Metaman::Atom* readAtom(QDataStream& in,
                             Metaman::Atom* atomParent);
 
+    /**
+     * \brief Write an atom to the output stream
+     * Atoms stored in memory are written with writeSegments() without
+     * collapsing them. Atoms stored in file are copied from the source file
+     * with copyFileData().
+     * @param out Output data stream
+     * @param atom Atom to be written
+     * @return Operation result
+     */
     Metaman::OperationResult writeAtom(QDataStream& out, Metaman::Atom* atom);
+
+    /**
+     * \brief Write a list of data segments to a device
+     * Files are written with vectored writes, so that the segments don't
+     * need to be concatenated first.
+     * @param segments Segments to be written in order
+     * @param device Output device. Position is moved past the written data.
+     * @return Number of bytes written
+     */
+    qint64 writeSegments(const QList<QByteArray>& segments, QIODevice* device);
+
+    /**
+     * \brief Copy a range of a file to the current position of another
+     * The data is copied by the kernel when possible, otherwise through one
+     * large buffer. Source and target may be the same file if the data
+     * moves towards the start of the file.
+     * @param source Source file
+     * @param offset Offset of the range in the source file
+     * @param length Length of the range
+     * @param target Target file. Position is moved past the copied data.
+     * @return Number of bytes copied
+     */
+    qint64 copyFileData(QFile& source,
+                        qint64 offset,
+                        qint64 length,
+                        QFile& target);
     
     /**
      * \brief Find an atom from atom tree
@@ -147,10 +226,11 @@ namespace Mpeg4AtomUtility {
     /**
      * \brief Adjust atom "free" to compensate structural changes
      * @param freeAtom A pointer to the free atom
-     * @param sizeDelta The amount of bytes to enlarge/shrink
-     * @return Operarion result
+     * @param sizeDelta The amount of bytes to enlarge/shrink the whole atom
+     * @return Operarion result. Fails if the free atom would become smaller
+     *         than its preambles.
      */
-    Metaman::OperationResult adjustFreeSpace(Metaman::Atom* freeAtom, qint32 sizeDelta);
+    Metaman::OperationResult adjustFreeSpace(Metaman::Atom* freeAtom, qint64 sizeDelta);
 
     /**
      * \brief Drop last atom from given atom path
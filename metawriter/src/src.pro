@@ -3,6 +3,7 @@ SOURCES += main.cpp \
            metaapplication.cpp \
            atom.cpp \
            mp4backend.cpp \
+           imagebackend.cpp \
            xmphandler.cpp \
            mpeg4atomutility.cpp
 TEMPLATE = app
@@ -16,6 +17,7 @@ HEADERS += backendinterface.h \
            metamandatatypes.h \
            atom.h \
            mp4backend.h \
+           imagebackend.h \
            xmphandler.h \
            mpeg4atomutility.h
 
@@ -31,36 +31,113 @@
 #include <exempi/xmpconsts.h>
 #include <QByteArray>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
 #include "magic.h"
 
 using namespace Metaman;
 
+namespace {
+    /// Guards the toolkit reference count
+    QMutex toolkitMutex;
+
+    /// Number of references to the XMP toolkit
+    int toolkitReferences = 0;
+
+    /// Result of the toolkit initialization
+    bool toolkitInitialized = false;
+}
+
 XmpHandler::XmpHandler() :
-    m_xmpPacket(0)
+    m_xmpPacket(0),
+    m_parsed(false),
+    m_modified(false)
 {
     qDebug() << "initing xmp";
-    m_initDone = xmp_init();
+    m_initDone = acquireToolkit();
     qDebug() << "init done";
 }
 
 
 XmpHandler::~XmpHandler()
 {
-    xmp_terminate();
+    if (m_xmpPacket != 0) {
+        xmp_free(m_xmpPacket);
+        m_xmpPacket = 0;
+    }
+
+    releaseToolkit();
     m_initDone = false;
 }
 
 
 
-QByteArray XmpHandler::getProcessedData()
+bool XmpHandler::acquireToolkit()
+{
+    QMutexLocker locker(&toolkitMutex);
+
+    if (toolkitReferences == 0) {
+        toolkitInitialized = xmp_init();
+    }
+
+    ++toolkitReferences;
+    return toolkitInitialized;
+}
+
+
+
+void XmpHandler::releaseToolkit()
+{
+    QMutexLocker locker(&toolkitMutex);
+
+    if (toolkitReferences > 0 && --toolkitReferences == 0) {
+        xmp_terminate();
+        toolkitInitialized = false;
+    }
+}
+
+
+
+QByteArray XmpHandler::getProcessedData(int packetSize)
 {
     qDebug() << "getProcessedData()";
-    XmpStringPtr buffer = xmp_string_new();
-    uint32_t options = XMP_SERIAL_ENCODEUTF8 | XMP_SERIAL_READONLYPACKET;
-    uint32_t padding = 0;
-    bool resultOk = xmp_serialize(m_xmpPacket, buffer, options, padding);
+
+    if (!m_modified) {
+        // Nothing to change, no need for a parse and serialize round trip
+        return m_originalData;
+    }
+
     QByteArray xmlData;
 
+    if (m_xmpPacket == 0) {
+        qDebug() << "no packet to serialize";
+        return xmlData;
+    }
+
+    XmpStringPtr buffer = xmp_string_new();
+    uint32_t options = XMP_SERIAL_ENCODEUTF8;
+    bool resultOk = false;
+
+    if (packetSize > 0) {
+        // Writable packet padded to the size of the existing one
+        resultOk = xmp_serialize(m_xmpPacket,
+                                 buffer,
+                                 options | XMP_SERIAL_EXACTPACKETLENGTH,
+                                 packetSize);
+
+        if (!resultOk) {
+            qDebug() << "edits don't fit in " << packetSize << " bytes";
+        }
+    }
+
+    if (!resultOk) {
+        // Leave room for later edits
+        resultOk = xmp_serialize(m_xmpPacket,
+                                 buffer,
+                                 options,
+                                 XMP_DEFAULT_PADDING);
+    }
+
     if (resultOk) {
         qDebug() << "getting buffer " << buffer;
         const char* stringbuffer = xmp_string_cstr(buffer);
@@ -74,94 +151,200 @@ QByteArray XmpHandler::getProcessedData()
     buffer = 0;
     xmp_free(m_xmpPacket);
     m_xmpPacket = 0;
+    m_parsed = false;
 
     return xmlData;
 }
 
 
 
-OperationResult XmpHandler::removeDescription()
+bool XmpHandler::isModified() const
 {
-    const char* nameSpace = NS_DC;
-    return deleteProperty(nameSpace, XMP_PROPERTY_DESCRIPTION);
+    return (m_modified || !m_pendingEdits.isEmpty());
 }
 
 
 
-OperationResult XmpHandler::removeTitle()
+OperationResult XmpHandler::commitEdits()
 {
-    const char* nameSpace = NS_DC;
-    return  deleteProperty(nameSpace, XMP_PROPERTY_TITLE);
+    if (m_pendingEdits.isEmpty()) {
+        return OPERATION_OK;
+    }
+
+    OperationResult operationResult = applyEdits(m_pendingEdits);
+    m_pendingEdits.clear();
+    return operationResult;
 }
 
 
 
-OperationResult XmpHandler::setDescription(const QByteArray& description)
+OperationResult XmpHandler::queueEdits(const QList<PropertyEdit>& edits)
 {
-    qDebug() << "setting description " << description;
+    m_pendingEdits << edits;
+    return OPERATION_OK;
+}
+
+
+
+OperationResult XmpHandler::applyEdits(const QList<PropertyEdit>& edits)
+{
+    OperationResult operationResult = ensurePacket();
+
+    if (operationResult != OPERATION_OK) {
+        return operationResult;
+    }
+
+    for (int i = 0; i < edits.count(); ++i) {
+        const PropertyEdit& edit = edits.at(i);
+        bool overridden = false;
 
-    const char* nameSpace        = NS_DC;
-    QByteArray noGenericLanguage = XMP_LANGUAGE_NONE;
-    QByteArray specificLanguage  = XMP_LANGUAGE_DEFAULT;
+        // A later edit of the same property makes this one pointless
+        for (int j = i + 1; j < edits.count() && !overridden; ++j) {
+            overridden = (qstrcmp(edits.at(j).nameSpace, edit.nameSpace) == 0 &&
+                          edits.at(j).propertyName == edit.propertyName);
+        }
+
+        if (overridden) {
+            continue;
+        }
+
+        OperationResult result = OPERATION_OK;
+
+        switch (edit.type) {
+            case PROPERTY_SET:
+                result = setProperty(edit.nameSpace,
+                                     edit.propertyName,
+                                     edit.value);
+                break;
 
-    // Get rid of the old property first. This will effectively make sure there
-    // are no conflicting language variants.
-    deleteProperty(nameSpace, XMP_PROPERTY_DESCRIPTION);
+            case PROPERTY_SET_LOCALIZED:
+                // Get rid of the old property first. This will effectively
+                // make sure there are no conflicting language variants.
+                deleteProperty(edit.nameSpace, edit.propertyName);
+                result = setLocalizedProperty(edit.nameSpace,
+                                              edit.propertyName,
+                                              edit.value,
+                                              XMP_LANGUAGE_NONE,
+                                              XMP_LANGUAGE_DEFAULT);
+                break;
+
+            case PROPERTY_SET_ARRAY:
+                result = setArrayProperty(edit.nameSpace,
+                                          edit.propertyName,
+                                          edit.items);
+                break;
+
+            case PROPERTY_DELETE:
+                result = deleteProperty(edit.nameSpace, edit.propertyName);
+                break;
+        }
 
-    OperationResult operationResult =
-            setLocalizedProperty(nameSpace,
-                                 XMP_PROPERTY_DESCRIPTION,
-                                 description,
-                                 noGenericLanguage,
-                                 specificLanguage);
+        if (result != OPERATION_OK) {
+            operationResult = result;
+        }
+    }
 
+    m_modified = true;
     return operationResult;
 }
 
 
 
-OperationResult XmpHandler::setTitle(const QByteArray& title)
+OperationResult XmpHandler::ensurePacket()
 {
-    qDebug() << "setting title " << title;
+    if (m_parsed && m_xmpPacket != 0) {
+        return OPERATION_OK;
+    }
 
-    const char* nameSpace = NS_DC;
+    if (m_xmpPacket == 0) {
+        m_xmpPacket = xmp_new_empty();
+    }
+
+    if (m_xmpPacket == 0) {
+        return OPERATION_GENERAL_ERROR;
+    }
 
-    // Get rid of the old property first. This will effectively make sure there
-    // are no conflicting language variants.
-    deleteProperty(nameSpace, XMP_PROPERTY_TITLE);
+    m_parsed = true;
+    OperationResult operationResult = OPERATION_OK;
 
-    QByteArray noGenericLanguage = XMP_LANGUAGE_NONE;
-    QByteArray specificLanguage = XMP_LANGUAGE_DEFAULT;
-    OperationResult operationResult = setLocalizedProperty(nameSpace,
-                                                           XMP_PROPERTY_TITLE,
-                                                           title,
-                                                           noGenericLanguage,
-                                                           specificLanguage);
+    if (!m_originalData.isEmpty()) {
+        bool parsingOk = xmp_parse(m_xmpPacket,
+                                   m_originalData.constData(),
+                                   m_originalData.size());
+
+        if (!parsingOk) {
+            qDebug() << "xmp error: " << xmp_get_error();
+            operationResult = OPERATION_GENERAL_ERROR;
+        }
+    }
 
     return operationResult;
 }
 
 
 
-OperationResult XmpHandler::setAuthor(const QByteArray& author)
+XmpHandler::PropertyEdit XmpHandler::propertyEdit(PropertyEditType type,
+                                                  const char* nameSpace,
+                                                  const QByteArray& propertyName,
+                                                  const QByteArray& value)
 {
-    qDebug() << "setting author " << author;
+    PropertyEdit edit;
+    edit.type = type;
+    edit.nameSpace = nameSpace;
+    edit.propertyName = propertyName;
+    edit.value = value;
+    return edit;
+}
 
+
+
+OperationResult XmpHandler::removeDescription()
+{
     const char* nameSpace = NS_DC;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_DELETE, nameSpace, XMP_PROPERTY_DESCRIPTION));
+}
 
-    // Get rid of the old property first. This will effectively make sure there
-    // are no conflicting language variants.
-    deleteProperty(nameSpace, XMP_PROPERTY_AUTHOR);
 
-    QByteArray noGenericLanguage = XMP_LANGUAGE_NONE;
-    QByteArray specificLanguage = XMP_LANGUAGE_DEFAULT;
-    OperationResult operationResult = setLocalizedProperty(nameSpace,
-                                                           XMP_PROPERTY_AUTHOR,
-                                                           author,
-                                                           noGenericLanguage,
-                                                           specificLanguage);
 
-    return operationResult;
+OperationResult XmpHandler::removeTitle()
+{
+    const char* nameSpace = NS_DC;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_DELETE, nameSpace, XMP_PROPERTY_TITLE));
+}
+
+
+
+OperationResult XmpHandler::setDescription(const QByteArray& description)
+{
+    qDebug() << "setting description " << description;
+
+    const char* nameSpace = NS_DC;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_SET_LOCALIZED, nameSpace, XMP_PROPERTY_DESCRIPTION, description));
+}
+
+
+
+OperationResult XmpHandler::setTitle(const QByteArray& title)
+{
+    qDebug() << "setting title " << title;
+
+    const char* nameSpace = NS_DC;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_SET_LOCALIZED, nameSpace, XMP_PROPERTY_TITLE, title));
+}
+
+
+
+OperationResult XmpHandler::setAuthor(const QByteArray& author)
+{
+    qDebug() << "setting author " << author;
+
+    const char* nameSpace = NS_DC;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_SET_LOCALIZED, nameSpace, XMP_PROPERTY_AUTHOR, author));
 }
 
 
@@ -175,32 +358,15 @@ OperationResult XmpHandler::setGpsString(const QByteArray& GPSLatitude,
 
     const char* nameSpace = NS_EXIF;
 
-    OperationResult operationResult = OPERATION_OK;
-    OperationResult latitudeResult = setProperty(nameSpace,
-                                                 XMP_PROPERTY_GPS_LATITUDE,
-                                                 GPSLatitude);
-    OperationResult longitudeResult = setProperty(nameSpace,
-                                                  XMP_PROPERTY_GPS_LONGITUDE,
-                                                  GPSLongitude);
-
-    OperationResult altitudeResult = setProperty(nameSpace,
-                                                 XMP_PROPERTY_GPS_ALTITUDE,
-                                                 GPSAltitude);
-
-    OperationResult altitudeRefResult = setProperty(nameSpace,
-                                                    XMP_PROPERTY_GPS_ALTITUDE_REF,
-                                                    GPSAltitudeRef);
-
-    if (latitudeResult != OPERATION_OK ||
-        longitudeResult != OPERATION_OK ||
-        altitudeRefResult != OPERATION_OK ||
-        altitudeResult != OPERATION_OK) {
-
-        operationResult = OPERATION_GENERAL_ERROR;
-    }
-    
-
-    return operationResult;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_SET, nameSpace,
+                        XMP_PROPERTY_GPS_LATITUDE, GPSLatitude)
+        << propertyEdit(PROPERTY_SET, nameSpace,
+                        XMP_PROPERTY_GPS_LONGITUDE, GPSLongitude)
+        << propertyEdit(PROPERTY_SET, nameSpace,
+                        XMP_PROPERTY_GPS_ALTITUDE, GPSAltitude)
+        << propertyEdit(PROPERTY_SET, nameSpace,
+                        XMP_PROPERTY_GPS_ALTITUDE_REF, GPSAltitudeRef));
 }
 
 
@@ -209,20 +375,18 @@ OperationResult XmpHandler::setXmpDataToBeProcessed(const QByteArray& xmpData)
 {
     qDebug() << "setting data to process";
 
-    OperationResult operationResult = OPERATION_OK;
-    m_xmpPacket = xmp_new_empty();
+    // Parsing is left for the first edit, it may never come
+    if (m_xmpPacket != 0) {
+        xmp_free(m_xmpPacket);
+        m_xmpPacket = 0;
+    }
 
-    if (!xmpData.isEmpty()) {
-        const char* buffer = xmpData.data();
-        size_t bufferLength = xmpData.size();
-        bool parsingOk = xmp_parse(m_xmpPacket, buffer, bufferLength);
+    m_originalData = xmpData;
+    m_pendingEdits.clear();
+    m_parsed = false;
+    m_modified = false;
 
-        if (!parsingOk) {
-            operationResult = OPERATION_GENERAL_ERROR;
-        }
-    }
-    
-    return operationResult;
+    return OPERATION_OK;
 }
 
 
@@ -369,7 +533,8 @@ OperationResult XmpHandler::registerNamespace(const char* nameSpaceURI,
 OperationResult XmpHandler::removeAuthor()
 {
     const char* nameSpace = NS_DC;
-    return deleteProperty(nameSpace, XMP_PROPERTY_AUTHOR);
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_DELETE, nameSpace, XMP_PROPERTY_AUTHOR));
 }
 
 
@@ -377,23 +542,13 @@ OperationResult XmpHandler::removeAuthor()
 OperationResult XmpHandler::removeLocationInfo()
 {
     const char* nameSpace = NS_PHOTOSHOP;
-    OperationResult resultDeleteCountry =
-            deleteProperty(nameSpace, XMP_PROPERTY_GEOTAG_COUNTRY);
-    OperationResult resultDeleteCity =
-            deleteProperty(nameSpace, XMP_PROPERTY_GEOTAG_CITY);
-    OperationResult resultDeleteDistrict =
-            deleteProperty(nameSpace, XMP_PROPERTY_GEOTAG_DISTRICT);
-
-    OperationResult operationResult = OPERATION_OK;
-
-    if (resultDeleteCountry  != OPERATION_OK ||
-        resultDeleteCity     != OPERATION_OK ||
-        resultDeleteDistrict != OPERATION_OK) {
-
-        operationResult = OPERATION_GENERAL_ERROR;
-    }
-
-    return operationResult;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_DELETE, nameSpace,
+                        XMP_PROPERTY_GEOTAG_COUNTRY)
+        << propertyEdit(PROPERTY_DELETE, nameSpace,
+                        XMP_PROPERTY_GEOTAG_CITY)
+        << propertyEdit(PROPERTY_DELETE, nameSpace,
+                        XMP_PROPERTY_GEOTAG_DISTRICT));
 }
 
 
@@ -401,34 +556,30 @@ OperationResult XmpHandler::removeLocationInfo()
 OperationResult Metaman::XmpHandler::removeGpsString()
 {
     const char* nameSpace = NS_EXIF;
-    OperationResult latitudeResult =
-            deleteProperty(nameSpace, XMP_PROPERTY_GPS_LATITUDE);
-    OperationResult longitudeResult =
-            deleteProperty(nameSpace, XMP_PROPERTY_GPS_LONGITUDE);
-    OperationResult altitudeResult =
-            deleteProperty(nameSpace, XMP_PROPERTY_GPS_ALTITUDE);
-    OperationResult altitudeRefResult =
-            deleteProperty(nameSpace, XMP_PROPERTY_GPS_ALTITUDE_REF);
-
-    OperationResult operationResult = OPERATION_OK;
-
-    if (latitudeResult != OPERATION_OK ||
-        longitudeResult != OPERATION_OK ||
-        altitudeRefResult != OPERATION_OK ||
-        altitudeResult != OPERATION_OK) {
-
-        operationResult = OPERATION_GENERAL_ERROR;
-    }
-
-    return operationResult;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_DELETE, nameSpace,
+                        XMP_PROPERTY_GPS_LATITUDE)
+        << propertyEdit(PROPERTY_DELETE, nameSpace,
+                        XMP_PROPERTY_GPS_LONGITUDE)
+        << propertyEdit(PROPERTY_DELETE, nameSpace,
+                        XMP_PROPERTY_GPS_ALTITUDE)
+        << propertyEdit(PROPERTY_DELETE, nameSpace,
+                        XMP_PROPERTY_GPS_ALTITUDE_REF));
 }
 
 
 
 OperationResult Metaman::XmpHandler::removeAllXmpData()
 {
-    xmp_free(m_xmpPacket);
+    if (m_xmpPacket != 0) {
+        xmp_free(m_xmpPacket);
+    }
+
+    // Nothing of the original data or earlier edits is needed anymore
+    m_pendingEdits.clear();
     m_xmpPacket = xmp_new_empty();
+    m_parsed = true;
+    m_modified = true;
 
     OperationResult operationResult = OPERATION_OK;
 
@@ -444,27 +595,40 @@ OperationResult Metaman::XmpHandler::removeAllXmpData()
 OperationResult Metaman::XmpHandler::setKeywords(const QList<QByteArray>& keywords)
 {
     qDebug() << "setKeywords()";
-    
+
+    PropertyEdit edit = propertyEdit(PROPERTY_SET_ARRAY,
+                                     NS_DC,
+                                     XMP_PROPERTY_KEYWORDS);
+    edit.items = keywords;
+
+    return queueEdits(QList<PropertyEdit>() << edit);
+}
+
+
+
+OperationResult XmpHandler::setArrayProperty(const char* nameSpace,
+                                             const QByteArray& propertyName,
+                                             const QList<QByteArray>& items)
+{
     OperationResult operationResult = OPERATION_OK;
 
     if (m_xmpPacket != 0) {
-        const char* nameSpace = NS_DC;
         uint32_t propertyOptions = XMP_PROP_VALUE_IS_ARRAY;
         uint32_t itemOptions = 0;
         const char* noValue = "";
         
         bool resultOk = xmp_set_property(m_xmpPacket,
                                         nameSpace,
-                                        XMP_PROPERTY_KEYWORDS,
+                                        propertyName.constData(),
                                         noValue,
                                         propertyOptions);
 
-        foreach (QByteArray keyword, keywords) {
+        foreach (QByteArray item, items) {
             resultOk = xmp_append_array_item(m_xmpPacket,
                                              nameSpace,
-                                             XMP_PROPERTY_KEYWORDS,
+                                             propertyName.constData(),
                                              propertyOptions,
-                                             keyword.constData(),
+                                             item.constData(),
                                              itemOptions);
 
             if (!resultOk) {
@@ -503,20 +667,11 @@ OperationResult XmpHandler::setGeotag(const QByteArray& geotag)
     }
 
     const char* nameSpace = NS_DC;
-    OperationResult setCountryResult = 
-        setProperty(nameSpace, XMP_PROPERTY_GEOTAG_COUNTRY, geotagCountry);
-    OperationResult setCityResult = 
-        setProperty(nameSpace, XMP_PROPERTY_GEOTAG_CITY, geotagCity);
-    OperationResult setDistrictResult = 
-        setProperty(nameSpace, XMP_PROPERTY_GEOTAG_DISTRICT, geotagDistrict);
-    OperationResult operationResult = OPERATION_OK;
-
-    if (setCountryResult  != OPERATION_OK ||
-        setCityResult     != OPERATION_OK ||
-        setDistrictResult != OPERATION_OK){
-    
-        operationResult = OPERATION_GENERAL_ERROR;
-    }
-
-    return operationResult;
+    return queueEdits(QList<PropertyEdit>()
+        << propertyEdit(PROPERTY_SET, nameSpace,
+                        XMP_PROPERTY_GEOTAG_COUNTRY, geotagCountry)
+        << propertyEdit(PROPERTY_SET, nameSpace,
+                        XMP_PROPERTY_GEOTAG_CITY, geotagCity)
+        << propertyEdit(PROPERTY_SET, nameSpace,
+                        XMP_PROPERTY_GEOTAG_DISTRICT, geotagDistrict));
 }
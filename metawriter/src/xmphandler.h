@@ -32,6 +32,7 @@
 #include <exempi/xmp.h>
 #include "metamandatatypes.h"
 #include <QByteArray>
+#include <QList>
 
 namespace Metaman {
     
@@ -43,6 +44,23 @@ namespace Metaman {
 class XmpHandler
 {
 public:
+    /// Kinds of property edits
+    enum PropertyEditType {
+        PROPERTY_SET,           ///< Set a simple value, empty value deletes
+        PROPERTY_SET_LOCALIZED, ///< Replace with a default language value
+        PROPERTY_SET_ARRAY,     ///< Replace with an unordered array of items
+        PROPERTY_DELETE         ///< Delete the property
+    };
+
+    /// One change to the XMP packet, see applyEdits()
+    struct PropertyEdit {
+        PropertyEditType type;
+        const char* nameSpace;
+        QByteArray propertyName;
+        QByteArray value;
+        QList<QByteArray> items;
+    };
+
     /**
      * \brief Constructor
      */
@@ -52,12 +70,57 @@ public:
      * \brief Destructor
      */
     ~XmpHandler();
+
+    /**
+     * \brief Initialize the XMP toolkit
+     * The toolkit is initialized only by the first call. Handlers created
+     * while a reference is held don't initialize it again, so processing
+     * many files in one process pays the initialization only once.
+     * @return True if the toolkit is initialized
+     */
+    static bool acquireToolkit();
+
+    /**
+     * \brief Release a reference taken with acquireToolkit()
+     * The toolkit is terminated when the last reference is released.
+     */
+    static void releaseToolkit();
     
     /**
      * \brief Get processed XMP data
+     * If nothing was edited, the data given to setXmpDataToBeProcessed() is
+     * returned as it is, without parsing and serializing it.
+     * @param packetSize Size of the existing packet, 0 if none. The packet
+     *        is padded to exactly this size if the edits fit in it, so that
+     *        the atom holding it keeps its size. Otherwise default padding
+     *        is left for later edits.
      * @return Processed XMP data
      */
-    QByteArray getProcessedData();
+    QByteArray getProcessedData(int packetSize = 0);
+
+    /**
+     * \brief Tells if any edits have been made
+     * @return True if the packet needs to be written again
+     */
+    bool isModified() const;
+
+    /**
+     * \brief Apply the edits queued by the setters and removers
+     * The setters and removers only queue their edits, so that all edits
+     * of one run are applied with a single applyEdits() call. Must be
+     * called before getProcessedData().
+     * @return Operation result
+     */
+    OperationResult commitEdits();
+
+    /**
+     * \brief Apply a set of edits to the XMP packet at once
+     * The packet is parsed on the first edit. Edits of a property that a
+     * later edit in the same batch overrides are skipped.
+     * @param edits Edits in the order they are applied
+     * @return Operation result
+     */
+    OperationResult applyEdits(const QList<PropertyEdit>& edits);
     
     /**
      * \brief Remove description from XMP data
@@ -144,7 +207,33 @@ public:
     OperationResult setGeotag(const QByteArray& geotag);
 
 private:
-    
+
+    /**
+     * \brief Parse the original data, if not done yet
+     * @return Operation result
+     */
+    OperationResult ensurePacket();
+
+    /**
+     * \brief Queue edits to be applied by commitEdits()
+     * @param edits Edits in the order they are applied
+     * @return Operation result
+     */
+    OperationResult queueEdits(const QList<PropertyEdit>& edits);
+
+    /**
+     * \brief Create a property edit
+     * @param type Edit type
+     * @param nameSpace Schema namespace
+     * @param propertyName Property name
+     * @param value Property value
+     * @return The edit
+     */
+    static PropertyEdit propertyEdit(PropertyEditType type,
+                                     const char* nameSpace,
+                                     const QByteArray& propertyName,
+                                     const QByteArray& value = QByteArray());
+
     /**
      * \brief Create or modify specified XMP property
      * @param nameSpace Schema namespace
@@ -179,6 +268,17 @@ private:
      */
     OperationResult deleteProperty(const char* nameSpace,
                                    const QByteArray& propertyName);
+
+    /**
+     * \brief Replace XMP array property with given items
+     * @param nameSpace Schema namespace
+     * @param propertyName Property name
+     * @param items Array items
+     * @return Operation result
+     */
+    OperationResult setArrayProperty(const char* nameSpace,
+                                     const QByteArray& propertyName,
+                                     const QList<QByteArray>& items);
     
     /**
      * \brief Register XMP namespace
@@ -196,6 +296,18 @@ private:
     /// XMP packet
     XmpPtr m_xmpPacket;
 
+    /// Data the packet is parsed from
+    QByteArray m_originalData;
+
+    /// Tells if m_originalData has been parsed to m_xmpPacket
+    bool m_parsed;
+
+    /// Tells if the packet has been edited
+    bool m_modified;
+
+    /// Edits waiting for commitEdits()
+    QList<PropertyEdit> m_pendingEdits;
+
 };
 
 };
@@ -0,0 +1,295 @@
+ 
+/*
+ * This file is part of Web Upload Engine for MeeGo social networking uploads
+ *
+ * Copyright (C) 2010-2011 Nokia Corporation and/or its subsidiary(-ies). All rights reserved.
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense,     
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER  
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS  
+
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QtEndian>
+
+#include "metawritertests.h"
+#include "metaapplication.h"
+#include "metamandatatypes.h"
+
+using namespace Metaman;
+
+namespace {
+    const QByteArray MEDIA_DATA = "media data";
+
+    QByteArray bigEndian32(quint32 value)
+    {
+        uchar raw[4];
+        qToBigEndian(value, raw);
+        return QByteArray((const char*)raw, sizeof(raw));
+    }
+
+    QByteArray atom(const QByteArray& name, const QByteArray& payload)
+    {
+        return bigEndian32(8 + payload.size()) + name + payload;
+    }
+
+    /*
+     * Movie with a single track whose only chunk is in the mdat that
+     * follows moov. Extra sample table atoms are added after stco and
+     * trailing atoms after mdat.
+     */
+    QByteArray movieFile(const QByteArray& sampleTableExtra = QByteArray(),
+                         const QByteArray& trailer = QByteArray(),
+                         const QByteArray& brand = "isom")
+    {
+        QByteArray ftyp = atom("ftyp", brand + bigEndian32(0) + brand);
+        QByteArray moov;
+        quint32 dataOffset = 0;
+
+        // Chunk offset does not change the size of moov, so the second
+        // round gets the right offset
+        for (int round = 0; round < 2; ++round) {
+            QByteArray stco = atom("stco", bigEndian32(0) + bigEndian32(1) +
+                                           bigEndian32(dataOffset));
+            QByteArray stbl = atom("stbl", stco + sampleTableExtra);
+            QByteArray trak = atom("trak",
+                                   atom("mdia", atom("minf", stbl)));
+            moov = atom("moov", atom("mvhd", QByteArray(100, '\0')) + trak);
+            dataOffset = ftyp.size() + moov.size() + 8;
+        }
+
+        return ftyp + moov + atom("mdat", MEDIA_DATA) + trailer;
+    }
+
+    QByteArray jpegSegment(uchar marker, const QByteArray& payload)
+    {
+        uchar length[2];
+        qToBigEndian((quint16)(payload.size() + 2), length);
+        return QByteArray("\xFF", 1) + (char)marker +
+               QByteArray((const char*)length, sizeof(length)) + payload;
+    }
+
+    const QByteArray JPEG_START("\xFF\xD8", 2);
+    const QByteArray JPEG_END("\xFF\xD9", 2);
+
+    QByteArray jpegFile()
+    {
+        return JPEG_START +
+               jpegSegment(0xE1, QByteArray("Exif\0\0", 6) + "II*") +
+               jpegSegment(0xFE, "comment") +
+               JPEG_END;
+    }
+
+    // 1x1 GIF header without a color table
+    const QByteArray GIF_HEADER("GIF89a\x01\0\x01\0\0\0\0", 13);
+    const QByteArray GIF_COMMENT("\x21\xFE\x07" "comment" "\0", 11);
+    const QByteArray GIF_XMP("\x21\xFF\x0B" "XMP DataXMP" "\x03" "xmp" "\0",
+                             19);
+    const QByteArray GIF_TRAILER("\x3B", 1);
+}
+
+
+
+void MetaWriterTests::init()
+{
+    m_inputPath = QDir::tempPath() + "/metawriter-tests-in.mp4";
+    m_outputPath = QDir::tempPath() + "/metawriter-tests-out.mp4";
+}
+
+
+
+void MetaWriterTests::cleanup()
+{
+    QFile::remove(m_inputPath);
+    QFile::remove(m_outputPath);
+}
+
+
+
+bool MetaWriterTests::writeInput(const QByteArray& data)
+{
+    QFile file(m_inputPath);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    return (file.write(data) == data.size());
+}
+
+
+
+bool MetaWriterTests::ableToProcessInput()
+{
+    MetaApplication metaApp;
+    metaApp.setInputFile(m_inputPath);
+    metaApp.setOutputFile(m_outputPath);
+    return metaApp.ableToProcess();
+}
+
+
+
+void MetaWriterTests::mp4RelocateChunkOffsets()
+{
+    QVERIFY(writeInput(movieFile()));
+
+    MetaApplication metaApp;
+    metaApp.setInputFile(m_inputPath);
+    metaApp.setOutputFile(m_outputPath);
+    QVERIFY(metaApp.ableToProcess());
+    QCOMPARE(metaApp.readFile(), OPERATION_OK);
+
+    // Growing moov moves the media data after it
+    QCOMPARE(metaApp.setTitle(QByteArray(300, 't')), OPERATION_OK);
+    QCOMPARE(metaApp.writeFile(), OPERATION_OK);
+
+    QFile output(m_outputPath);
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QByteArray written = output.readAll();
+
+    int stco = written.indexOf("stco");
+    QVERIFY(stco > 0);
+    QVERIFY(written.size() >= stco + 16);
+
+    quint32 dataOffset = qFromBigEndian<quint32>(
+        (const uchar*)written.constData() + stco + 12);
+    QVERIFY(dataOffset > (quint32)movieFile().indexOf(MEDIA_DATA));
+    QCOMPARE(written.mid(dataOffset, MEDIA_DATA.size()), MEDIA_DATA);
+}
+
+
+
+void MetaWriterTests::mp4QuickTime()
+{
+    const QByteArray quickTime = movieFile(QByteArray(), QByteArray(), "qt  ");
+    QVERIFY(writeInput(quickTime));
+
+    MetaApplication metaApp;
+    metaApp.setInputFile(m_inputPath);
+    metaApp.setOutputFile(m_outputPath);
+    QVERIFY(metaApp.ableToProcess());
+    QCOMPARE(metaApp.readFile(), OPERATION_OK);
+    QCOMPARE(metaApp.setTitle(QByteArray(300, 't')), OPERATION_OK);
+    QCOMPARE(metaApp.writeFile(), OPERATION_OK);
+
+    QFile output(m_outputPath);
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QByteArray written = output.readAll();
+    QVERIFY(written.startsWith(quickTime.left(16)));
+
+    int stco = written.indexOf("stco");
+    QVERIFY(stco > 0);
+    quint32 dataOffset = qFromBigEndian<quint32>(
+        (const uchar*)written.constData() + stco + 12);
+    QCOMPARE(written.mid(dataOffset, MEDIA_DATA.size()), MEDIA_DATA);
+}
+
+
+
+void MetaWriterTests::mp4RejectFragmented()
+{
+    QByteArray fragment = atom("moof",
+                               atom("mfhd", QByteArray(8, '\0')) +
+                               atom("traf", atom("tfhd",
+                                                 QByteArray(16, '\0'))));
+    QByteArray randomAccess = atom("mfra",
+                                   atom("mfro", QByteArray(8, '\0')));
+
+    QVERIFY(writeInput(movieFile()));
+    QVERIFY(ableToProcessInput());
+
+    QVERIFY(writeInput(movieFile(QByteArray(), fragment)));
+    QVERIFY(!ableToProcessInput());
+
+    QVERIFY(writeInput(movieFile(QByteArray(), randomAccess)));
+    QVERIFY(!ableToProcessInput());
+}
+
+
+
+void MetaWriterTests::mp4RejectAuxiliaryOffsets()
+{
+    QByteArray saio = atom("saio", bigEndian32(0) + bigEndian32(1) +
+                                   bigEndian32(0));
+    QVERIFY(writeInput(movieFile(saio)));
+
+    MetaApplication metaApp;
+    metaApp.setInputFile(m_inputPath);
+    metaApp.setOutputFile(m_outputPath);
+    QVERIFY(metaApp.ableToProcess());
+    QCOMPARE(metaApp.readFile(), OPERATION_OK);
+
+    // Media data would move, but saio would keep pointing to the old place
+    QCOMPARE(metaApp.setTitle(QByteArray(300, 't')), OPERATION_OK);
+    QCOMPARE(metaApp.writeFile(), OPERATION_GENERAL_ERROR);
+}
+
+
+
+void MetaWriterTests::imageEraseAllJpeg()
+{
+    QVERIFY(writeInput(jpegFile()));
+
+    MetaApplication metaApp;
+    metaApp.setInputFile(m_inputPath);
+    metaApp.setOutputFile(m_outputPath);
+    QVERIFY(metaApp.ableToProcess());
+    QCOMPARE(metaApp.readFile(), OPERATION_OK);
+    QCOMPARE(metaApp.eraseMetaData(), OPERATION_OK);
+    QCOMPARE(metaApp.writeFile(), OPERATION_OK);
+
+    QFile output(m_outputPath);
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QCOMPARE(output.readAll(), JPEG_START + JPEG_END);
+}
+
+
+
+void MetaWriterTests::imageKeepJpegExif()
+{
+    QVERIFY(writeInput(jpegFile()));
+
+    MetaApplication metaApp;
+    metaApp.setInputFile(m_inputPath);
+    metaApp.setOutputFile(m_outputPath);
+    QVERIFY(metaApp.ableToProcess());
+    QCOMPARE(metaApp.readFile(), OPERATION_OK);
+    QCOMPARE(metaApp.eraseAuthorAndGps(), OPERATION_GENERAL_ERROR);
+}
+
+
+
+void MetaWriterTests::imageEraseAuthorGif()
+{
+    QVERIFY(writeInput(GIF_HEADER + GIF_COMMENT + GIF_XMP + GIF_TRAILER));
+
+    MetaApplication metaApp;
+    metaApp.setInputFile(m_inputPath);
+    metaApp.setOutputFile(m_outputPath);
+    QVERIFY(metaApp.ableToProcess());
+    QCOMPARE(metaApp.readFile(), OPERATION_OK);
+    QCOMPARE(metaApp.eraseAuthorAndGps(), OPERATION_OK);
+    QCOMPARE(metaApp.writeFile(), OPERATION_OK);
+
+    QFile output(m_outputPath);
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QCOMPARE(output.readAll(), GIF_HEADER + GIF_COMMENT + GIF_TRAILER);
+}
+
+
+
+QTEST_MAIN(MetaWriterTests)
@@ -0,0 +1,77 @@
+ 
+/*
+ * This file is part of Web Upload Engine for MeeGo social networking uploads
+ *
+ * Copyright (C) 2010-2011 Nokia Corporation and/or its subsidiary(-ies). All rights reserved.
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense,     
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER  
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS  
+
+#ifndef METAWRITER_TESTS_H
+#define METAWRITER_TESTS_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+
+class MetaWriterTests : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    // Media data moves and chunk offsets follow it
+    void mp4RelocateChunkOffsets();
+
+    // QuickTime movies share the layout and are rewritten the same way
+    void mp4QuickTime();
+
+    // Fragmented files are not accepted
+    void mp4RejectFragmented();
+
+    // Offsets that cannot be relocated make the rewrite fail
+    void mp4RejectAuxiliaryOffsets();
+
+    // All metadata segments are left out of a JPEG
+    void imageEraseAllJpeg();
+
+    // Author and location are not removed by dropping Exif
+    void imageKeepJpegExif();
+
+    // Author and location are removed from a GIF, comments stay
+    void imageEraseAuthorGif();
+
+private:
+    /*!
+      \brief Write data to the test input file
+      \param data File contents
+      \return True on success
+     */
+    bool writeInput(const QByteArray& data);
+
+    /*!
+      \brief Check if a backend accepts the test input file
+      \return True if the input can be processed
+     */
+    bool ableToProcessInput();
+
+    QString m_inputPath;
+    QString m_outputPath;
+};
+
+#endif
@@ -0,0 +1,28 @@
+PKGCONFIG += exempi-2.0
+SOURCES += src/metawritertests.cpp \
+           ../src/metaapplication.cpp \
+           ../src/atom.cpp \
+           ../src/mp4backend.cpp \
+           ../src/imagebackend.cpp \
+           ../src/xmphandler.cpp \
+           ../src/mpeg4atomutility.cpp
+TEMPLATE = app
+CONFIG += warn_on thread qt link_pkgconfig
+TARGET = metawriter-tests
+QT -= gui
+QT += testlib
+INCLUDEPATH += ../src
+HEADERS += src/metawritertests.h \
+           ../src/backendinterface.h \
+           ../src/metaapplication.h \
+           ../src/magic.h \
+           ../src/metamandatatypes.h \
+           ../src/atom.h \
+           ../src/mp4backend.h \
+           ../src/imagebackend.h \
+           ../src/xmphandler.h \
+           ../src/mpeg4atomutility.h
+
+QMAKE_CXXFLAGS += -Werror -Wall
+
+# Tests are run from the build tree, they are not installed
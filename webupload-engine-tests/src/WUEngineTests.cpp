@@ -30,8 +30,13 @@
 #include "uploaditem.h"
 #include "uploadqueue.h"
 #include "uploadstatistics.h"
+#include "linkestimator.h"
+#include "retryscheduler.h"
+#include "bearerpolicy.h"
+#include "serviceprivate.h"
 #include <QtTest/QtTest>
 #include <QFile>
+#include <QSettings>
 
 #include <QSignalSpy>
 
@@ -81,6 +86,85 @@ void WUEngineTests::setupSharingEntry(QString xmlPath) {
     delete entry;
 }
 
+void WUEngineTests::setupEntry(QString xmlPath, QStringList images) {
+    QString testImgPath = QDir::homePath() + "/MyDocs/.images/";
+
+    Entry *entry = new Entry();
+    entry->setAccountId("test-plugin");
+
+    foreach (QString image, images) {
+        Media *media = new Media();
+        if (!media->initFromTrackerIri (testImgPath + image)) {
+            delete media;
+            delete entry;
+            QFAIL("Could not init media");
+        }
+        entry->appendMedia(media);
+    }
+
+    if (!entry->serialize(xmlPath)) {
+        qDebug() << "Tried to serialize to " << xmlPath;
+        delete entry;
+        QFAIL("Serialization failed");
+    }
+    entry->reSerialize();
+
+    delete entry;
+}
+
+UploadItem * WUEngineTests::queueItem(QString xmlPath, QStringList images,
+    UploadQueue * queue) {
+
+    setupEntry(xmlPath, images);
+    UploadItem *item = new UploadItem(queue);
+    if (!item->init(xmlPath)) {
+        delete item;
+        return 0;
+    }
+
+    return item;
+}
+
+/*
+ * Media of the entry in upload order
+ */
+static QVector<Media *> uploadOrder(Entry * entry) {
+    QVector<Media *> order;
+    QVectorIterator<Media *> iter = entry->mediaInUploadOrder();
+    while (iter.hasNext()) {
+        order << iter.next();
+    }
+
+    return order;
+}
+
+/*
+ * Items of the queue from top to bottom
+ */
+static QList<UploadItem *> queueOrder(UploadQueue * queue) {
+    QList<UploadItem *> order;
+    for (UploadItem *item = queue->getTop(); item != 0;
+        item = queue->getNextItem(item)) {
+
+        order << item;
+    }
+
+    return order;
+}
+
+static void removeFromTracker(const QString & trackerIRI) {
+    QSparqlQuery rem ("DELETE { ?:te a rdf:Resource . } WHERE "
+        "{ ?:te a rdf:Resource . }", QSparqlQuery::DeleteStatement);
+    rem.bindValue ("te", QUrl (trackerIRI));
+    // Not checking for errors here - does not help
+    QSparqlConnection connection ("QTRACKER");
+    if (connection.isValid()) {
+        QSparqlResult * result = connection.exec (rem);
+        result->waitForFinished ();
+        delete result;
+    }
+}
+
 void WUEngineTests::testUploadItem() {
     UploadItem *item = new UploadItem();
     QString xmlPath = QDir::homePath();
@@ -334,6 +418,406 @@ void WUEngineTests::testStatistics() {
     QVERIFY (stat.seconds() < 7); // Should be ~4
 }
 
+void WUEngineTests::testLinkEstimator() {
+    // Keep estimates of the test away from the real engine settings
+    QString settingsDir = QDir::tempPath() + "/webupload-engine-tests";
+    QFile::remove (settingsDir + "/nokia/webupload-engine.conf");
+    QSettings::setPath (QSettings::NativeFormat, QSettings::UserScope,
+        settingsDir);
+
+    {
+        LinkEstimator estimator;
+        QSignalSpy changedSpy (&estimator,
+            SIGNAL (estimateChanged(QString,qint64,int)));
+
+        // Guesses from bearer before anything is measured
+        QCOMPARE (estimator.throughput ("2G"), (qint64)-1);
+        QCOMPARE (estimator.quality ("2G"), LinkEstimator::QUALITY_SLOW);
+        QCOMPARE (estimator.quality ("WLAN"), LinkEstimator::QUALITY_FAST);
+        QCOMPARE (estimator.quality ("3G"), LinkEstimator::QUALITY_MODERATE);
+        QCOMPARE (estimator.quality ("Unknown"),
+            LinkEstimator::QUALITY_UNKNOWN);
+        QCOMPARE (estimator.quality (""), LinkEstimator::QUALITY_UNKNOWN);
+
+        // Progress without started upload is ignored
+        estimator.transferProgress (0.5);
+        QCOMPARE (changedSpy.count(), 0);
+
+        estimator.transferStarted ("test-bearer", 100000, 0.0);
+        usleep (100000);
+        estimator.transferProgress (0.1);
+        QCOMPARE (changedSpy.count(), 1);
+        QVERIFY (estimator.setupLatency ("test-bearer") >= 100);
+        QCOMPARE (estimator.throughput ("test-bearer"), (qint64)-1);
+
+        // Too short sample period is not used
+        estimator.transferProgress (0.2);
+        QCOMPARE (changedSpy.count(), 1);
+
+        // 20000 bytes in over a second is a slow link
+        usleep (1100000);
+        estimator.transferProgress (0.3);
+        QCOMPARE (changedSpy.count(), 2);
+        qint64 throughput = estimator.throughput ("test-bearer");
+        QVERIFY (throughput > 0);
+        QVERIFY (throughput < 20000);
+        QCOMPARE (estimator.quality ("test-bearer"),
+            LinkEstimator::QUALITY_SLOW);
+
+        // Nothing is written to settings while upload is going on
+        {
+            QSettings settings ("nokia", "webupload-engine");
+            QVERIFY (!settings.contains ("link/test-bearer/throughput"));
+        }
+
+        estimator.transferEnded ();
+        {
+            QSettings settings ("nokia", "webupload-engine");
+            QCOMPARE (settings.value ("link/test-bearer/throughput").
+                toLongLong(), throughput);
+            QCOMPARE (settings.value ("link/test-bearer/samples").toInt(), 1);
+        }
+
+        // Only the service default is adapted to slow link
+        QCOMPARE (estimator.imageResizeOption ("test-bearer",
+            IMAGE_RESIZE_SERVICE_DEFAULT), IMAGE_RESIZE_SMALL);
+        QCOMPARE (estimator.imageResizeOption ("test-bearer",
+            IMAGE_RESIZE_LARGE), IMAGE_RESIZE_LARGE);
+        QCOMPARE (estimator.imageResizeOption ("WLAN",
+            IMAGE_RESIZE_SERVICE_DEFAULT), IMAGE_RESIZE_SERVICE_DEFAULT);
+        {
+            QSettings settings ("nokia", "webupload-engine");
+            QCOMPARE (settings.value ("link/decisions/image-resize-small").
+                toInt(), 1);
+        }
+    }
+
+    // Estimates are kept over restarts
+    LinkEstimator restarted;
+    QVERIFY (restarted.throughput ("test-bearer") > 0);
+    QCOMPARE (restarted.quality ("test-bearer"), LinkEstimator::QUALITY_SLOW);
+    QCOMPARE (restarted.throughput ("decisions"), (qint64)-1);
+
+    QFile::remove (settingsDir + "/nokia/webupload-engine.conf");
+}
+
+void WUEngineTests::testRetryScheduler() {
+    qRegisterMetaType<UploadItem *>("UploadItem *");
+    RetryScheduler scheduler;
+    QSignalSpy spyRetry (&scheduler, SIGNAL (retry(UploadItem *)));
+    QString xmlPath = QDir::homePath();
+
+    UploadItem *item = new UploadItem();
+    setupSharingEntry(xmlPath + "/entry.xml");
+    QVERIFY(item->init(xmlPath + "/entry.xml"));
+    Entry *entry = item->getEntry();
+    QCOMPARE(entry->retryAttempts(), 0);
+
+    QVERIFY(!scheduler.schedule(0, WebUpload::Error::connectFailure()));
+
+    // Errors needing the user are not retried, engine marks item failed
+    QVERIFY(!scheduler.schedule(item, WebUpload::Error::invalidFileType()));
+    QVERIFY(!scheduler.isScheduled(item));
+    QCOMPARE(entry->retryAttempts(), 0);
+    item->markFailed(WebUpload::Error::invalidFileType());
+
+    // Transient error is retried and the attempt is stored to the entry
+    WebUpload::Error error = WebUpload::Error::connectFailure();
+    QVERIFY(scheduler.schedule(item, error));
+    QVERIFY(scheduler.isScheduled(item));
+    item->markRetrying(error);
+    QCOMPARE(item->getError().code(), WebUpload::Error::CODE_CONNECT_FAILURE);
+    QCOMPARE(entry->retryAttempts(), 1);
+
+    UploadItem *reread = new UploadItem();
+    QVERIFY(reread->init(xmlPath + "/entry.xml"));
+    QCOMPARE(reread->getEntry()->retryAttempts(), 1);
+    delete reread;
+
+    // Connection came back, waiting item is retried at once
+    scheduler.retryNow();
+    QCOMPARE(spyRetry.count(), 1);
+    QVERIFY(!spyRetry.takeFirst().at(0).isNull());
+    QVERIFY(!scheduler.isScheduled(item));
+
+    // Use the rest of the attempts, then the engine marks item failed
+    for (int attempt = 2; attempt <= 5; ++attempt) {
+        QVERIFY(scheduler.schedule(item, error));
+        QCOMPARE(entry->retryAttempts(), attempt);
+    }
+    QVERIFY(!scheduler.schedule(item, error));
+    QCOMPARE(entry->retryAttempts(), 5);
+    scheduler.cancel(item);
+    QVERIFY(!scheduler.isScheduled(item));
+    item->markFailed(error);
+
+    // Repair from the user starts automatic retries from the beginning
+    entry->setRetryAttempts(0);
+    QVERIFY(scheduler.schedule(item, error));
+    QCOMPARE(entry->retryAttempts(), 1);
+
+    // Cancelled retry is not emitted
+    scheduler.cancel(item);
+    QVERIFY(!scheduler.isScheduled(item));
+    scheduler.retryNow();
+    QCOMPARE(spyRetry.count(), 0);
+
+    // Timer goes with a removed item
+    QVERIFY(scheduler.schedule(item, WebUpload::Error::serviceTimeOut()));
+    QString trackerIRI = entry->trackerIRI();
+    delete item;
+    scheduler.retryNow();
+    QCOMPARE(spyRetry.count(), 0);
+
+    QVERIFY(QFile::remove(xmlPath + "/entry.xml"));
+
+    QSparqlQuery rem ("DELETE { ?:te a rdf:Resource . } WHERE "
+        "{ ?:te a rdf:Resource . }", QSparqlQuery::DeleteStatement);
+    rem.bindValue ("te", QUrl (trackerIRI));
+    // Not checking for errors here - does not help
+    QSparqlConnection connection ("QTRACKER");
+    if (connection.isValid()) {
+        QSparqlResult * result = connection.exec (rem);
+        result->waitForFinished ();
+        delete result;
+    }
+}
+
+void WUEngineTests::testBearerPolicy() {
+    // Keep cellular usage of the test away from the real engine settings
+    QString settingsDir = QDir::tempPath() + "/webupload-engine-tests";
+    QFile::remove (settingsDir + "/nokia/webupload-engine.conf");
+    QSettings::setPath (QSettings::NativeFormat, QSettings::UserScope,
+        settingsDir);
+
+    BearerPolicy policy;
+    QString xmlPath = QDir::homePath();
+
+    UploadItem *item = new UploadItem();
+    setupSharingEntry(xmlPath + "/entry.xml");
+    QVERIFY(item->init(xmlPath + "/entry.xml"));
+    Entry *entry = item->getEntry();
+    qint64 unsent = entry->unsentSize();
+    QVERIFY(unsent > 0);
+
+    WebUpload::Service service;
+    QVERIFY(policy.allows(entry, &service, true));
+    QVERIFY(policy.allows(0, true));
+
+    // Entry limited to WLAN
+    entry->setNetworkPolicy(WebUpload::NETWORK_WLAN_ONLY);
+    QVERIFY(!policy.allows(item, true));
+    QVERIFY(!policy.allows(entry, &service, true));
+    QVERIFY(policy.allows(item, false));
+    entry->setNetworkPolicy(WebUpload::NETWORK_ANY);
+    QVERIFY(policy.allows(entry, &service, true));
+
+    // Service limits size of entries sent over cellular
+    service.d_ptr->m_cellularSize = unsent - 1;
+    QVERIFY(!policy.allows(entry, &service, true));
+    QVERIFY(policy.allows(entry, &service, false));
+    service.d_ptr->m_cellularSize = unsent;
+    QVERIFY(policy.allows(entry, &service, true));
+    service.d_ptr->m_cellularSize = 0;
+
+    // Service takes some media types only over WLAN
+    QString mimeType = entry->mediaAt(0)->mimeType();
+    QVERIFY(mimeType.startsWith("image/"));
+    service.d_ptr->m_wlanOnlyTypes << "video";
+    QVERIFY(policy.allows(entry, &service, true));
+    service.d_ptr->m_wlanOnlyTypes << "image";
+    QVERIFY(!policy.allows(entry, &service, true));
+    service.d_ptr->m_wlanOnlyTypes.clear();
+    service.d_ptr->m_wlanOnlyTypes << mimeType;
+    QVERIFY(!policy.allows(entry, &service, true));
+    QVERIFY(policy.allows(entry, &service, false));
+    service.d_ptr->m_wlanOnlyTypes.clear();
+
+    // Size limit of the engine settings
+    QSettings settings ("nokia", "webupload-engine");
+    QVERIFY(settings.fileName().startsWith(settingsDir));
+    settings.beginGroup ("policy");
+    settings.setValue ("cellular-max-size", unsent - 1);
+    settings.sync ();
+    QVERIFY(!policy.allows(entry, &service, true));
+    QVERIFY(policy.allows(entry, &service, false));
+    settings.setValue ("cellular-max-size", unsent);
+    settings.sync ();
+    QVERIFY(policy.allows(entry, &service, true));
+    settings.remove ("cellular-max-size");
+
+    // Monthly budget counts bytes sent over cellular
+    settings.setValue ("cellular-budget", 2 * unsent);
+    settings.sync ();
+    QVERIFY(policy.allows(entry, &service, true));
+
+    policy.sentOverCellular(0);
+    policy.sentOverCellular(unsent);
+    settings.sync ();
+    QCOMPARE(settings.value ("cellular-used").toLongLong(), unsent);
+    QCOMPARE(settings.value ("cellular-month").toString(),
+        QDate::currentDate().toString("yyyy-MM"));
+    QVERIFY(policy.allows(entry, &service, true));
+
+    policy.sentOverCellular(1);
+    settings.sync ();
+    QCOMPARE(settings.value ("cellular-used").toLongLong(), unsent + 1);
+    QVERIFY(!policy.allows(entry, &service, true));
+    QVERIFY(policy.allows(entry, &service, false));
+
+    // Usage of an earlier month is not counted, budget starts over
+    settings.setValue ("cellular-month", "2000-01");
+    settings.sync ();
+    QVERIFY(policy.allows(entry, &service, true));
+    policy.sentOverCellular(unsent);
+    settings.sync ();
+    QCOMPARE(settings.value ("cellular-used").toLongLong(), unsent);
+    QCOMPARE(settings.value ("cellular-month").toString(),
+        QDate::currentDate().toString("yyyy-MM"));
+    settings.endGroup ();
+
+    QString trackerIRI = entry->trackerIRI();
+    delete item;
+    QVERIFY(QFile::remove(xmlPath + "/entry.xml"));
+
+    QSparqlQuery rem ("DELETE { ?:te a rdf:Resource . } WHERE "
+        "{ ?:te a rdf:Resource . }", QSparqlQuery::DeleteStatement);
+    rem.bindValue ("te", QUrl (trackerIRI));
+    // Not checking for errors here - does not help
+    QSparqlConnection connection ("QTRACKER");
+    if (connection.isValid()) {
+        QSparqlResult * result = connection.exec (rem);
+        result->waitForFinished ();
+        delete result;
+    }
+}
+
+
+void WUEngineTests::testUploadOrder() {
+    QString xmlPath = QDir::homePath() + "/entry-order.xml";
+    setupEntry(xmlPath, QStringList() << "webupload-engine-test2.jpg"
+        << "webupload-engine-test1.jpg" << "webupload-engine-test2.jpg");
+
+    UploadItem *item = new UploadItem();
+    QVERIFY(item->init(xmlPath));
+    Entry *entry = item->getEntry();
+    QCOMPARE(entry->mediaCount(), (unsigned int)3);
+    QVERIFY(!entry->account().isNull());
+    WebUpload::Service *service = entry->account()->service();
+    QVERIFY(service != 0);
+
+    Media *large = entry->mediaAt(0);
+    Media *small = entry->mediaAt(1);
+    Media *sameSize = entry->mediaAt(2);
+    QVERIFY(small->fileSize() < large->fileSize());
+    QCOMPARE(sameSize->fileSize(), large->fileSize());
+
+    // Media are uploaded in the order they were added by default
+    service->d_ptr->m_smallFirst = false;
+    QVERIFY(!service->uploadsSmallFirst());
+    QVector<Media *> expected;
+    expected << large << small << sameSize;
+    QVERIFY(uploadOrder(entry) == expected);
+    QCOMPARE(entry->nextUnsentMedia(), large);
+
+    // Small ones first if the service allows, media of same size keep the
+    // order they were added in
+    service->d_ptr->m_smallFirst = true;
+    expected.clear();
+    expected << small << large << sameSize;
+    QVERIFY(uploadOrder(entry) == expected);
+    QCOMPARE(entry->nextUnsentMedia(), small);
+
+    service->d_ptr->m_smallFirst = false;
+
+    QString trackerIRI = entry->trackerIRI();
+    delete item;
+    QVERIFY(QFile::remove(xmlPath));
+    removeFromTracker(trackerIRI);
+}
+
+void WUEngineTests::testUploadQueueSmallFirst() {
+    UploadQueue *queue = new UploadQueue;
+    QString xmlPath = QDir::homePath();
+    QStringList largeImages = QStringList() << "webupload-engine-test2.jpg"
+        << "webupload-engine-test1.jpg";
+    QStringList smallImages = QStringList() << "webupload-engine-test1.jpg";
+    QList<UploadItem *> expected;
+
+    UploadItem *top = queueItem(xmlPath + "/entry-top.xml", largeImages,
+        queue);
+    UploadItem *large = queueItem(xmlPath + "/entry-large.xml", largeImages,
+        queue);
+    UploadItem *small1 = queueItem(xmlPath + "/entry-small1.xml",
+        smallImages, queue);
+    UploadItem *small2 = queueItem(xmlPath + "/entry-small2.xml",
+        smallImages, queue);
+    UploadItem *small3 = queueItem(xmlPath + "/entry-small3.xml",
+        smallImages, queue);
+    UploadItem *other = queueItem(xmlPath + "/entry-other.xml", largeImages,
+        queue);
+    UploadItem *small4 = queueItem(xmlPath + "/entry-small4.xml",
+        smallImages, queue);
+
+    QList<UploadItem *> items;
+    items << top << large << small1 << small2 << small3 << other << small4;
+    QVERIFY(!items.contains(0));
+    QVERIFY(small1->getEntry()->totalSize() < large->getEntry()->totalSize());
+
+    // All items are of the same account and share the service
+    QVERIFY(!top->getEntry()->account().isNull());
+    WebUpload::Service *service = top->getEntry()->account()->service();
+    QVERIFY(service != 0);
+
+    // Items are queued in the order they were added by default
+    service->d_ptr->m_smallFirst = false;
+    QVERIFY(queue->push(top));
+    QVERIFY(queue->push(large));
+    QVERIFY(queue->push(small1));
+    expected << top << large << small1;
+    QCOMPARE(queueOrder(queue), expected);
+
+    // Small item goes ahead of larger ones that are waiting, the top item
+    // is already being handled
+    service->d_ptr->m_smallFirst = true;
+    QVERIFY(queue->push(small2));
+    expected.clear();
+    expected << top << small2 << large << small1;
+    QCOMPARE(queueOrder(queue), expected);
+
+    // Item being processed is not passed
+    large->setOwner(UploadItem::OWNER_PROCESS_THREAD);
+    QVERIFY(queue->push(small3));
+    expected << small3;
+    QCOMPARE(queueOrder(queue), expected);
+    large->setOwner(UploadItem::OWNER_QUEUE);
+
+    // Neither is an item with sent media
+    large->getEntry()->mediaAt(0)->refreshState(Media::STATE_DONE);
+    QVERIFY(large->getEntry()->mediaSentCount() > 0);
+
+    // Nor a larger item of another account
+    other->getEntry()->setAccountId("webupload-engine-tests-other");
+    QVERIFY(other->getEntry()->accountId() != top->getEntry()->accountId());
+    QVERIFY(queue->push(other));
+    expected << other;
+    QVERIFY(queue->push(small4));
+    expected << small4;
+    QCOMPARE(queueOrder(queue), expected);
+
+    service->d_ptr->m_smallFirst = false;
+
+    QStringList trackerIRIs;
+    foreach (UploadItem *item, items) {
+        trackerIRIs << item->getEntry()->trackerIRI();
+        QVERIFY(QFile::remove(item->getEntry()->serializedTo()));
+    }
+    delete queue;
+
+    foreach (QString trackerIRI, trackerIRIs) {
+        removeFromTracker(trackerIRI);
+    }
+}
 
 
 QTEST_MAIN(WUEngineTests)
@@ -30,12 +30,19 @@
 #define _WEBUPLOAD_ENGINE_UNIT_TESTS_H_
 
 #include <QObject>
+#include <QStringList>
+
+class UploadItem;
+class UploadQueue;
 
 class WUEngineTests : public QObject {
     Q_OBJECT
 
     private:
         void setupSharingEntry(QString xmlPath);
+        void setupEntry(QString xmlPath, QStringList images);
+        UploadItem * queueItem(QString xmlPath, QStringList images,
+            UploadQueue * queue);
 
 	private slots:
 
@@ -44,6 +51,16 @@ class WUEngineTests : public QObject {
         void testUploadQueue();
         
         void testStatistics();
+
+        void testLinkEstimator();
+
+        void testRetryScheduler();
+
+        void testBearerPolicy();
+
+        void testUploadOrder();
+
+        void testUploadQueueSmallFirst();
 };
 
 #endif // #ifndef _WEBUPLOAD_ENGINE_UNIT_TESTS_H_
@@ -8,6 +8,8 @@ PKGCONFIG += accounts-qt contentaction-0.1
 
 QMAKE_CXXFLAGS += -Werror -Wall
 
+DEFINES += UNIT_TESTING
+
 TARGET       = webupload-engine-tests
 
 DEPENDPATH  += ./src  \
@@ -29,12 +31,18 @@ QMAKE_CXXFLAGS += -ftest-coverage -fprofile-arcs
 HEADERS +=  WUEngineTests.h        \
             uploaditem.h           \
             uploadqueue.h           \
-            uploadstatistics.h 
+            uploadstatistics.h     \
+            linkestimator.h        \
+            retryscheduler.h       \
+            bearerpolicy.h
 
 SOURCES +=  WUEngineTests.cpp      \
             uploaditem.cpp         \
             uploadqueue.cpp        \
-            uploadstatistics.cpp  
+            uploadstatistics.cpp   \
+            linkestimator.cpp      \
+            retryscheduler.cpp     \
+            bearerpolicy.cpp
 
 LIBS += -lgcov 
 LIBS += ../libwebupload/out/libwebupload.so
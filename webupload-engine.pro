@@ -13,5 +13,6 @@ SUBDIRS        += webupload-service      \
                   webupload-recovery     \
                   libwebupload-tests     \
                   webupload-engine-tests \
+                  metawriter/tests       \
                   metawriter \
                   publish-widgets
@@ -0,0 +1,130 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "bearerpolicy.h"
+#include "uploaditem.h"
+#include "logger.h"
+#include <QSettings>
+#include <QDate>
+#include "WebUpload/Account"
+#include "WebUpload/Service"
+
+BearerPolicy::BearerPolicy () {
+}
+
+BearerPolicy::~BearerPolicy () {
+}
+
+bool BearerPolicy::allows (UploadItem * item, bool cellular) {
+    if (!cellular || item == 0) {
+        return true;
+    }
+
+    WebUpload::Entry * entry = item->getEntry ();
+    WebUpload::SharedAccount account = entry->account ();
+    WebUpload::Service * service = 0;
+    if (!account.isNull ()) {
+        service = account->service ();
+    }
+
+    return allows (entry, service, cellular);
+}
+
+bool BearerPolicy::allows (WebUpload::Entry * entry,
+    const WebUpload::Service * service, bool cellular) {
+
+    if (!cellular || entry == 0) {
+        return true;
+    }
+
+    if (entry->networkPolicy () == WebUpload::NETWORK_WLAN_ONLY) {
+        DBGSTREAM << "Entry is uploaded only over WLAN";
+        return false;
+    }
+
+    qint64 unsent = entry->unsentSize ();
+
+    if (service != 0) {
+        qint64 limit = service->cellularSizeLimit ();
+        if (limit > 0 && unsent > limit) {
+            DBGSTREAM << "Entry" << unsent << "over cellular limit" << limit
+                << "of service";
+            return false;
+        }
+
+        for (unsigned int i = 0; i < entry->mediaCount (); ++i) {
+            WebUpload::Media * media = entry->mediaAt (i);
+            if (!media->isSent () &&
+                service->isWlanOnly (media->mimeType ())) {
+
+                DBGSTREAM << "Service uploads" << media->mimeType ()
+                    << "only over WLAN";
+                return false;
+            }
+        }
+    }
+
+    QSettings settings ("nokia", "webupload-engine");
+    settings.beginGroup ("policy");
+
+    qint64 maxSize = settings.value ("cellular-max-size", 0).toLongLong ();
+    if (maxSize > 0 && unsent > maxSize) {
+        DBGSTREAM << "Entry" << unsent << "over cellular limit" << maxSize;
+        return false;
+    }
+
+    qint64 budget = settings.value ("cellular-budget", 0).toLongLong ();
+    if (budget > 0 && cellularUsed () + unsent > budget) {
+        DBGSTREAM << "Entry" << unsent << "would exceed cellular budget"
+            << budget << "(used" << cellularUsed () << ")";
+        return false;
+    }
+
+    return true;
+}
+
+void BearerPolicy::sentOverCellular (qint64 bytes) {
+    if (bytes <= 0) {
+        return;
+    }
+
+    qint64 used = cellularUsed () + bytes;
+    DBGSTREAM << "Sent" << used << "bytes over cellular this month";
+
+    QSettings settings ("nokia", "webupload-engine");
+    settings.beginGroup ("policy");
+    settings.setValue ("cellular-month", currentMonth ());
+    settings.setValue ("cellular-used", used);
+}
+
+qint64 BearerPolicy::cellularUsed () const {
+    QSettings settings ("nokia", "webupload-engine");
+    settings.beginGroup ("policy");
+
+    // Budget is renewed at start of each month
+    if (settings.value ("cellular-month").toString () != currentMonth ()) {
+        return 0;
+    }
+
+    return settings.value ("cellular-used", 0).toLongLong ();
+}
+
+QString BearerPolicy::currentMonth () {
+    return QDate::currentDate ().toString ("yyyy-MM");
+}
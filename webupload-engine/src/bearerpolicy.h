@@ -0,0 +1,85 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _BEARER_POLICY_H_
+#define _BEARER_POLICY_H_
+
+#include <QString>
+
+class UploadItem;
+
+namespace WebUpload {
+    class Entry;
+    class Service;
+}
+
+/*!
+   \class  BearerPolicy
+   \brief  Decides if an upload item can be sent over the current bearer.
+           Items can be limited to WLAN by the entry (network policy) or by
+           the service (wlanOnly media types, cellularSize). Engine settings
+           group policy can limit size of single upload over cellular
+           (cellular-max-size) and total bytes sent over cellular in a
+           calendar month (cellular-budget).
+ */
+class BearerPolicy {
+
+public:
+
+    BearerPolicy ();
+    ~BearerPolicy ();
+
+    /*!
+      \brief Check if item can be uploaded now
+      \param item Item to be uploaded
+      \param cellular <code>true</code> if current bearer is cellular
+      \return <code>true</code> if item can be uploaded. If not, it should
+              wait for WLAN.
+     */
+    bool allows (UploadItem * item, bool cellular);
+
+    /*!
+      \brief Check if entry can be uploaded now
+      \param entry Entry to be uploaded
+      \param service Service of the entry account, or null if not known
+      \param cellular <code>true</code> if current bearer is cellular
+      \return <code>true</code> if entry can be uploaded
+     */
+    bool allows (WebUpload::Entry * entry, const WebUpload::Service * service,
+        bool cellular);
+
+    /*!
+      \brief Count bytes sent over cellular against the budget
+      \param bytes Bytes sent
+     */
+    void sentOverCellular (qint64 bytes);
+
+private:
+
+    /*!
+      \brief Bytes sent over cellular this month
+      \return Bytes sent
+     */
+    qint64 cellularUsed () const;
+
+    //! \brief Current month as stored with the cellular usage
+    static QString currentMonth ();
+};
+
+#endif // #ifndef _BEARER_POLICY_H_
@@ -0,0 +1,190 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "linkestimator.h"
+#include "logger.h"
+#include <QSettings>
+#include <QStringList>
+
+// Weight of the newest throughput sample
+#define THROUGHPUT_WEIGHT 0.3
+// Shorter sample periods are too noisy to be used
+#define MIN_SAMPLE_MSEC 1000
+// Limits of quality classes in bytes per second
+#define SLOW_LINK_LIMIT (20 * 1024)
+#define FAST_LINK_LIMIT (200 * 1024)
+
+LinkEstimator::LinkEstimator (QObject * parent) : QObject (parent),
+    m_totalBytes (0), m_lastDone (0.0), m_firstProgress (false),
+    m_changed (false) {
+
+    // Continue from the estimates of earlier runs
+    QSettings settings ("nokia", "webupload-engine");
+    settings.beginGroup ("link");
+    QStringList bearers = settings.childGroups ();
+    foreach (QString bearer, bearers) {
+        if (bearer == QLatin1String ("decisions")) {
+            continue;
+        }
+
+        Estimate estimate;
+        estimate.throughput = settings.value (bearer + "/throughput",
+            -1).toLongLong ();
+        estimate.setupLatency = settings.value (bearer + "/setup-latency",
+            -1).toInt ();
+        estimate.samples = settings.value (bearer + "/samples", 0).toInt ();
+        m_estimates.insert (bearer, estimate);
+    }
+}
+
+LinkEstimator::~LinkEstimator () {
+    // Keep what was learned from an upload cut by engine shutdown
+    transferEnded ();
+}
+
+void LinkEstimator::transferStarted (const QString & bearer,
+    qint64 totalBytes, float done) {
+
+    // Previous upload may not have been ended explicitly
+    transferEnded ();
+
+    m_bearer = bearer;
+    m_totalBytes = totalBytes;
+    m_lastDone = done;
+    m_lastTime.start ();
+    m_firstProgress = true;
+}
+
+void LinkEstimator::transferEnded () {
+    // Settings are written once per upload, not on every progress sample
+    if (m_changed && !m_bearer.isEmpty()) {
+        storeEstimate (m_bearer);
+    }
+
+    m_changed = false;
+    m_bearer.clear ();
+    m_totalBytes = 0;
+    m_firstProgress = false;
+}
+
+void LinkEstimator::transferProgress (float done) {
+    if (m_bearer.isEmpty() || m_totalBytes <= 0 || done <= m_lastDone) {
+        return;
+    }
+
+    Estimate & estimate = m_estimates[m_bearer];
+    int elapsed = m_lastTime.elapsed ();
+
+    if (m_firstProgress) {
+        // Bytes before the first progress are mostly in socket buffers, so
+        // this sample only tells how long it took to get going
+        m_firstProgress = false;
+        estimate.setupLatency = (estimate.setupLatency < 0) ? elapsed :
+            (int)(THROUGHPUT_WEIGHT * elapsed +
+            (1.0 - THROUGHPUT_WEIGHT) * estimate.setupLatency);
+    } else if (elapsed >= MIN_SAMPLE_MSEC) {
+        qint64 bytes = (qint64)((done - m_lastDone) * m_totalBytes);
+        qint64 sample = bytes * 1000 / elapsed;
+
+        estimate.throughput = (estimate.throughput < 0) ? sample :
+            (qint64)(THROUGHPUT_WEIGHT * sample +
+            (1.0 - THROUGHPUT_WEIGHT) * estimate.throughput);
+        ++estimate.samples;
+    } else {
+        return;
+    }
+
+    m_lastDone = done;
+    m_lastTime.start ();
+    m_changed = true;
+
+    Q_EMIT (estimateChanged (m_bearer, estimate.throughput,
+        estimate.setupLatency));
+}
+
+qint64 LinkEstimator::throughput (const QString & bearer) const {
+    return m_estimates.value (bearer).throughput;
+}
+
+int LinkEstimator::setupLatency (const QString & bearer) const {
+    return m_estimates.value (bearer).setupLatency;
+}
+
+LinkEstimator::Quality LinkEstimator::quality (const QString & bearer) const {
+    qint64 bytesInSecond = throughput (bearer);
+
+    if (bytesInSecond >= 0) {
+        if (bytesInSecond < SLOW_LINK_LIMIT) {
+            return QUALITY_SLOW;
+        } else if (bytesInSecond < FAST_LINK_LIMIT) {
+            return QUALITY_MODERATE;
+        }
+        return QUALITY_FAST;
+    }
+
+    // Nothing measured yet, guess from bearer
+    if (bearer == QLatin1String ("2G")) {
+        return QUALITY_SLOW;
+    } else if (bearer == QLatin1String ("WLAN") ||
+        bearer == QLatin1String ("Ethernet")) {
+        return QUALITY_FAST;
+    } else if (!bearer.isEmpty() && bearer != QLatin1String ("Unknown")) {
+        return QUALITY_MODERATE;
+    }
+
+    return QUALITY_UNKNOWN;
+}
+
+WebUpload::ImageResizeOption LinkEstimator::imageResizeOption (
+    const QString & bearer, WebUpload::ImageResizeOption requested) {
+
+    // Only the default is adapted, explicit choices of user are kept
+    if (requested == WebUpload::IMAGE_RESIZE_SERVICE_DEFAULT &&
+        quality (bearer) == QUALITY_SLOW) {
+
+        DBGSTREAM << "Link metrics: slow" << bearer << "link"
+            << throughput (bearer) << "B/s, using small images";
+        countDecision ("image-resize-small");
+        return WebUpload::IMAGE_RESIZE_SMALL;
+    }
+
+    return requested;
+}
+
+void LinkEstimator::storeEstimate (const QString & bearer) {
+    const Estimate & estimate = m_estimates[bearer];
+
+    DBGSTREAM << "Link metrics:" << bearer << estimate.throughput << "B/s,"
+        << "setup" << estimate.setupLatency << "ms," << estimate.samples
+        << "samples";
+
+    QSettings settings ("nokia", "webupload-engine");
+    settings.beginGroup ("link");
+    settings.beginGroup (bearer);
+    settings.setValue ("throughput", estimate.throughput);
+    settings.setValue ("setup-latency", estimate.setupLatency);
+    settings.setValue ("samples", estimate.samples);
+}
+
+void LinkEstimator::countDecision (const QString & name) {
+    QSettings settings ("nokia", "webupload-engine");
+    settings.beginGroup ("link");
+    settings.beginGroup ("decisions");
+    settings.setValue (name, settings.value (name, 0).toInt () + 1);
+}
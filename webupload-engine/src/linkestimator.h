@@ -0,0 +1,159 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _LINK_ESTIMATOR_H_
+#define _LINK_ESTIMATOR_H_
+
+#include <QObject>
+#include <QString>
+#include <QMap>
+#include <QTime>
+#include "WebUpload/enums.h"
+
+/*!
+   \class  LinkEstimator
+   \brief  Estimates the quality of the network per bearer from the progress
+           of actual uploads, and makes the adaptive choices based on it.
+           Estimates are kept over engine restarts, and they and the choices
+           made are logged and stored as metrics under the link group of the
+           engine settings.
+ */
+class LinkEstimator : public QObject {
+
+    Q_OBJECT
+
+public:
+
+    //! \brief Quality classes of link
+    enum Quality {
+        QUALITY_UNKNOWN, //!< Nothing measured, bearer not known
+        QUALITY_SLOW, //!< 2G like link
+        QUALITY_MODERATE, //!< 3G like link
+        QUALITY_FAST //!< WLAN like link
+    };
+
+    /*!
+      \brief Constructor
+      \param parent QObject parent
+     */
+    LinkEstimator (QObject * parent = 0);
+    ~LinkEstimator ();
+
+    /*!
+      \brief Upload started
+      \param bearer Bearer used, see ConnectionManager::bearerName
+      \param totalBytes Size of the upload
+      \param done Part of the upload already done earlier
+     */
+    void transferStarted (const QString & bearer, qint64 totalBytes,
+        float done);
+
+    /*!
+      \brief Upload stopped, done or failed. Estimate updated during the
+             upload is stored to settings.
+     */
+    void transferEnded ();
+
+    /*!
+      \brief Measured throughput
+      \param bearer Bearer name
+      \return Bytes in second or -1 if not measured yet
+     */
+    qint64 throughput (const QString & bearer) const;
+
+    /*!
+      \brief Measured time from start of upload to first progress. Covers
+             plugin start, authentication and connection handshakes, so
+             it's the round trip cost of starting an upload.
+      \param bearer Bearer name
+      \return Milliseconds or -1 if not measured yet
+     */
+    int setupLatency (const QString & bearer) const;
+
+    /*!
+      \brief Quality of link
+      \param bearer Bearer name
+      \return Quality class from measurements, or guess from bearer type if
+              there are none
+     */
+    Quality quality (const QString & bearer) const;
+
+    /*!
+      \brief Adapt image resize option to the link. On slow links the
+             service default is replaced with small images.
+      \param bearer Bearer name
+      \param requested Resize option of the entry
+      \return Resize option to use
+     */
+    WebUpload::ImageResizeOption imageResizeOption (const QString & bearer,
+        WebUpload::ImageResizeOption requested);
+
+public Q_SLOTS:
+
+    /*!
+      \brief Slot for progress of the current upload
+      \param done How much of the transfer is done
+     */
+    void transferProgress (float done);
+
+Q_SIGNALS:
+
+    /*!
+      \brief Signal emitted when estimate of bearer has changed
+      \param bearer Bearer name
+      \param bytesInSecond Throughput estimate
+      \param setupLatency Setup latency estimate in milliseconds
+     */
+    void estimateChanged (const QString & bearer, qint64 bytesInSecond,
+        int setupLatency);
+
+private:
+
+    //! \brief Estimates of one bearer
+    struct Estimate {
+        Estimate () : throughput (-1), setupLatency (-1), samples (0) {}
+
+        qint64 throughput; //!< Bytes in second, -1 if unknown
+        int setupLatency; //!< Milliseconds, -1 if unknown
+        int samples; //!< Throughput samples used
+    };
+
+    /*!
+      \brief Store estimate of bearer to settings and log it
+      \param bearer Bearer name
+     */
+    void storeEstimate (const QString & bearer);
+
+    /*!
+      \brief Count adaptive decision in metrics
+      \param name Name of the decision
+     */
+    void countDecision (const QString & name);
+
+    QMap<QString, Estimate> m_estimates; //!< Estimates per bearer
+
+    QString m_bearer; //!< Bearer of current upload, empty if none
+    qint64 m_totalBytes; //!< Size of current upload
+    float m_lastDone; //!< Done level of previous sample
+    QTime m_lastTime; //!< Time of previous sample
+    bool m_firstProgress; //!< Waiting for first progress of upload
+    bool m_changed; //!< Estimate changed after it was last stored
+};
+
+#endif
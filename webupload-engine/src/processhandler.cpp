@@ -21,6 +21,8 @@
 #include <QDebug>
 #include "processhandler.h"
 #include <QFile>
+#include "WebUpload/Entry"
+#include "WebUpload/UploadLedger"
 
 ProcessHandler::ProcessHandler (QObject *parent) : QObject (parent), 
     m_myItem (0), m_media (0) {
@@ -97,7 +99,11 @@ void ProcessHandler::processNextMedia (
                 // Otherwise letting res stay success - the error would anyways
                 // be reported once upload processing starts
             }  else {
-                res = m_media->makeCopy ();
+                res = m_media->makeCopy (QString(),
+                    m_myItem->imageResizeOption ());
+                if (res == WebUpload::Media::COPY_RESULT_SUCCESS) {
+                    warnIfUploaded (m_media);
+                }
             }
 
             Q_EMIT (mediaProcessed (res));
@@ -109,6 +115,19 @@ void ProcessHandler::processNextMedia (
     }
 }
 
+void ProcessHandler::warnIfUploaded (WebUpload::Media * media) {
+    WebUpload::UploadLedger ledger (m_myItem->getEntry()->accountId());
+    if (ledger.isEmpty ()) {
+        return;
+    }
+
+    QByteArray hash = WebUpload::UploadLedger::contentHash (media);
+    if (ledger.contains (hash)) {
+        qWarning() << "Re-uploading" << media->srcFilePath()
+            << "already sent to" << ledger.destination (hash);
+    }
+}
+
 void ProcessHandler::stopProcess (UploadItem *item) {
     qDebug() << "Asked to stop process";
     if (((item != 0) && (item == m_myItem)) || (item == 0)) {
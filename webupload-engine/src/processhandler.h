@@ -101,6 +101,14 @@ private Q_SLOTS:
         WebUpload::Media::COPY_RESULT_SUCCESS);
 
 private:
+
+    /*!
+      \brief Warn if content of processed media is already in the upload
+             ledger of the account
+      \param media Processed media
+     */
+    void warnIfUploaded (WebUpload::Media * media);
+
     UploadItem * m_myItem; //!< Item being processed
     WebUpload::Media *m_media; //!< Current media being processed
 };
@@ -0,0 +1,167 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "retryscheduler.h"
+#include "uploaditem.h"
+#include "logger.h"
+#include <QDateTime>
+#include "WebUpload/Entry"
+
+// Longest delay between retries in seconds
+#define RETRY_MAX_DELAY 3600
+
+RetryScheduler::RetryScheduler (QObject * parent) : QObject (parent) {
+    qsrand (QDateTime::currentDateTime().toTime_t());
+}
+
+RetryScheduler::~RetryScheduler () {
+}
+
+bool RetryScheduler::schedule (UploadItem * item,
+    const WebUpload::Error & error) {
+
+    int baseDelay = 0;
+    int maxAttempts = 0;
+    if (item == 0 || !policy (error.code(), baseDelay, maxAttempts)) {
+        return false;
+    }
+
+    WebUpload::Entry * entry = item->getEntry ();
+    int attempt = entry->retryAttempts () + 1;
+    if (attempt > maxAttempts) {
+        DBGSTREAM << "Retry: All" << maxAttempts << "attempts used";
+        return false;
+    }
+
+    entry->setRetryAttempts (attempt);
+
+    // Timers of removed items are gone
+    m_timers.removeAll (QPointer<QTimer>());
+
+    QTimer * timer = timerFor (item);
+    if (timer == 0) {
+        timer = new QTimer (item);
+        timer->setSingleShot (true);
+        connect (timer, SIGNAL (timeout()), this, SLOT (timeout()));
+        m_timers.append (timer);
+    }
+
+    int msec = delay (baseDelay, attempt);
+    DBGSTREAM << "Retry:" << attempt << "/" << maxAttempts << "of code"
+        << error.code() << "in" << msec << "ms";
+    timer->start (msec);
+
+    return true;
+}
+
+void RetryScheduler::cancel (UploadItem * item) {
+    QTimer * timer = timerFor (item);
+    if (timer != 0) {
+        m_timers.removeAll (timer);
+        delete timer;
+    }
+}
+
+bool RetryScheduler::isScheduled (UploadItem * item) const {
+    return (timerFor (item) != 0);
+}
+
+void RetryScheduler::retryNow () {
+    QList<QPointer<QTimer> > timers = m_timers;
+    m_timers.clear ();
+
+    for (int i = 0; i < timers.size(); ++i) {
+        QTimer * timer = timers.at (i);
+        if (timer == 0) {
+            continue;
+        }
+
+        UploadItem * item = qobject_cast<UploadItem *>(timer->parent());
+        delete timer;
+
+        if (item != 0) {
+            DBGSTREAM << "Retry: Early retry of" << item->toString();
+            Q_EMIT (retry (item));
+        }
+    }
+}
+
+void RetryScheduler::timeout () {
+    QTimer * timer = qobject_cast<QTimer *>(sender());
+    if (timer == 0) {
+        return;
+    }
+
+    UploadItem * item = qobject_cast<UploadItem *>(timer->parent());
+    m_timers.removeAll (timer);
+    timer->deleteLater ();
+
+    if (item != 0) {
+        Q_EMIT (retry (item));
+    }
+}
+
+QTimer * RetryScheduler::timerFor (UploadItem * item) const {
+    for (int i = 0; i < m_timers.size(); ++i) {
+        QTimer * timer = m_timers.at (i);
+        if (timer != 0 && timer->parent() == item) {
+            return timer;
+        }
+    }
+
+    return 0;
+}
+
+bool RetryScheduler::policy (WebUpload::Error::Code code, int & baseDelay,
+    int & maxAttempts) {
+
+    switch (code) {
+        case WebUpload::Error::CODE_CONNECT_FAILURE:
+            baseDelay = 10;
+            maxAttempts = 5;
+            return true;
+        case WebUpload::Error::CODE_SERVICE_TIME_OUT:
+            baseDelay = 30;
+            maxAttempts = 5;
+            return true;
+        case WebUpload::Error::CODE_TRANSFER_FAILED:
+            baseDelay = 30;
+            maxAttempts = 3;
+            return true;
+        case WebUpload::Error::CODE_SERVICE_ERROR:
+            baseDelay = 60;
+            maxAttempts = 3;
+            return true;
+        default:
+            // Needs the user, e.g. to fix the account or the files
+            return false;
+    }
+}
+
+int RetryScheduler::delay (int baseDelay, int attempt) {
+    int seconds = baseDelay;
+    for (int i = 1; i < attempt && seconds < RETRY_MAX_DELAY; ++i) {
+        seconds *= 2;
+    }
+    seconds = qMin (seconds, RETRY_MAX_DELAY);
+
+    // Half of the delay is fixed, the other half random
+    int msec = seconds * 1000;
+    return msec / 2 + qrand () % (msec / 2 + 1);
+}
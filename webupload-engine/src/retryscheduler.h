@@ -0,0 +1,124 @@
+/*
+ * Web Upload Engine -- MeeGo social networking uploads
+ * Copyright (c) 2010-2011 Nokia Corporation and/or its subsidiary(-ies).
+ * Contact: Jukka Tiihonen <jukka.t.tiihonen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _RETRY_SCHEDULER_H_
+#define _RETRY_SCHEDULER_H_
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+#include "WebUpload/Error"
+
+class UploadItem;
+
+/*!
+   \class  RetryScheduler
+   \brief  Retries uploads that failed with transient errors. Each error code
+           has its own base delay and attempt budget. Delay doubles with
+           each attempt and is randomized (half fixed, half random), so that
+           devices failing at the same time don't retry at the same time.
+           Attempts are stored to the entry.
+ */
+class RetryScheduler : public QObject {
+
+    Q_OBJECT
+
+public:
+
+    /*!
+      \brief Constructor
+      \param parent QObject parent
+     */
+    RetryScheduler (QObject * parent = 0);
+    ~RetryScheduler ();
+
+    /*!
+      \brief Schedule retry of failed upload
+      \param item Item that failed
+      \param error Error of the failure
+      \return <code>true</code> if retry was scheduled. <code>false</code>
+              if error is not transient or retries of the entry are used,
+              in which case the item should be marked failed.
+     */
+    bool schedule (UploadItem * item, const WebUpload::Error & error);
+
+    /*!
+      \brief Cancel scheduled retry of item
+      \param item Item
+     */
+    void cancel (UploadItem * item);
+
+    /*!
+      \brief Check if item is waiting for retry
+      \param item Item
+      \return <code>true</code> if retry of item is scheduled
+     */
+    bool isScheduled (UploadItem * item) const;
+
+public Q_SLOTS:
+
+    //! \brief Retry all waiting items now, e.g. when connection comes back
+    void retryNow ();
+
+Q_SIGNALS:
+
+    /*!
+      \brief Signal emitted when item should be uploaded again
+      \param item Item to retry
+     */
+    void retry (UploadItem * item);
+
+private Q_SLOTS:
+
+    //! \brief Retry timer of item timed out
+    void timeout ();
+
+private:
+
+    /*!
+      \brief Retry policy of error
+      \param code Error code
+      \param baseDelay Delay of first retry in seconds is stored here
+      \param maxAttempts Maximum number of retries is stored here
+      \return <code>true</code> if error is transient and can be retried
+     */
+    static bool policy (WebUpload::Error::Code code, int & baseDelay,
+        int & maxAttempts);
+
+    /*!
+      \brief Delay before next retry
+      \param baseDelay Delay of the first retry in seconds
+      \param attempt Number of the retry, starting from 1
+      \return Delay in milliseconds
+     */
+    static int delay (int baseDelay, int attempt);
+
+    /*!
+      \brief Find timer of item
+      \param item Item
+      \return Timer or null if retry of item is not scheduled
+     */
+    QTimer * timerFor (UploadItem * item) const;
+
+    //! Retry timers, children of the items so they go with the items
+    QList<QPointer<QTimer> > m_timers;
+};
+
+#endif // #ifndef _RETRY_SCHEDULER_H_
@@ -22,6 +22,7 @@
 #include "uploaditem.h"
 #include "uploadqueue.h"
 #include "logger.h"
+#include <QSettings>
 #include <stdlib.h>
 
 /*****************************************************************
@@ -29,7 +30,8 @@
  *****************************************************************/
 
 UploadEngine::UploadEngine(int argc, char **argv) :
-    QCoreApplication(argc, argv), connection (this), uploadProcess (this),
+    QCoreApplication(argc, argv), connection (this), linkEstimator (this),
+    cellularBytes (0), retryScheduler (this), uploadProcess (this),
     tuiClient (new TransferUI::Client (this)), shutdownWhenEmptyQueue (true),
     state (IDLE), processThread (0), usbModeDetector (this) {
     
@@ -68,6 +70,10 @@ UploadEngine::UploadEngine(int argc, char **argv) :
         
     connect (&connection, SIGNAL (connected()), this, SLOT (connected()));
     connect (&connection, SIGNAL (disconnected()), this, SLOT (disconnected()));
+    connect (&connection, SIGNAL (bearerChanged()), this,
+        SLOT (bearerChanged()));
+    connect (&retryScheduler, SIGNAL (retry(UploadItem*)), this,
+        SLOT (retryItem(UploadItem*)));
 
     connect (this, SIGNAL (startUpload(UploadItem*)), &uploadProcess,
         SLOT (startUpload(UploadItem*)));
@@ -105,6 +111,32 @@ bool UploadEngine::newUpload (const QString &path) {
     return true;
 }
 
+void UploadEngine::setRateLimit (const QString & path, int bytesPerSecond) {
+    if (bytesPerSecond < 0) {
+        bytesPerSecond = 0;
+    }
+
+    if (path.isEmpty()) {
+        DBGSTREAM << "Rate limit of all uploads:" << bytesPerSecond;
+        QSettings settings ("nokia", "webupload-engine");
+        settings.setValue ("throttle/rate", bytesPerSecond);
+    } else {
+        UploadItem * item = queue.itemForEntryPath (path);
+        if (item == 0) {
+            WARNSTREAM << "No item for rate limit:" << path;
+            return;
+        }
+
+        DBGSTREAM << "Rate limit of" << path << ":" << bytesPerSecond;
+        item->setRateLimit (bytesPerSecond);
+    }
+
+    UploadItem * current = uploadProcess.currentlySendingMedia ();
+    if (current != 0) {
+        uploadProcess.setRateLimit (rateLimitFor (current));
+    }
+}
+
     
 void UploadEngine::newUploadReceived (const QString &path) {
 
@@ -215,6 +247,12 @@ void UploadEngine::queueTop (UploadItem * item) {
         if (processThread == 0) {
             startProcessThread ();
         }
+
+        // Images are scaled while processing, pick size for current link.
+        // Only processing uses it, the choice stored in the entry is kept.
+        item->setImageResizeOption (linkEstimator.imageResizeOption (
+            connection.bearerName(), item->getEntry()->imageResizeOption()));
+
         item->setOwner (UploadItem::OWNER_PROCESS_THREAD);
         item->markPending (UploadItem::PENDING_PROCESSING);
         Q_EMIT (startProcess (item));
@@ -232,6 +270,33 @@ void UploadEngine::queueTop (UploadItem * item) {
             Q_ASSERT (item->getOwner() == UploadItem::OWNER_QUEUE);
         }
 
+        // Items waiting for WLAN are skipped so that the ones that can be
+        // sent now don't wait behind them
+        bool cellular = connection.isCellular ();
+        if (!bearerPolicy.allows (item, cellular)) {
+            item->markPending (UploadItem::PENDING_WLAN);
+
+            UploadItem * next = queue.getNextItem (item);
+            while (next != 0 && !bearerPolicy.allows (next, cellular)) {
+                next = queue.getNextItem (next);
+            }
+
+            if (next != 0) {
+                DBGSTREAM << "Item waits for WLAN, sending next one";
+                if (!next->isProcessed () && processThread != 0 &&
+                    next->getOwner () == UploadItem::OWNER_QUEUE) {
+                    // Like in queueChangeTop, next one is processed first
+                    Q_EMIT (stopProcess (0));
+                }
+                queue.advanceItem (next);
+            } else {
+                DBGSTREAM << "All items wait for WLAN";
+                setState (OFFLINE);
+                connection.releaseConnection ();
+            }
+            return;
+        }
+
         DBGSTREAM << "Now checking for connection";
         // If we don't have connection ask for it
         if (connection.isConnected() == false) {
@@ -243,6 +308,19 @@ void UploadEngine::queueTop (UploadItem * item) {
             setState (SENDING);
         }
         
+        WebUpload::Entry * entry = item->getEntry ();
+        qint64 totalSize = entry->totalSize ();
+        cellularBytes = cellular ? entry->unsentSize () : 0;
+        float done = (totalSize > 0) ?
+            ((float)(totalSize - entry->unsentSize ()) / totalSize) : 0.0;
+        linkEstimator.transferStarted (connection.bearerName(), totalSize,
+            done);
+        connect (item, SIGNAL (progressed(float)), &linkEstimator,
+            SLOT (transferProgress(float)));
+
+        uploadProcess.setRateLimit (rateLimitFor (item));
+
+        retryScheduler.cancel (item);
         item->setOwner (UploadItem::OWNER_UPLOAD_THREAD);
         Q_EMIT (startUpload (item));
     }
@@ -431,6 +509,9 @@ void UploadEngine::processThreadFailed (UploadItem *item,
 
 void UploadEngine::uploadDone (UploadItem * item) {
     DBGSTREAM << "Upload done signal from thread";
+    endLinkEstimate (item);
+    bearerPolicy.sentOverCellular (cellularBytes);
+    cellularBytes = 0;
     item->markDone(); 
     item->setOwner (UploadItem::OWNER_QUEUE);
     tuiClient->removeTransfer (item->getTransferId ());
@@ -445,6 +526,8 @@ void UploadEngine::uploadStopped (UploadItem * item) {
         return;
     }
 
+    endLinkEstimate (item);
+
     if (m_stoppingItems.contains(item)) {
         m_stoppingItems.removeAll(item);
         item->setCancelled();
@@ -473,6 +556,7 @@ void UploadEngine::uploadFailed (UploadItem * item, WebUpload::Error error) {
     DBGSTREAM << "Upload failed signal" << error.code();
 
     Q_ASSERT (item != 0);
+    endLinkEstimate (item);
 
     if (m_stoppingItems.contains(item)) {
         DBGSTREAM << "Fail: Marked to be cancelled";
@@ -499,6 +583,9 @@ void UploadEngine::uploadFailed (UploadItem * item, WebUpload::Error error) {
             if (connection.isOnline()) {
                 connection.isConnected();
             }
+        } else if (retryScheduler.schedule (item, error)) {
+            DBGSTREAM << "Fail: Code:" << error.code() << "retry scheduled";
+            item->markRetrying (error);
         } else {
         
             DBGSTREAM << "Fail: Code:" << error.code();
@@ -535,6 +622,24 @@ void UploadEngine::repairError () {
         return;
     }
 
+    // User asked for retry, automatic retries start again from beginning
+    retryScheduler.cancel (item);
+    item->getEntry()->setRetryAttempts (0);
+
+    repairItem (item);
+}
+
+void UploadEngine::retryItem (UploadItem * item) {
+    if (item->isCancelled ()) {
+        DBGSTREAM << "Retry: Item was cancelled";
+        return;
+    }
+
+    DBGSTREAM << "Retry:" << item->toString();
+    repairItem (item);
+}
+
+void UploadEngine::repairItem (UploadItem * item) {
     if (item->getOwner () == UploadItem::OWNER_UPLOAD_THREAD) {
         DBGSTREAM << "Repair: Ignoring repair (already uploading)";
         return;
@@ -638,6 +743,25 @@ void UploadEngine::setState (State newState) {
     }
 }
 
+qint64 UploadEngine::rateLimitFor (UploadItem * item) const {
+    QSettings settings ("nokia", "webupload-engine");
+    qint64 rate = settings.value ("throttle/rate", 0).toLongLong ();
+
+    qint64 itemRate = item->rateLimit ();
+    if (itemRate > 0 && (rate <= 0 || itemRate < rate)) {
+        rate = itemRate;
+    }
+
+    return rate;
+}
+
+void UploadEngine::endLinkEstimate (UploadItem * item) {
+    if (item != 0) {
+        item->disconnect (&linkEstimator);
+    }
+    linkEstimator.transferEnded ();
+}
+
 void UploadEngine::connected () {
     if (getState () != SENDING) {
         setState (IDLE);
@@ -646,6 +770,9 @@ void UploadEngine::connected () {
     } else {
         DBGSTREAM << "Engine ignoring connected signal";
     }
+
+    // Failures waiting for retry may have been caused by the connection
+    retryScheduler.retryNow ();
 }
 
 void UploadEngine::disconnected () {
@@ -659,6 +786,13 @@ void UploadEngine::disconnected () {
 }
 
 
+void UploadEngine::bearerChanged () {
+    if (getState() == OFFLINE) {
+        DBGSTREAM << "Bearer changed, check if waiting items can be sent";
+        queueTop (queue.getTop());
+    }
+}
+
 void UploadEngine::usbModeChanged (MeeGo::QmUSBMode::Mode mode) {
 
     DBGSTREAM << "USB Mode:" << (int)currentUSBMode << "-->" << (int)mode;
@@ -29,6 +29,9 @@
 #include "uploadqueue.h"
 #include "uploadprocess.h"
 #include "connectionmanager.h"
+#include "linkestimator.h"
+#include "bearerpolicy.h"
+#include "retryscheduler.h"
 #include "processthread.h"
 
 // For getting signals when usb is connected in mass storage mode
@@ -89,6 +92,15 @@ public Q_SLOTS:
       \return Always returns <code>true</code>
      */
     bool newUpload (const QString &path);
+
+    /*!
+      \brief Limit upload rate. Can be changed while uploading.
+      \param path Path to upload definition of the item to be limited, or
+                  empty string to limit all uploads. When both are set, the
+                  lower one is used.
+      \param bytesPerSecond Maximum rate, 0 to remove the limit
+     */
+    void setRateLimit (const QString & path, int bytesPerSecond);
     
     //! \brief Shutdown upload engine (will stop all ongoing uploads)
     void shutdown();
@@ -175,6 +187,15 @@ private Q_SLOTS:
 
     //! \brief Slot for ConnectionManager::disconnected
     void disconnected ();
+
+    //! \brief Slot for ConnectionManager::bearerChanged
+    void bearerChanged ();
+
+    /*!
+      \brief Slot for RetryScheduler::retry
+      \param item Item to upload again
+     */
+    void retryItem (UploadItem * item);
     
 
     //! \brief Slot for Meego::QmUSBMode::modeChanged
@@ -257,7 +278,28 @@ private:
      */
     void setState (State newState);
 
+    /*!
+      \brief Process or upload failed item again
+      \param item Item to repair
+     */
+    void repairItem (UploadItem * item);
+
+    //! \brief Stop following progress of item for link estimates
+    void endLinkEstimate (UploadItem * item);
+
+    /*!
+      \brief Rate limit to use for item
+      \param item Item uploaded
+      \return Lower of the item and global limits, 0 if neither is set
+     */
+    qint64 rateLimitFor (UploadItem * item) const;
+
     WebUpload::ConnectionManager connection; //!< Connection manager class
+    LinkEstimator linkEstimator; //!< Link quality from upload progress
+    BearerPolicy bearerPolicy; //!< Decides which items wait for WLAN
+    //! Bytes of current upload counted against the cellular budget
+    qint64 cellularBytes;
+    RetryScheduler retryScheduler; //!< Retries transient failures
     UploadQueue queue; //!< Upload queue
     UploadProcess uploadProcess; //!< Communicate with upload process
     TransferUI::Client * tuiClient; //!< TransferUI client
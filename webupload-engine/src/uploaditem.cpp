@@ -34,7 +34,8 @@
 UploadItem::UploadItem(QObject * parent) : QObject (parent), m_tuiTransfer (0),
     m_entry(0), m_cancelled (false), m_processed (false), m_mediaIter (0),
     m_currMedia (0), m_totalSize (0), m_filesCompletedCount (0),
-    m_ownerType (OWNER_QUEUE) {
+    m_ownerType (OWNER_QUEUE), m_rateLimit (0), m_imageResizeSet (false),
+    m_imageResizeOption (WebUpload::IMAGE_RESIZE_SERVICE_DEFAULT) {
 
     connect (&m_statistics, SIGNAL (timeLeftEstimate(int)), this, 
         SLOT (estimateTime(int)));
@@ -72,7 +73,8 @@ bool UploadItem::init (const QString & path, TransferUI::Client * tuiClient) {
     }
 
     m_totalSize = m_entry->totalSize();
-    m_mediaIter = new QVectorIterator<WebUpload::Media *>(m_entry->media());
+    m_mediaIter = new QVectorIterator<WebUpload::Media *>(
+        m_entry->mediaInUploadOrder());
 
     m_processed = true;
     // If the state of the entry is something other than pending, no need to
@@ -98,13 +100,12 @@ bool UploadItem::init (const QString & path, TransferUI::Client * tuiClient) {
     DBGSTREAM << "Registering transfer in TUI ";
     //Get the first media to display thumbnail / title
     WebUpload::Media *media = 0;
-    if (m_mediaIter->hasNext()) {
-         media = m_mediaIter->next();
+    if (m_entry->mediaCount() > 0) {
+         media = m_entry->mediaAt (0);
     } else {
         WARNSTREAM << "No Media in the entry" ;
         return false;
     }
-    m_mediaIter->toFront();
     QString transferName = getPresentationString (media);
     m_tuiTransfer = tuiClient->registerTransfer (transferName,
         TransferUI::Client::TRANSFER_TYPES_UPLOAD);
@@ -259,6 +260,10 @@ WebUpload::Error UploadItem::takeError() {
 bool UploadItem::uploadProgress (float done) {   
     bool ret = false;
 
+    if ((0.0 < done) && (done <= 1.0)) {
+        Q_EMIT (progressed (done));
+    }
+
     if (m_tuiTransfer != 0) {
         if ((0.0 <= done) && (done <= 1.0)) {
             if (!m_statistics.nowDone (done)) {
@@ -317,11 +322,13 @@ bool UploadItem::markFailed (const WebUpload::Error & newError) {
     
     if (m_tuiTransfer != 0) {
         // Set thumbnail to first failed media's image
-        int mediaCount = m_entry->mediaCount ();
-        for (int i = 0; i < mediaCount; ++i) {
-            WebUpload::Media *media = m_entry->mediaAt (i);
-            // The first unsent media would definitely have an error since we 
-            // upload media sequentially.
+        QVectorIterator<WebUpload::Media *> iter =
+            m_entry->mediaInUploadOrder ();
+        while (iter.hasNext ()) {
+            WebUpload::Media *media = iter.next ();
+            // Media are sent one by one in upload order, which is not the
+            // entry order if the service uploads small media first. So the
+            // first unsent media in upload order is the one with the error.
             if (!media->isSent ()) {
                 QString transferName = getPresentationString (media);
                 m_tuiTransfer->setName (transferName);
@@ -398,6 +405,39 @@ bool UploadItem::isProcessed() const {
     return m_processed;
 }
 
+void UploadItem::setRateLimit (qint64 bytesPerSecond) {
+    m_rateLimit = bytesPerSecond;
+}
+
+qint64 UploadItem::rateLimit () const {
+    return m_rateLimit;
+}
+
+void UploadItem::setImageResizeOption (WebUpload::ImageResizeOption option) {
+    m_imageResizeOption = option;
+    m_imageResizeSet = true;
+}
+
+WebUpload::ImageResizeOption UploadItem::imageResizeOption () {
+    if (m_imageResizeSet || m_entry == 0) {
+        return m_imageResizeOption;
+    }
+    return m_entry->imageResizeOption ();
+}
+
+bool UploadItem::markRetrying (const WebUpload::Error & error) {
+    Q_ASSERT (m_entry != 0);
+
+    m_error = error;
+
+    // Store retry attempts
+    if (!m_entry->reSerialize()) {
+        WARNSTREAM << "Failed to reserialize";
+    }
+
+    return markPending (PENDING_RETRY);
+}
+
 bool UploadItem::markPending (PendingReason reason) {
     bool ret = false;
     QString pReason;
@@ -420,6 +460,14 @@ bool UploadItem::markPending (PendingReason reason) {
                 //% "Transfer is disabled in mass storage mode"
                 pReason = qtTrId ("qtn_tui_transfer_waiting_msm");
                 break;
+            case PENDING_WLAN:
+                //% "Waiting for WLAN connection"
+                pReason = qtTrId ("qtn_tui_transfer_waiting_wlan");
+                break;
+            case PENDING_RETRY:
+                //% "Upload failed, trying again soon"
+                pReason = qtTrId ("qtn_tui_transfer_waiting_retry");
+                break;
             default:
                 WARNSTREAM << "Unknown pending state";
                 pReason = "Unknown pending state";
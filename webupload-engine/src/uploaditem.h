@@ -65,7 +65,9 @@ public:
         PENDING_CONNECTIVITY, //!< Item waits for connectivity
         PENDING_QUEUED, //!< Item is in queue
         PENDING_PROCESSING, //!< Item is being processed
-        PENDING_MSM //!< Item waits for mass storage mode to be disabled on device
+        PENDING_MSM, //!< Item waits for mass storage mode to be disabled on device
+        PENDING_WLAN, //!< Item waits for WLAN connection
+        PENDING_RETRY //!< Item failed and waits to be retried
     };
 
     //! Owner options for item
@@ -154,6 +156,33 @@ public:
       \return true if processed, else false
     */
     bool isProcessed() const;
+
+    /*!
+      \brief Set rate limit of the item
+      \param bytesPerSecond Maximum upload rate, 0 if there is no limit
+     */
+    void setRateLimit (qint64 bytesPerSecond);
+
+    /*!
+      \brief Rate limit of the item
+      \return Maximum upload rate, 0 if there is no limit
+     */
+    qint64 rateLimit () const;
+
+    /*!
+      \brief Set image resize option used when processing the item. Only
+             the copies made for upload are affected, option stored in the
+             entry is kept as user chose it.
+      \param option Resize option for processing
+     */
+    void setImageResizeOption (WebUpload::ImageResizeOption option);
+
+    /*!
+      \brief Image resize option used when processing the item
+      \return Option given with setImageResizeOption, or the option of the
+              entry if none was given
+     */
+    WebUpload::ImageResizeOption imageResizeOption ();
     
     /*!
       \brief Give string presentation of item. Can be used in logging.
@@ -189,6 +218,12 @@ Q_SIGNALS:
 
     //! \brief Signal emitted when item has error and needs repair
     void repairError ();
+
+    /*!
+      \brief Signal emitted when upload progress of item is updated
+      \param done How much of transfer is done
+     */
+    void progressed (float done);
     
 public Q_SLOTS:
     
@@ -215,6 +250,13 @@ public Q_SLOTS:
       \return true if information could be sent to TUI, else false
      */
     bool markFailed (const WebUpload::Error & error);
+
+    /*!
+      \brief Mark item waiting for automatic retry after failure
+      \param error Error of the failure, given to plugin when retried
+      \return true if information could be sent to TUI, else false
+     */
+    bool markRetrying (const WebUpload::Error & error);
     
     /*!
       \brief Slot for marking item active
@@ -274,6 +316,10 @@ private:
     int m_filesCompletedCount;
     //! Enum signifying who is using/working with this UploadItem currently.
     Owner m_ownerType; 
+    qint64 m_rateLimit; //!< Upload rate limit, 0 if there is no limit
+    bool m_imageResizeSet; //!< Image resize option set for processing
+    //! Image resize option for processing, valid if m_imageResizeSet
+    WebUpload::ImageResizeOption m_imageResizeOption;
 };
 
 Q_DECLARE_METATYPE(UploadItem::ProcessError)
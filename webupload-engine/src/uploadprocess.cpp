@@ -27,12 +27,15 @@
 
 UploadProcess::UploadProcess (QObject * parent) : 
     WebUpload::PluginProcess (parent), m_currItem (0), m_currEntry (0),
-    m_currMediaIdx (-1), m_resultHandled(false), m_stopping(false) {
+    m_currMediaIdx (-1), m_currMediaStateReported (false),
+    m_resultHandled(false), m_stopping(false), m_rateLimit (0) {
 
     // Making these connections queued connection so as to not block the event
     // loop when some data comes from the upload process
     connect (&m_pdata, SIGNAL (sendingMediaSignal(quint32)), this,
         SLOT (sendingMedia(quint32)), Qt::QueuedConnection);
+    connect (&m_pdata, SIGNAL (mediaStateChangedSignal(quint32,qint32)),
+        this, SLOT (mediaStateChanged(quint32,qint32)), Qt::QueuedConnection);
     connect (&m_pdata, SIGNAL (doneSignal()), this, SLOT (done()),
         Qt::QueuedConnection);
     connect (&m_pdata, SIGNAL (stoppedSignal()), this, SLOT (stopped()),
@@ -61,6 +64,17 @@ bool UploadProcess::isProcessStopping () const {
     return m_stopping;
 }
 
+void UploadProcess::setRateLimit (qint64 bytesPerSecond) {
+    if (m_rateLimit == bytesPerSecond) {
+        return;
+    }
+
+    m_rateLimit = bytesPerSecond;
+    if (isActive ()) {
+        send (m_pdata.rateLimit (m_rateLimit));
+    }
+}
+
 void UploadProcess::startUpload (UploadItem * item) {
     qDebug() << "UploadProcess::" << __FUNCTION__;
     if (canProcessNewRequest (item)) {
@@ -96,6 +110,9 @@ void UploadProcess::processStarted () {
     WebUpload::Error currError = m_currItem->takeError ();
     QString xmlPath = m_currEntry->serializedTo();
 
+    if (m_rateLimit > 0) {
+        send (m_pdata.rateLimit (m_rateLimit));
+    }
     send (m_pdata.startUpload (xmlPath, currError));
 
     return;
@@ -103,13 +120,7 @@ void UploadProcess::processStarted () {
 
 void UploadProcess::sendingMedia (quint32 index) {
     qDebug() << "UploadProcess::" << __FUNCTION__;
-    WebUpload::Media * media;
-    if ((m_currMediaIdx >= 0) && 
-        ((quint32)m_currMediaIdx < m_currEntry->mediaCount())) {
-
-        media = m_currEntry->mediaAt (m_currMediaIdx);
-        media->refreshStateFromTracker ();
-    }
+    syncCurrentMediaState ();
 
     if (index > m_currEntry->mediaCount()) {
         qDebug() << "Invalid media index sent" << index;
@@ -117,12 +128,37 @@ void UploadProcess::sendingMedia (quint32 index) {
     }
 
     m_currMediaIdx = index;
+    m_currMediaStateReported = false;
 
     m_currItem->markActive ();
     m_currItem->mediaStarted (index);
     return;
 }
 
+void UploadProcess::mediaStateChanged (quint32 index, qint32 state) {
+    qDebug() << "UploadProcess::" << __FUNCTION__ << index << state;
+
+    if ((m_currEntry == 0) || (index >= m_currEntry->mediaCount())) {
+        qDebug() << "Invalid media index sent" << index;
+        return;
+    }
+
+    if ((state < WebUpload::Media::STATE_PENDING) ||
+        (state > WebUpload::Media::STATE_FAILED)) {
+        qWarning() << "Invalid media state sent" << state;
+        return;
+    }
+
+    // Plugin has already written the new state to tracker, so it is enough to
+    // update the copy we have in memory
+    WebUpload::Media * media = m_currEntry->mediaAt (index);
+    media->refreshState ((WebUpload::Media::State)state);
+
+    if ((int)index == m_currMediaIdx) {
+        m_currMediaStateReported = true;
+    }
+}
+
 void UploadProcess::done () {
     qDebug() << "UploadProcess::" << __FUNCTION__;
 
@@ -138,14 +174,8 @@ void UploadProcess::done () {
     m_currentProcess = 0;
     m_pdata.disconnect (m_currItem);
 
-    WebUpload::Media * media;
     qDebug () << "Current media index is " << m_currMediaIdx;
-    if ((m_currMediaIdx >= 0) && 
-        ((quint32)m_currMediaIdx < m_currEntry->mediaCount())) {
-
-        media = m_currEntry->mediaAt (m_currMediaIdx);
-        media->refreshStateFromTracker ();
-    }
+    syncCurrentMediaState ();
 
     m_currItem->uploadProgress (1.0);
 
@@ -162,13 +192,7 @@ void UploadProcess::stopped () {
     m_resultHandled = true;
     m_stopping = false;
 
-    WebUpload::Media * media;
-    if ((m_currMediaIdx >= 0) && 
-        ((quint32)m_currMediaIdx < m_currEntry->mediaCount())) {
-
-        media = m_currEntry->mediaAt (m_currMediaIdx);
-        media->refreshStateFromTracker ();
-    }
+    syncCurrentMediaState ();
 
     m_pdata.disconnect (m_currItem);
     m_currentProcess = 0;
@@ -185,13 +209,7 @@ void UploadProcess::failed (WebUpload::Error error) {
     }
     m_resultHandled = true;
 
-    WebUpload::Media * media;
-    if ((m_currMediaIdx >= 0) && 
-        ((quint32)m_currMediaIdx < m_currEntry->mediaCount())) {
-
-        media = m_currEntry->mediaAt (m_currMediaIdx);
-        media->refreshStateFromTracker ();
-    }
+    syncCurrentMediaState ();
 
     // Set service name in the error
     WebUpload::SharedAccount account = m_currEntry->account ();
@@ -303,6 +321,20 @@ void UploadProcess::pluginProcessCrashed () {
 }
 
 
+void UploadProcess::syncCurrentMediaState () {
+    if ((m_currMediaIdx < 0) || 
+        ((quint32)m_currMediaIdx >= m_currEntry->mediaCount())) {
+        return;
+    }
+
+    // Older plugins do not report media state changes. Fall back to reading
+    // the state from tracker for those.
+    if (m_currMediaStateReported == false) {
+        WebUpload::Media * media = m_currEntry->mediaAt (m_currMediaIdx);
+        media->refreshStateFromTracker ();
+    }
+}
+
 bool UploadProcess::canProcessNewRequest (UploadItem * item) {
     bool retVal = true;
 
@@ -331,6 +363,7 @@ void UploadProcess::startUploadProcess (UploadItem * item) {
     m_resultHandled = false;
     m_stopping = false;
     m_currMediaIdx = -1;
+    m_currMediaStateReported = false;
     m_currItem = item;
     m_currEntry = m_currItem->getEntry ();
     Q_ASSERT (m_currEntry != 0);
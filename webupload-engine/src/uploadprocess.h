@@ -63,6 +63,12 @@ public:
      */
     bool isProcessStopping () const;
 
+    /*!
+      \brief Limit rate of the current and following uploads
+      \param bytesPerSecond Maximum upload rate, 0 if there is no limit
+     */
+    void setRateLimit (qint64 bytesPerSecond);
+
 Q_SIGNALS:
 
     /*!
@@ -116,6 +122,13 @@ private Q_SLOTS:
      */
     void sendingMedia (quint32 index);
 
+    /*!
+      \brief Connects to ProcessExchangeData::mediaStateChangedSignal() signal
+      \param index Index of the media whose state changed
+      \param state New state of the media
+     */
+    void mediaStateChanged (quint32 index, qint32 state);
+
     //! \brief Connects to ProcessExchangeData::doneSignal() signal
     void done ();
 
@@ -150,13 +163,22 @@ private:
     void startUploadProcess (UploadItem * item);
     bool canProcessNewRequest (UploadItem * item);
 
+    /*!
+      \brief Make sure state of the current media is up to date. State is
+             read from tracker only if the plugin did not report it.
+     */
+    void syncCurrentMediaState ();
+
     UploadItem * m_currItem; //!< Item currently being uploaded
     //! Entry corresponding to item being uploaded
     WebUpload::Entry * m_currEntry; 
     int m_currMediaIdx; //!< Index of media currently being uploaded
+    //! Has the plugin reported state of the current media
+    bool m_currMediaStateReported;
 
     bool m_resultHandled;
     bool m_stopping;
+    qint64 m_rateLimit; //!< Rate limit given to plugin, 0 if no limit
 };
 
 #endif // _UPLOAD_PROCESS_H_
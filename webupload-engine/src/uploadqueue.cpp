@@ -22,6 +22,8 @@
 #include "uploaditem.h"
 #include <QDebug>
 #include "WebUpload/entry.h"
+#include "WebUpload/account.h"
+#include "WebUpload/service.h"
 
 #define DBGPREFIX "Queue:"
 #define DBGSTREAM qDebug() << DBGPREFIX
@@ -62,9 +64,11 @@ bool UploadQueue::push (UploadItem * item) {
     
     // Mark queue as parent and push to queue model
     item->setParent (this);
-    items.push_back (item);
+    int index = smallFirstIndex (item);
+    items.insert (index, item);
     
-    DBGSTREAM << "New item" << item->toString() << ", size =" << size();
+    DBGSTREAM << "New item" << item->toString() << ", size =" << size()
+        << ", index =" << index;
 
     // Emit signal if queue was empty
     if (size() == 1) {
@@ -127,6 +131,52 @@ void UploadQueue::riseItem (UploadItem * item) {
     Q_EMIT (replacedTopItem (currentTop, item));
 }
 
+void UploadQueue::advanceItem (UploadItem * item) {
+    if (!items.contains (item)) {
+        WARNSTREAM << "Can't advance item that is not found in queue";
+        return;
+    }
+
+    if (items.first() == item) {
+        WARNSTREAM << "Item already at top of the queue";
+        return;
+    }
+
+    items.removeAll (item);
+    items.push_front (item);
+
+    Q_EMIT (topItem (item));
+}
+
+int UploadQueue::smallFirstIndex (UploadItem * item) {
+    WebUpload::Entry * entry = item->getEntry ();
+    if (entry->account().isNull() || entry->account()->service() == 0 ||
+        !entry->account()->service()->uploadsSmallFirst()) {
+        return items.size();
+    }
+
+    // Top item is already being handled. Items which are processed or being
+    // processed are skipped as processing continues from them to the next
+    // ones in queue.
+    qint64 size = entry->totalSize ();
+    for (int i = 1; i < items.size(); ++i) {
+        UploadItem * queued = items.at (i);
+        if (queued->isProcessed () ||
+            queued->getOwner () != UploadItem::OWNER_QUEUE) {
+            continue;
+        }
+
+        WebUpload::Entry * queuedEntry = queued->getEntry ();
+        if (queuedEntry->accountId() == entry->accountId() &&
+            queuedEntry->mediaSentCount() == 0 &&
+            queuedEntry->totalSize() > size) {
+            return i;
+        }
+    }
+
+    return items.size();
+}
+
 UploadItem * UploadQueue::getTop() const {
     if (size() > 0) {
         return items.first();    
@@ -56,7 +56,9 @@ public:
     void initFailed (const QString & xmlPath);
 
     /*!
-      \brief Push new task to end of queue
+      \brief Push new task to end of queue. If the service uploads small
+             media first, task is placed ahead of larger unprocessed tasks
+             of the same account.
       \param item Item pushed to queue. Ownership item will move to queue.
       \return true if item was successfully added
      */
@@ -131,9 +133,25 @@ public Q_SLOTS:
       \param item Item rised to top of queue
      */
     void riseItem (UploadItem * item);
+
+    /*!
+      \brief Move item to top of queue ahead of items that can't be sent
+             now. Unlike riseItem, the old top is not being handled, so
+             topItem is emitted for the item.
+      \param item Item moved to top of queue
+     */
+    void advanceItem (UploadItem * item);
     
 private:
 
+    /*!
+      \brief Find place for new item so that small uploads are not waiting
+             behind large ones of same account
+      \param item New item
+      \return Index where item should be inserted
+     */
+    int smallFirstIndex (UploadItem * item);
+
     QQueue <UploadItem *> items; //!< Items owned by queue and in queue
     //! Xml file path of items being initialized. Once these items are
     // initialized, they will be added to the list, and the corresponding xml 
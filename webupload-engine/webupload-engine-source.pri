@@ -2,6 +2,9 @@ HEADERS += uploaditem.h                  \
            uploadqueue.h                 \
            uploadengine.h                \
            uploadstatistics.h            \
+           linkestimator.h               \
+           bearerpolicy.h                \
+           retryscheduler.h              \
            processthread.h               \
            processhandler.h              \
            logger.h                      \
@@ -16,4 +19,7 @@ SOURCES += main.cpp                      \
            processhandler.cpp            \
            logger.cpp                    \
            uploadstatistics.cpp          \
+           linkestimator.cpp             \
+           bearerpolicy.cpp              \
+           retryscheduler.cpp            \
            uploadprocess.cpp
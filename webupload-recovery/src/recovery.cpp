@@ -28,41 +28,42 @@
 
 #include <QDebug>
 #include "WebUpload/System"
+#include "WebUpload/Entry"
 #include "uploadengine.h" 
 #include <cstdlib>
 #include <iostream>
 #include "recovery.h"
 
-bool entryAgeLessThan (QSharedPointer<WebUpload::Entry> & e1,
-    QSharedPointer<WebUpload::Entry> & e2) {
-    
-    qDebug() << "Comparing entry values" << e1->created() << "and"
-        << e2->created();
-    
-     return e1->created() < e2->created();
-}
-
 Recovery::Recovery (bool clean, QObject *parent) : QObject (parent),
     m_clean (clean) {
 
 }
 
 Recovery::~Recovery () {
-    m_entries.clear(); 
+    m_records.clear(); 
 }
 
 void Recovery::recover () {
     
+    // Only outbox index is read here, entries are loaded by the engine
     WebUpload::System system;
-    m_entries = system.outboxEntries();
+    QList<WebUpload::OutboxRecord> records = system.outboxIndex();
+
+    // Finished entries have nothing to recover
+    m_records.clear();
+    for (int i = 0; i < records.count(); ++i) {
+        if (!records.at (i).isSent() && !records.at (i).isCanceled()) {
+            m_records << records.at (i);
+        }
+    }
     
-    if (m_entries.count() == 0) {
+    if (m_records.count() == 0) {
         qDebug() << "No undone entries found.";
         Q_EMIT (done ());
         return;
     }
     
-    qDebug() << m_entries.count() << "undone entries loaded.";
+    qDebug() << m_records.count() << "undone entries found.";
     
     if (m_clean) {
         cleanEntries ();
@@ -70,22 +71,15 @@ void Recovery::recover () {
         return;
     }
     
-    //Order entries
-    qSort (m_entries.begin(), m_entries.end(), entryAgeLessThan);
-    
     //TODO: check state of transfers???
-    QStringList paths;
-    for (int i = 0; i < m_entries.count(); ++i) {
-        paths << m_entries.at(i)->serializedTo();
-    }
-
     UploadEngine interface ("com.meego.sharing.webuploadengine");
-    for (int i = 0; i < paths.count(); ++i) {
-        bool ret = interface.newUpload (paths.at(i));
+    for (int i = 0; i < m_records.count(); ++i) {
+        QString path = m_records.at(i).path();
+        bool ret = interface.newUpload (path);
         if (ret == false) {
-            qWarning() << "Failed to send entry" << paths.at(i) << 
+            qWarning() << "Failed to send entry" << path << 
                 "to webupload engine. Cancelling it ...";
-            m_entries.at(i)->cancel ();
+            cancelEntry (path);
         }
     }    
 
@@ -96,8 +90,17 @@ void Recovery::recover () {
 
 void Recovery::cleanEntries () {
     std::cout << "Cleaning mode enabled";
-    for (int i = 0; i < m_entries.count(); ++i) {
+    for (int i = 0; i < m_records.count(); ++i) {
         std::cout << i + 1 << ": Cancel entry";
-        m_entries.at(i)->cancel();
+        cancelEntry (m_records.at(i).path());
+    }
+}
+
+void Recovery::cancelEntry (const QString & path) {
+    WebUpload::Entry entry;
+    if (entry.init (path)) {
+        entry.cancel();
+    } else {
+        WebUpload::Entry::cleanUp (path);
     }
 }
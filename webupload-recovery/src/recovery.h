@@ -31,8 +31,7 @@
 
 #include <QObject>
 #include <QList>
-#include <QSharedPointer>
-#include "WebUpload/entry.h"
+#include "WebUpload/OutboxRecord"
 
 /*!
    \class  Recovery
@@ -78,8 +77,14 @@ private:
 
     void cleanEntries ();
 
+    /*!
+      \brief Load entry and cancel it
+      \param path Path of entry
+     */
+    void cancelEntry (const QString & path);
+
     bool m_clean; 
-    QList <QSharedPointer <WebUpload::Entry> > m_entries;
+    QList <WebUpload::OutboxRecord> m_records; //!< Outbox, oldest first
 };
 
 #endif // _RECOVERY_H_